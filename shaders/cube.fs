@@ -24,70 +24,203 @@
 
 #version 410
 
+// Feature switches, prepended by GLRaycaster for each program variant (see GLRaycaster::variantKey())
+#ifndef PHONG_SHADING
+#define PHONG_SHADING 1
+#endif
+#ifndef JITTERING
+#define JITTERING 0
+#endif
+#ifndef EMPTY_SPACE_SKIPPING
+#define EMPTY_SPACE_SKIPPING 0
+#endif
+#ifndef OPACITY_CORRECTION
+#define OPACITY_CORRECTION 0
+#endif
+#ifndef PREINTEGRATED
+#define PREINTEGRATED 0
+#endif
+#ifndef GRADIENT_OPACITY
+#define GRADIENT_OPACITY 0
+#endif
+#ifndef GRADIENT_ON_THE_FLY
+#define GRADIENT_ON_THE_FLY 0 // Central differences of uTexVol instead of uTexVolNormals
+#endif
+#ifndef CHANNELS
+#define CHANNELS 0 // Bit i: fuse channel i + 1 (uTexChannel[i], uTexChannelTF[i]) into every sample
+#endif
+#ifndef RAY_SETUP
+#define RAY_SETUP 0 // Ray setup pass: write the world space exit position of the back faces
+#endif
+#ifndef COMPUTE
+#define COMPUTE 0 // Tiled compute raycaster (compiled as #version 430), see main() below
+#endif
+#ifndef COMPOSITE
+#define COMPOSITE 0 // Blend a ray image (compute raycaster, temporal accumulation) over the framebuffer
+#endif
+#ifndef REPROJECT
+#define REPROJECT 0 // Reuse the previous frame where its surface point lies on this frame's ray
+#endif
+#define REPRESENTATIVE_ALPHA 0.5 // Opacity at which a ray records its surface point for reprojection
+#define REPROJECTION_MIN_ALPHA 0.8 // Less opaque pixels depend on more than their surface point: raycast them
+#define REPROJECTION_TOLERANCE 2.0 // Distance of the surface point from the new ray, in step sizes
+#define REPROJECTION_MAX_AGE 8.0 // Frames a pixel may be carried forward before it is raycast again
+#define SHADING_MIN_GRADIENT 0.1 // Relative gradient magnitude below which a region counts as homogeneous: unshaded
+#define GRADIENT_MIN_OPACITY 0.002 // On the fly, fainter samples are not worth six fetches: they count as homogeneous
+#define INTERPOLATION_NEAREST 0
+#define INTERPOLATION_TRILINEAR 1
+#define INTERPOLATION_TRICUBIC 2
+#ifndef INTERPOLATION
+#define INTERPOLATION INTERPOLATION_TRILINEAR
+#endif
+
+#if COMPUTE
+#define TILE_SIZE 8
+#define OCCUPANCY_CACHE_WORDS 4096 // 16 KB of shared memory: one bit per brick for grids of up to 131072 bricks
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+layout(rgba16f, binding = 0) uniform writeonly image2D uImageOut;
+layout(binding = 0, offset = 0) uniform atomic_uint uNextTile;
+uniform mat4 uInvView;
+uniform vec2 uInvProjectionScale; // Eye space x, y of a ray per unit of NDC x, y at z = -1
+uniform ivec4 uViewport;
+uniform int uTilesX, uTileCount;
+#if EMPTY_SPACE_SKIPPING
+shared uint sOccupancy[OCCUPANCY_CACHE_WORDS];
+shared bool sOccupancyCached;
+#endif
+shared uint sTile;
+#else
 in vec3 vPosition;
-out vec4 fColor;
+layout(location = 0) out vec4 fColor;
+layout(location = 1) out vec4 fPoint; // Surface point for reprojection: world position, age in frames (0: none)
+uniform ivec4 uViewport;
+#endif
 
 uniform sampler3D uTexVol; // Volumetric texture
 uniform sampler1D uTexTF1D; // 256 length RGBA TF texture
-uniform sampler2D uTexNoise; //32x32 luminance noise texture
-uniform sampler3D uTexVolNormals; // Volumetric texture normals
+uniform sampler2D uTexNoise; // Tileable blue noise, BLUE_NOISE_SIZE^2
+uniform sampler3D uTexVolNormals; // Unit normals in rgb, gradient magnitude relative to the largest one in a
+uniform sampler3D uTexOccupancy; // Per-brick occupancy, 0 if the brick is transparent under the current TF
+uniform sampler2D uTexPreintegrated; // Pre-integrated TF: RGBA of the segment from front (x) to back (y) sample
+#define MAX_CHANNELS 3 // VOLUME_MAX_CHANNELS - 1
+uniform sampler3D uTexChannel[MAX_CHANNELS]; // Co-registered volumes spanning the same box, any resolution
+uniform sampler1D uTexChannelTF[MAX_CHANNELS]; // Their TFs, like uTexTF1D
+uniform sampler2D uTexExit; // Exit positions from the ray setup pass, alpha 0 where no back face was drawn
+uniform sampler2D uTexRaycast; // Ray image for the composite pass; the previous one when reprojecting
+uniform sampler2D uTexPrevPoints; // Surface points of the previous frame
+uniform mat4 uPrevViewProjection;
+uniform bool uPremultiply; // Write color*alpha, alpha: averaging frames must average what blending would add
 
-uniform float uTime;
-uniform mat4 uView;
+uniform float uNoisePhase; // Added to the noise (mod 1), advanced by the golden ratio every frame
+uniform vec3 uEye; // World space camera position
+uniform bool uCameraInside; // Faces are back faces: rays start at the eye
 uniform float uStepSize;
-uniform int uInterpolationType;
-uniform int uUseJittering;
 uniform vec3 uBBox;
-uniform int uPerformPhongShading;
+uniform vec3 uBrickTexSize; // Brick extent in texture coordinates
+uniform float uOpacityCorrection; // Ratio of the current step size to the configured one
+uniform float uGradientOpacity; // Weight of the gradient magnitude in the sample opacity
+uniform float uGradientScale; // 1/largest gradient magnitude of the volume, for gradients computed on the fly
 
 #define SHININESS 128
 
-// Return exit intersection point of the given ray with cuboid centered at origin
-// p = eye + t*direction, t \in [t_begin, t_end]
-// This routine will return t_end
-float cuboid_intersect(vec3 eye, vec3 direction)
+vec3 vert2tex(vec3 v)
 {
-    //Liang-Barsky clipping algorithm.
-    //Need to look only at exit points
-    float dimX = uBBox.x/2.0; // L = -dimX, R = dimX
-    float dimY = uBBox.y/2.0; // B = -dimY, T = dimY
-    float dimZ = uBBox.z/2.0; // N = -dimZ, F = dimZ
-
-    float Cx, Cy, Cz, qx, qy, qz;// parameters of exit points
-    if(direction.x > 0) { //+X plane is exit
-        Cx = direction.x;
-        qx = dimX - eye.x;
-    } else { //-X plane is exit
-        Cx = -direction.x;
-        qx = dimX + eye.x;
-    }
+    return (v/uBBox + vec3(0.5, 0.5, 0.5));
+}
 
-    if(direction.y > 0) { //+Y plane is exit
-        Cy = direction.y;
-        qy = dimY - eye.y;
-    } else { //-Y plane is exit
-        Cy = -direction.y;
-        qy = dimY + eye.y;
-    }
+// Number of whole steps needed to leave the brick containing texture coordinate tc
+int brick_exit_steps(vec3 tc, vec3 dir)
+{
+    vec3 brick = floor(tc/uBrickTexSize);
+    vec3 dtex = dir/uBBox; // Ray direction in texture space
+    dtex = mix(vec3(1e-6), dtex, greaterThan(abs(dtex), vec3(1e-6)));
+    vec3 t = ((brick + step(0.0, dtex))*uBrickTexSize - tc)/dtex;
+    return max(int(ceil(min(t.x, min(t.y, t.z))/uStepSize)), 1);
+}
 
-    if(direction.z > 0) { //+Z plane is exit
-        Cz = direction.z;
-        qz = dimZ - eye.z;
-    } else { //-Z plane is exit
-        Cz = -direction.z;
-        qz = dimZ + eye.z;
+bool brick_occupied(vec3 tc)
+{
+    ivec3 size = textureSize(uTexOccupancy, 0);
+    ivec3 brick = clamp(ivec3(floor(tc/uBrickTexSize)), ivec3(0), size - 1);
+#if COMPUTE && EMPTY_SPACE_SKIPPING
+    if(sOccupancyCached) {
+        int i = brick.x + size.x*(brick.y + size.y*brick.z);
+        return (sOccupancy[i >> 5] & (1u << (i & 31))) != 0u;
     }
+#endif
+    return texelFetch(uTexOccupancy, brick, 0).r != 0.0;
+}
+
+float sample_volume(vec3 tc)
+{
+#if INTERPOLATION == INTERPOLATION_NEAREST
+    ivec3 size = textureSize(uTexVol, 0);
+    return texelFetch(uTexVol, clamp(ivec3(tc*vec3(size)), ivec3(0), size - 1), 0).r;
+#elif INTERPOLATION == INTERPOLATION_TRICUBIC
+    //Cubic B-spline from 8 linear fetches (Sigg and Hadwiger, GPU Gems 2, ch. 20): per axis, the 4 weighted texels
+    //are two linear fetches at offsets h0, h1 weighted by g0, g1
+    vec3 size = vec3(textureSize(uTexVol, 0));
+    vec3 coord = tc*size - 0.5;
+    vec3 index = floor(coord);
+    vec3 f = coord - index;
+    vec3 f2 = f*f, f3 = f2*f;
+    vec3 w0 = (1.0 - 3.0*f + 3.0*f2 - f3)/6.0;
+    vec3 w1 = (4.0 - 6.0*f2 + 3.0*f3)/6.0;
+    vec3 w3 = f3/6.0;
+    vec3 g0 = w0 + w1;
+    vec3 g1 = 1.0 - g0;
+    vec3 h0 = (index - 0.5 + w1/g0)/size;
+    vec3 h1 = (index + 1.5 + w3/g1)/size;
 
-    float tx = qx/Cx;
-    float ty = qy/Cy;
-    float tz = qz/Cz;
+    float s000 = texture(uTexVol, vec3(h0.x, h0.y, h0.z)).r;
+    float s100 = texture(uTexVol, vec3(h1.x, h0.y, h0.z)).r;
+    float s010 = texture(uTexVol, vec3(h0.x, h1.y, h0.z)).r;
+    float s110 = texture(uTexVol, vec3(h1.x, h1.y, h0.z)).r;
+    float s001 = texture(uTexVol, vec3(h0.x, h0.y, h1.z)).r;
+    float s101 = texture(uTexVol, vec3(h1.x, h0.y, h1.z)).r;
+    float s011 = texture(uTexVol, vec3(h0.x, h1.y, h1.z)).r;
+    float s111 = texture(uTexVol, vec3(h1.x, h1.y, h1.z)).r;
+    float z0 = g0.y*(g0.x*s000 + g1.x*s100) + g1.y*(g0.x*s010 + g1.x*s110);
+    float z1 = g0.y*(g0.x*s001 + g1.x*s101) + g1.y*(g0.x*s011 + g1.x*s111);
+    return g0.z*z0 + g1.z*z1;
+#else
+    return texture(uTexVol, tc).r;
+#endif
+}
 
-    return min(tx, min(ty, tz));
+// Normal direction (not unit length) and relative gradient magnitude at tc
+vec4 volume_gradient(vec3 tc)
+{
+#if GRADIENT_ON_THE_FLY
+    // Central differences one voxel apart; with linear filtering this equals interpolating the voxels' differences
+    vec3 size = vec3(textureSize(uTexVol, 0));
+    vec3 texel = 1.0/size;
+    vec3 g = vec3(texture(uTexVol, tc + vec3(texel.x, 0, 0)).r - texture(uTexVol, tc - vec3(texel.x, 0, 0)).r,
+                  texture(uTexVol, tc + vec3(0, texel.y, 0)).r - texture(uTexVol, tc - vec3(0, texel.y, 0)).r,
+                  texture(uTexVol, tc + vec3(0, 0, texel.z)).r - texture(uTexVol, tc - vec3(0, 0, texel.z)).r);
+    g *= 0.5*size/uBBox; // Per world unit
+    return vec4(g, length(g)*uGradientScale);
+#else
+    vec4 normal = texture(uTexVolNormals, tc);
+    return vec4(normal.rgb*2.0 - 1.0, normal.a); // Unit normals, shortened by interpolation
+#endif
 }
 
-vec3 vert2tex(vec3 v)
+// Fuses the classified channels into the volume's sample: opacities combine like stacked layers, and the color is
+// the opacity weighted mean of the (associated) colors
+vec4 fuse_channels(vec3 tc, vec4 rgba)
 {
-    return (v/uBBox + vec3(0.5, 0.5, 0.5));
+    vec3 rgb = rgba.rgb;
+    float alphaSum = rgba.a, transparency = 1.0 - rgba.a;
+    for(int i=0; i<MAX_CHANNELS; i++) {
+        if((CHANNELS & (1 << i)) == 0) continue;
+        vec4 channel = texture(uTexChannelTF[i], texture(uTexChannel[i], tc).r);
+        rgb += channel.rgb;
+        alphaSum += channel.a;
+        transparency *= 1.0 - channel.a;
+    }
+    float alpha = 1.0 - transparency;
+    return alphaSum > 0.0 ? vec4(rgb*(alpha/alphaSum), alpha) : vec4(0.0);
 }
 
 vec4 shade(vec3 fPos, vec4 fColor, vec3 dir, vec3 normal, vec3 lightPos) {
@@ -98,43 +231,173 @@ vec4 shade(vec3 fPos, vec4 fColor, vec3 dir, vec3 normal, vec3 lightPos) {
     return vec4(diffuse + specular, fColor.a);
 }
 
-void main(void) {
-    mat4 invView = inverse(uView);
-    vec3 eye = vec3(invView[3][0], invView[3][1],invView[3][2]); //Last column
-
-    //Begin raycasting into the scene
-    vec3 fPosition = vPosition;
-    vec3 dir = normalize((fPosition - eye));
-    float delta_t = cuboid_intersect(eye, dir) - length(fPosition - eye); // t_end - t_begin
-
-    if(uUseJittering == 1)
-        fPosition += 0.002*texture(uTexNoise, gl_FragCoord.xy/vec2(32, 32)).x; //Jitter the position
+// Front to back compositing along the ray from fPosition to fPosition + delta_t*dir; pixel selects the jitter.
+// point receives the position where the opacity reached REPRESENTATIVE_ALPHA, w = 1, or zero.
+vec4 march(vec3 fPosition, vec3 dir, float delta_t, vec2 pixel, out vec4 point)
+{
+    point = vec4(0.0);
+#if JITTERING
+    //Start a fraction of a step along the ray, so that neighbouring pixels and successive frames sample in between
+    float jitter = fract(texelFetch(uTexNoise, ivec2(pixel) % textureSize(uTexNoise, 0), 0).r + uNoisePhase);
+    fPosition += jitter*uStepSize*dir;
+    delta_t -= jitter*uStepSize;
+#endif
     vec3 delta_dir = dir * uStepSize; // normalize and pre-multiply by stepsize for efficiency
 
     //Raycasting - front to back compositing
     vec4 color = vec4(0, 0, 0, 0); //alpha is computed within it.
     float texVol_sample;
     vec4 texRGBA_sample;
-    vec3 normal;
-    float normal_mag;
-    vec3 lightPos = eye; //Headlight
+    vec4 gradient;
+    vec3 lightPos = uEye; //Headlight
+#if PREINTEGRATED
+    float front_sample = -1.0; //None yet: the first segment degenerates to a point sample
+#endif
 
     for(float s = 0; s < delta_t; s += uStepSize) { //Front to back
-        texVol_sample = texture(uTexVol, vert2tex(fPosition)).r;
+#if EMPTY_SPACE_SKIPPING
+        vec3 tc = vert2tex(fPosition);
+        if(!brick_occupied(tc)) { //Skip the transparent brick, staying on the sample grid
+            int n = brick_exit_steps(tc, dir);
+            s += float(n - 1)*uStepSize;
+            fPosition += float(n)*delta_dir;
+#if PREINTEGRATED
+            front_sample = -1.0;
+#endif
+            continue;
+        }
+#endif
+        texVol_sample = sample_volume(vert2tex(fPosition));
+#if PREINTEGRATED
+        texRGBA_sample = texture(uTexPreintegrated, vec2(front_sample < 0.0 ? texVol_sample : front_sample, texVol_sample));
+        front_sample = texVol_sample;
+#else
         texRGBA_sample = texture(uTexTF1D, texVol_sample); //RGBA Sample
-        if(uPerformPhongShading == 1) {
-            normal = texture(uTexVolNormals, vert2tex(fPosition)).rgb* 2.0 - 1.0;
-            normal_mag = length(normal);
-            if (normal_mag > 0.1 && s > uStepSize) {
-                texRGBA_sample = shade(fPosition, texRGBA_sample, -dir, normalize(normal), lightPos);
-                //texRGBA_sample.rgb  *= normal_mag;
-            }
+#endif
+#if CHANNELS
+        texRGBA_sample = fuse_channels(vert2tex(fPosition), texRGBA_sample); //Channels are point sampled
+#endif
+#if PHONG_SHADING || GRADIENT_OPACITY
+        //Transparent samples need no normal
+#if GRADIENT_ON_THE_FLY
+        gradient = texRGBA_sample.a > GRADIENT_MIN_OPACITY ? volume_gradient(vert2tex(fPosition)) : vec4(0.0);
+#else
+        gradient = texRGBA_sample.a > 0.0 ? volume_gradient(vert2tex(fPosition)) : vec4(0.0);
+#endif
+#endif
+#if GRADIENT_OPACITY
+        texRGBA_sample *= mix(1.0, gradient.a, uGradientOpacity); //Emphasize boundaries over homogeneous regions
+#endif
+#if OPACITY_CORRECTION
+        if(texRGBA_sample.a > 0.0) { //Keep the look of the configured step size
+            float alpha = 1.0 - pow(1.0 - min(texRGBA_sample.a, 0.999), uOpacityCorrection);
+            texRGBA_sample *= alpha/texRGBA_sample.a; //Associated colors scale with alpha
         }
+#endif
+#if PHONG_SHADING
+        if (gradient.a > SHADING_MIN_GRADIENT && s > uStepSize)
+            texRGBA_sample = shade(fPosition, texRGBA_sample, -dir, normalize(gradient.xyz), lightPos);
+#endif
         if(texRGBA_sample.a > 0.0) {
             color += (1.0 - color.a)*texRGBA_sample;
+            if(point.w == 0.0 && color.a >= REPRESENTATIVE_ALPHA) point = vec4(fPosition, 1.0);
         }
         if(color.a > 0.95) break; //Early ray termination
         fPosition += delta_dir;
     }
-    fColor = vec4(color);
+    return color;
+}
+
+#if RAY_SETUP
+void main(void) {
+    fColor = vec4(vPosition, 1.0);
+}
+#elif COMPOSITE
+void main(void) {
+    vec4 color = texelFetch(uTexRaycast, ivec2(gl_FragCoord.xy), 0);
+    fColor = uPremultiply ? vec4(color.rgb*color.a, color.a) : color;
+}
+#elif REPROJECT
+// Gather from the previous frame: guess the depth from the same pixel, follow the surface point found there into the
+// previous image a couple of times, and keep its color if that point lies on this pixel's ray. Everything else is
+// discarded and raycast by the next pass (depth 0 here masks the reused pixels).
+void main(void) {
+    vec3 dir = normalize(vPosition - uEye);
+    ivec2 prevPixel = ivec2(gl_FragCoord.xy);
+    vec4 point = texelFetch(uTexPrevPoints, prevPixel, 0);
+    float maxAge = REPROJECTION_MAX_AGE - float((prevPixel.x + 2*prevPixel.y) & 3); //Staggered, so they expire spread out
+    for(int i=0; i<2; i++) {
+        if(point.w == 0.0 || point.w >= maxAge) discard;
+        vec3 onRay = uEye + max(dot(point.xyz - uEye, dir), 0.0)*dir;
+        vec4 clip = uPrevViewProjection*vec4(onRay, 1.0);
+        if(clip.w <= 0.0) discard;
+        prevPixel = ivec2(floor((clip.xy/clip.w*0.5 + 0.5)*vec2(uViewport.zw))) + uViewport.xy;
+        if(any(lessThan(prevPixel, uViewport.xy)) || any(greaterThanEqual(prevPixel, uViewport.xy + uViewport.zw))) discard;
+        point = texelFetch(uTexPrevPoints, prevPixel, 0);
+    }
+    vec4 color = texelFetch(uTexRaycast, prevPixel, 0);
+    if(point.w == 0.0 || point.w >= maxAge || color.a < REPROJECTION_MIN_ALPHA) discard;
+    float t = dot(point.xyz - uEye, dir);
+    if(t <= 0.0 || distance(uEye + t*dir, point.xyz) > REPROJECTION_TOLERANCE*uStepSize) discard; //Disoccluded
+    fColor = color;
+    fPoint = vec4(point.xyz, point.w + 1.0);
+    gl_FragDepth = 0.0;
+}
+#elif COMPUTE
+// Persistent threads: a fixed number of work groups pull 8x8 screen tiles from an atomic counter until none are left,
+// so groups that drew sparse tiles take on more of them. With empty space skipping, the occupancy bits are loaded into
+// shared memory once per group and serve every tile it marches.
+void main(void) {
+    uint local = gl_LocalInvocationIndex;
+#if EMPTY_SPACE_SKIPPING
+    ivec3 size = textureSize(uTexOccupancy, 0);
+    int nBricks = size.x*size.y*size.z;
+    if(local == 0u) sOccupancyCached = (nBricks <= OCCUPANCY_CACHE_WORDS*32);
+    barrier();
+    if(sOccupancyCached) {
+        for(int word = int(local); word*32 < nBricks; word += TILE_SIZE*TILE_SIZE) {
+            uint bits = 0u;
+            for(int b=0; b<32 && word*32 + b < nBricks; b++) {
+                int i = word*32 + b;
+                ivec3 brick = ivec3(i % size.x, (i/size.x) % size.y, i/(size.x*size.y));
+                if(texelFetch(uTexOccupancy, brick, 0).r != 0.0) bits |= 1u << b;
+            }
+            sOccupancy[word] = bits;
+        }
+    }
+#endif
+
+    for(;;) {
+        barrier(); //Everyone is done with the previous tile index
+        if(local == 0u) sTile = atomicCounterIncrement(uNextTile);
+        barrier();
+        int tile = int(sTile);
+        if(tile >= uTileCount) break;
+        ivec2 pixel = ivec2(tile % uTilesX, tile / uTilesX)*TILE_SIZE + ivec2(gl_LocalInvocationID.xy);
+        if(pixel.x < uViewport.z && pixel.y < uViewport.w) { //No early continue: barrier() needs uniform flow
+            //Ray through the pixel centre as rasterized by the fragment path, clipped to the volume (slab test)
+            vec2 ndc = 2.0*(vec2(pixel) + 0.5)/vec2(uViewport.zw) - 1.0;
+            vec3 dir = normalize((uInvView*vec4(ndc*uInvProjectionScale, -1.0, 0.0)).xyz);
+            vec3 safeDir = mix(vec3(1e-6), dir, greaterThan(abs(dir), vec3(1e-6)));
+            vec3 t1 = (-0.5*uBBox - uEye)/safeDir, t2 = (0.5*uBBox - uEye)/safeDir;
+            vec3 tMin = min(t1, t2), tMax = max(t1, t2);
+            float tNear = max(max(tMin.x, tMin.y), max(tMin.z, 0.0));
+            float tFar = min(tMax.x, min(tMax.y, tMax.z));
+            pixel += uViewport.xy;
+            vec4 color = vec4(0.0), point;
+            if(tNear < tFar) color = march(uEye + tNear*dir, dir, tFar - tNear, vec2(pixel) + 0.5, point);
+            imageStore(uImageOut, pixel, color);
+        }
+    }
+}
+#else
+void main(void) {
+    vec4 exit = texelFetch(uTexExit, ivec2(gl_FragCoord.xy), 0);
+    if(exit.a == 0.0) discard;
+
+    //Begin raycasting into the scene
+    vec3 fPosition = uCameraInside ? uEye : vPosition;
+    vec3 dir = normalize(vPosition - uEye);
+    fColor = march(fPosition, dir, length(exit.xyz - fPosition), gl_FragCoord.xy, fPoint); // t_end - t_begin
 }
+#endif
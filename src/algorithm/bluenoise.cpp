@@ -0,0 +1,133 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "bluenoise.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+//Energy of every pixel: sum of the Gaussian filter over the set pixels, wrapping around the edges
+class EnergyField
+{
+public:
+    EnergyField(int size, float sigma) : m_size(size), m_energy(size*size, 0.0f) {
+        //The filter is cut off at 4 sigma, where it has fallen below 1e-3
+        m_radius = std::min((int)ceil(4.0*sigma), (size - 1)/2);
+        int width = 2*m_radius + 1;
+        m_filter.resize(width*width);
+        for(int y=-m_radius; y<=m_radius; y++)
+            for(int x=-m_radius; x<=m_radius; x++)
+                m_filter[(y + m_radius)*width + x + m_radius] = exp(-(x*x + y*y)/(2.0*sigma*sigma));
+    }
+    void splat(int pixel, float sign) {
+        int px = pixel%m_size, py = pixel/m_size, width = 2*m_radius + 1;
+        for(int y=-m_radius; y<=m_radius; y++) {
+            const float *row = &m_filter[(y + m_radius)*width + m_radius];
+            float *energy = &m_energy[((py + y + m_size)%m_size)*m_size];
+            for(int x=-m_radius; x<=m_radius; x++) energy[(px + x + m_size)%m_size] += sign*row[x];
+        }
+    }
+    //Tightest cluster: the set pixel of highest energy; largest void: the free pixel of lowest. The pattern must have
+    //one of each
+    int tightestCluster(std::vector<char> const &pattern) const { return extreme(pattern, 1, 1.0f);}
+    int largestVoid(std::vector<char> const &pattern) const { return extreme(pattern, 0, -1.0f);}
+
+private:
+    int m_size, m_radius;
+    std::vector<float> m_filter, m_energy;
+
+    int extreme(std::vector<char> const &pattern, char value, float sign) const {
+        int best = 0;
+        float bestEnergy = -HUGE_VALF;
+        for(int i=0; i<(int)pattern.size(); i++)
+            if(pattern[i] == value && sign*m_energy[i] > bestEnergy) {
+                best = i;
+                bestEnergy = sign*m_energy[i];
+            }
+        return best;
+    }
+};
+
+void generateBlueNoise(int size, float sigma, unsigned int seed, int *ranks)
+{
+    int n = size*size;
+    int initial = std::max(n/10, 1); //Initial binary pattern: a tenth of the pixels, at random
+    std::vector<char> pattern(n, 0);
+    EnergyField field(size, sigma);
+    unsigned int state = seed;
+    for(int placed = 0; placed < initial;) {
+        state = state*1664525u + 1013904223u;
+        int pixel = (state >> 8)%n;
+        if(pattern[pixel]) continue;
+        pattern[pixel] = 1;
+        field.splat(pixel, 1.0f);
+        placed++;
+    }
+
+    //Spread it out: move the tightest cluster into the largest void until that is where it came from
+    for(;;) {
+        int cluster = field.tightestCluster(pattern);
+        pattern[cluster] = 0;
+        field.splat(cluster, -1.0f);
+        int hole = field.largestVoid(pattern);
+        pattern[hole] = 1;
+        field.splat(hole, 1.0f);
+        if(hole == cluster) break;
+    }
+
+    //Ranks below the initial pattern: take its points away, tightest cluster first
+    std::vector<char> removed = pattern;
+    EnergyField removing = field;
+    for(int rank = initial - 1; rank >= 0; rank--) {
+        int cluster = removing.tightestCluster(removed);
+        removed[cluster] = 0;
+        removing.splat(cluster, -1.0f);
+        ranks[cluster] = rank;
+    }
+    //Ranks above: fill the largest void. On the torus the filtered sum over all pixels is constant, so this is also
+    //the tightest cluster of free pixels once more than half are set
+    for(int rank = initial; rank < n; rank++) {
+        int hole = field.largestVoid(pattern);
+        pattern[hole] = 1;
+        field.splat(hole, 1.0f);
+        ranks[hole] = rank;
+    }
+}
+
+static std::vector<unsigned char> createBlueNoiseTexture()
+{
+    int n = BLUE_NOISE_SIZE*BLUE_NOISE_SIZE;
+    std::vector<int> ranks(n);
+    generateBlueNoise(BLUE_NOISE_SIZE, 1.5f, 12345, &ranks[0]); //Fixed seed: jittered renders are reproducible
+    std::vector<unsigned char> texture(n);
+    for(int i=0; i<n; i++) texture[i] = (unsigned char)((long)ranks[i]*256/n);
+    return texture;
+}
+
+const unsigned char* blueNoiseTexture()
+{
+    static const std::vector<unsigned char> texture = createBlueNoiseTexture(); //Thread safe initialization
+    return &texture[0];
+}
@@ -0,0 +1,39 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef BLUENOISE_H
+#define BLUENOISE_H
+
+#define BLUE_NOISE_SIZE 64 // Edge of the tileable jitter texture of both raycasters
+#define BLUE_NOISE_FRAME_STEP 0.61803398874989485 // Phase added to the jitter every frame: golden ratio conjugate
+
+//Tileable blue noise by void-and-cluster (Ulichney 1993): ranks 0..size*size-1 of a size x size torus, x fastest,
+//ordered so that every prefix of the ranks is an evenly spread point set. sigma is the width of the Gaussian energy
+//filter in pixels (1.5 is the usual choice).
+void generateBlueNoise(int size, float sigma, unsigned int seed, int *ranks);
+
+//BLUE_NOISE_SIZE^2 jitter values in 0..255, each used equally often. Generated on first use and kept for the process.
+const unsigned char* blueNoiseTexture();
+
+#endif // BLUENOISE_H
@@ -0,0 +1,42 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "bricklayout.h"
+
+BrickLayout::BrickLayout()
+{
+    m_width = m_height = m_depth = 0;
+    m_bricksX = m_bricksY = m_bricksZ = 0;
+}
+
+void BrickLayout::setup(int width, int height, int depth)
+{
+    m_width = width;
+    m_height = height;
+    m_depth = depth;
+    //Padded voxels -1..size; a footprint may start at padded index size (voxel size - 1), whose apron is voxel size
+    m_bricksX = width/VOLUME_BRICK_SIZE + 1;
+    m_bricksY = height/VOLUME_BRICK_SIZE + 1;
+    m_bricksZ = depth/VOLUME_BRICK_SIZE + 1;
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef BRICKLAYOUT_H
+#define BRICKLAYOUT_H
+
+#include <math.h>
+
+#define VOLUME_BRICK_LOG2 3
+#define VOLUME_BRICK_SIZE (1 << VOLUME_BRICK_LOG2) // Voxels per brick edge
+#define VOLUME_BRICK_STRIDE (VOLUME_BRICK_SIZE + 1) // Stored edge: one apron voxel shared with the next brick
+#define VOLUME_BRICK_ELEMENTS (VOLUME_BRICK_STRIDE*VOLUME_BRICK_STRIDE*VOLUME_BRICK_STRIDE)
+
+// Swizzled voxel layout: the volume, padded by a zero voxel on every side (the GL_CLAMP_TO_BORDER border), is cut into
+// 8^3 bricks stored one after the other. Each brick keeps a copy of the first voxel layer of its +x, +y and +z
+// neighbours, so all 8 corners of a trilinear footprint live in the same 3 KB block: a ray then touches a handful of
+// pages whatever its direction, where the linear x-fastest layout strides a whole slice per step along z.
+class BrickLayout
+{
+public:
+    BrickLayout();
+    void setup(int width, int height, int depth);
+    long size() const { return (long)m_bricksX*m_bricksY*m_bricksZ*VOLUME_BRICK_ELEMENTS;} // Elements to allocate
+    int width() const { return m_width;}
+    int height() const { return m_height;}
+    int depth() const { return m_depth;}
+    int bricksX() const { return m_bricksX;}
+    int bricksY() const { return m_bricksY;}
+    int bricksZ() const { return m_bricksZ;}
+
+    //Element of voxel (x, y, z), x in [-1, width] etc.; the outer layer is the zero border
+    inline long index(int x, int y, int z) const {
+        x++; y++; z++;
+        int bx = x >> VOLUME_BRICK_LOG2, by = y >> VOLUME_BRICK_LOG2, bz = z >> VOLUME_BRICK_LOG2;
+        int lx = x & (VOLUME_BRICK_SIZE - 1), ly = y & (VOLUME_BRICK_SIZE - 1), lz = z & (VOLUME_BRICK_SIZE - 1);
+        return ((long)(bz*m_bricksY + by)*m_bricksX + bx)*VOLUME_BRICK_ELEMENTS + (lz*VOLUME_BRICK_STRIDE + ly)*VOLUME_BRICK_STRIDE + lx;
+    }
+    //True if the trilinear footprint with lower corner (x, y, z) touches the volume, i.e. index() is valid for all corners
+    inline bool footprintInside(int x, int y, int z) const {
+        return x >= -1 && y >= -1 && z >= -1 && x < m_width && y < m_height && z < m_depth;
+    }
+
+    //Copies a linear (x fastest) volume into the layout; dst must hold size() elements
+    template<typename T> void swizzle(const T *src, T *dst) const {
+        for(int bz=0; bz<m_bricksZ; bz++) swizzleSlab(src, dst, bz);
+    }
+    //Same for the bricks of one z slab only, so slabs can be converted in parallel
+    template<typename T> void swizzleSlab(const T *src, T *dst, int bz) const;
+
+    //Filtered like the GL 3D texture: u, v, w are texel coordinates (tc*size - 0.5 for trilinear, tc*size for nearest)
+    inline float sampleTrilinear(const float *bricks, float u, float v, float w) const;
+    inline float sampleNearest(const float *bricks, float u, float v, float w) const;
+
+private:
+    int m_width, m_height, m_depth;
+    int m_bricksX, m_bricksY, m_bricksZ;
+};
+
+template<typename T> void BrickLayout::swizzleSlab(const T *src, T *dst, int bz) const
+{
+    //Walk the destination brick by brick so writes are sequential
+    long out = (long)bz*m_bricksY*m_bricksX*VOLUME_BRICK_ELEMENTS;
+    for(int by=0; by<m_bricksY; by++)
+        for(int bx=0; bx<m_bricksX; bx++)
+            for(int lz=0; lz<VOLUME_BRICK_STRIDE; lz++) {
+                int z = bz*VOLUME_BRICK_SIZE + lz - 1;
+                for(int ly=0; ly<VOLUME_BRICK_STRIDE; ly++) {
+                    int y = by*VOLUME_BRICK_SIZE + ly - 1;
+                    bool rowInside = (y >= 0 && z >= 0 && y < m_height && z < m_depth);
+                    const T *row = src + (long)m_width*(y + (long)m_height*z);
+                    for(int lx=0; lx<VOLUME_BRICK_STRIDE; lx++, out++) {
+                        int x = bx*VOLUME_BRICK_SIZE + lx - 1;
+                        dst[out] = (rowInside && x >= 0 && x < m_width)?row[x]:T();
+                    }
+                }
+            }
+}
+
+inline float BrickLayout::sampleTrilinear(const float *bricks, float u, float v, float w) const
+{
+    float fu = floorf(u), fv = floorf(v), fw = floorf(w);
+    int x = fu, y = fv, z = fw;
+    if(!footprintInside(x, y, z)) return 0.0;
+    float fx = u - fu, fy = v - fv, fz = w - fw;
+    const float *p = bricks + index(x, y, z);
+    const int sy = VOLUME_BRICK_STRIDE, sz = VOLUME_BRICK_STRIDE*VOLUME_BRICK_STRIDE;
+    float c00 = p[0] + fx*(p[1] - p[0]);
+    float c10 = p[sy] + fx*(p[sy + 1] - p[sy]);
+    float c01 = p[sz] + fx*(p[sz + 1] - p[sz]);
+    float c11 = p[sz + sy] + fx*(p[sz + sy + 1] - p[sz + sy]);
+    float c0 = c00 + fy*(c10 - c00);
+    float c1 = c01 + fy*(c11 - c01);
+    return c0 + fz*(c1 - c0);
+}
+
+inline float BrickLayout::sampleNearest(const float *bricks, float u, float v, float w) const
+{
+    int x = floorf(u), y = floorf(v), z = floorf(w);
+    if(x < 0 || y < 0 || z < 0 || x >= m_width || y >= m_height || z >= m_depth) return 0.0;
+    return bricks[index(x, y, z)];
+}
+
+#endif // BRICKLAYOUT_H
@@ -0,0 +1,201 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "camera.h"
+#include "defines.h"
+
+#include <math.h>
+
+float dot(Vec3 const &a, Vec3 const &b)
+{
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+Vec3 cross(Vec3 const &a, Vec3 const &b)
+{
+    return Vec3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+}
+
+float length(Vec3 const &v)
+{
+    return sqrtf(dot(v, v));
+}
+
+Vec3 normalize(Vec3 const &v)
+{
+    float len = length(v);
+    return (len > 0.0)?v*(1.0f/len):v;
+}
+
+Mat4::Mat4()
+{
+    for(int i=0; i<16; i++) m[i] = (i%5 == 0)?1.0:0.0;
+}
+
+Mat4::Mat4(const float *columnMajor)
+{
+    for(int i=0; i<16; i++) m[i] = columnMajor[i];
+}
+
+Mat4 Mat4::operator*(Mat4 const &b) const
+{
+    Mat4 r;
+    for(int row=0; row<4; row++)
+        for(int col=0; col<4; col++) {
+            float sum = 0.0;
+            for(int k=0; k<4; k++) sum += (*this)(row, k)*b(k, col);
+            r(row, col) = sum;
+        }
+    return r;
+}
+
+Vec3 Mat4::transformPoint(Vec3 const &p) const
+{
+    float x = m[0]*p.x + m[4]*p.y + m[8]*p.z + m[12];
+    float y = m[1]*p.x + m[5]*p.y + m[9]*p.z + m[13];
+    float z = m[2]*p.x + m[6]*p.y + m[10]*p.z + m[14];
+    float w = m[3]*p.x + m[7]*p.y + m[11]*p.z + m[15];
+    if(w != 0.0 && w != 1.0) return Vec3(x/w, y/w, z/w);
+    return Vec3(x, y, z);
+}
+
+Vec3 Mat4::transformVector(Vec3 const &v) const
+{
+    return Vec3(m[0]*v.x + m[4]*v.y + m[8]*v.z,
+                m[1]*v.x + m[5]*v.y + m[9]*v.z,
+                m[2]*v.x + m[6]*v.y + m[10]*v.z);
+}
+
+Mat4 Mat4::inverted() const
+{
+    //Cofactor expansion (as in the MESA GLU implementation)
+    float inv[16];
+    inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+    inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+    inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+    inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+    inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+    inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+    inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+    inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+    inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+    inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+    inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+    inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+    inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+    inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+    inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+    inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+    float det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+    if(det == 0.0) return Mat4();
+    for(int i=0; i<16; i++) inv[i] /= det;
+    return Mat4(inv);
+}
+
+Mat4 Mat4::lookAt(Vec3 const &eye, Vec3 const &center, Vec3 const &up)
+{
+    Vec3 f = normalize(center - eye);
+    Vec3 s = normalize(cross(f, up));
+    Vec3 u = cross(s, f);
+    Mat4 r;
+    r(0, 0) = s.x; r(0, 1) = s.y; r(0, 2) = s.z;
+    r(1, 0) = u.x; r(1, 1) = u.y; r(1, 2) = u.z;
+    r(2, 0) = -f.x; r(2, 1) = -f.y; r(2, 2) = -f.z;
+    r(0, 3) = -dot(s, eye);
+    r(1, 3) = -dot(u, eye);
+    r(2, 3) = dot(f, eye);
+    return r;
+}
+
+Mat4 Mat4::perspective(float fovyDegrees, float aspect, float nearPlane, float farPlane)
+{
+    //Same convention as QMatrix4x4::perspective()
+    float f = 1.0/tan(fovyDegrees*M_PI/360.0);
+    Mat4 r;
+    r(0, 0) = f/aspect;
+    r(1, 1) = f;
+    r(2, 2) = -(nearPlane + farPlane)/(farPlane - nearPlane);
+    r(2, 3) = -(2.0*nearPlane*farPlane)/(farPlane - nearPlane);
+    r(3, 2) = -1.0;
+    r(3, 3) = 0.0;
+    return r;
+}
+
+Mat4 Mat4::rotation(float angleDegrees, Vec3 const &axis)
+{
+    Vec3 a = normalize(axis);
+    float c = cos(angleDegrees*M_PI/180.0);
+    float s = sin(angleDegrees*M_PI/180.0);
+    float t = 1.0 - c;
+    Mat4 r;
+    r(0, 0) = t*a.x*a.x + c;     r(0, 1) = t*a.x*a.y - s*a.z; r(0, 2) = t*a.x*a.z + s*a.y;
+    r(1, 0) = t*a.x*a.y + s*a.z; r(1, 1) = t*a.y*a.y + c;     r(1, 2) = t*a.y*a.z - s*a.x;
+    r(2, 0) = t*a.x*a.z - s*a.y; r(2, 1) = t*a.y*a.z + s*a.x; r(2, 2) = t*a.z*a.z + c;
+    return r;
+}
+
+Mat4 Mat4::scale(float s)
+{
+    Mat4 r;
+    r(0, 0) = r(1, 1) = r(2, 2) = s;
+    return r;
+}
+
+Vec3 volumeBoundingBox(int width, int height, int depth, float spacingX, float spacingY, float spacingZ)
+{
+    float maxdim = fmax(width, fmax(height, depth));
+    //Spacing is usually 1, but can be different in a certain dimension
+    return Vec3(spacingX, spacingY, spacingZ)*Vec3(width/maxdim, height/maxdim, depth/maxdim);
+}
+
+bool sameProportions(Vec3 const &extent, Vec3 const &otherExtent)
+{
+    float lo = 1e30, hi = 0.0;
+    for(int a=0; a<3; a++) {
+        float ratio = otherExtent[a]/extent[a];
+        lo = fmin(lo, ratio);
+        hi = fmax(hi, ratio);
+    }
+    return hi - lo <= CHANNEL_EXTENT_TOLERANCE*hi;
+}
+
+Camera::Camera()
+{
+    m_azimuth = 0.0;
+    m_elevation = 0.0;
+    m_distance = 2.5; //TrackBall::reset()
+    m_fovy = 45.0; //GLWidget::resizeGL()
+}
+
+Mat4 Camera::viewMatrix() const
+{
+    Mat4 view = Mat4::lookAt(Vec3(0, 0, m_distance), Vec3(0, 0, 0), Vec3(0, 1, 0));
+    return view*Mat4::rotation(m_elevation, Vec3(1, 0, 0))*Mat4::rotation(m_azimuth, Vec3(0, 1, 0));
+}
+
+Mat4 Camera::projectionMatrix(float aspect) const
+{
+    return Mat4::perspective(m_fovy, aspect, 0.0, 1000.0);
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+// Minimal vector/matrix math shared by the GL and CPU renderers, kept free of Qt so that headless tools and
+// kernels can use it. Matrices are column-major, as expected by OpenGL (and QMatrix4x4::constData()).
+
+struct Vec3 {
+    float x, y, z;
+    Vec3() : x(0), y(0), z(0) {}
+    Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    Vec3 operator+(Vec3 const &v) const { return Vec3(x + v.x, y + v.y, z + v.z);}
+    Vec3 operator-(Vec3 const &v) const { return Vec3(x - v.x, y - v.y, z - v.z);}
+    Vec3 operator*(float s) const { return Vec3(x*s, y*s, z*s);}
+    Vec3 operator*(Vec3 const &v) const { return Vec3(x*v.x, y*v.y, z*v.z);}
+    Vec3 operator/(Vec3 const &v) const { return Vec3(x/v.x, y/v.y, z/v.z);}
+    Vec3 operator-() const { return Vec3(-x, -y, -z);}
+    float operator[](int i) const { return (&x)[i];}
+    float& operator[](int i) { return (&x)[i];}
+};
+
+float dot(Vec3 const &a, Vec3 const &b);
+Vec3 cross(Vec3 const &a, Vec3 const &b);
+float length(Vec3 const &v);
+Vec3 normalize(Vec3 const &v);
+
+class Mat4
+{
+public:
+    Mat4(); // Identity
+    explicit Mat4(const float *columnMajor);
+    float operator()(int row, int col) const { return m[col*4 + row];}
+    float& operator()(int row, int col) { return m[col*4 + row];}
+    const float* data() const { return m;}
+    Mat4 operator*(Mat4 const &b) const;
+    Vec3 transformPoint(Vec3 const &p) const; // Includes the perspective divide
+    Vec3 transformVector(Vec3 const &v) const; // Ignores translation
+    Mat4 inverted() const;
+
+    static Mat4 lookAt(Vec3 const &eye, Vec3 const &center, Vec3 const &up);
+    static Mat4 perspective(float fovyDegrees, float aspect, float nearPlane, float farPlane);
+    static Mat4 rotation(float angleDegrees, Vec3 const &axis);
+    static Mat4 scale(float s);
+
+private:
+    float m[16];
+};
+
+//Extent of a volume in world space: the longest side spans [-0.5, 0.5], scaled by the voxel spacing
+Vec3 volumeBoundingBox(int width, int height, int depth, float spacingX, float spacingY, float spacingZ);
+//Whether volumes of these physical extents (size*spacing) have the same proportions, to within CHANNEL_EXTENT_TOLERANCE:
+//then one can be sampled as a channel at the other's texture coordinates
+bool sameProportions(Vec3 const &extent, Vec3 const &otherExtent);
+
+// Orbit camera matching the GUI trackball: the camera sits on the +Z axis looking at the volume centre and the
+// volume is rotated by azimuth (about Y) and then elevation (about X).
+struct Camera {
+    float m_azimuth; // Degrees
+    float m_elevation; // Degrees
+    float m_distance;
+    float m_fovy; // Degrees
+    Camera();
+    Mat4 viewMatrix() const;
+    Mat4 projectionMatrix(float aspect) const;
+};
+
+#endif // CAMERA_H
@@ -0,0 +1,574 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "cpuraycaster.h"
+#include "bluenoise.h"
+#include "workstealingpool.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#define SHININESS_SQUARINGS 7 // Specular exponent 128 = 2^7, as SHININESS in cube.fs
+
+CPURaycaster::CPURaycaster()
+{
+    m_data = NULL;
+    m_normals = NULL;
+    m_width = m_height = m_depth = 0;
+    m_interpolationType = InterpolationTrilinear;
+    m_layoutType = VolumeLayoutBricked;
+    m_bricks = NULL;
+    m_brickedNormals = NULL;
+    m_useSIMD = true;
+    m_threadCount = 0;
+    m_pool = NULL;
+    m_tf = new float[4*TF1D_SIZE];
+    memset(m_tf, 0, 4*TF1D_SIZE*sizeof(float));
+    memset(m_tfColors, 0, sizeof(m_tfColors));
+    m_channels = new CPURaycastChannel[VOLUME_MAX_CHANNELS - 1];
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) m_channels[i].m_data = NULL;
+
+    //The GL noise texture, as normalized R8 values
+    m_noise = new float[BLUE_NOISE_SIZE*BLUE_NOISE_SIZE];
+    const unsigned char *noise = blueNoiseTexture();
+    for(int i=0; i<BLUE_NOISE_SIZE*BLUE_NOISE_SIZE; i++) m_noise[i] = noise[i]/255.0;
+    m_jitterFrame = 0;
+}
+
+CPURaycaster::~CPURaycaster()
+{
+    delete m_pool;
+    delete []m_bricks;
+    delete []m_brickedNormals;
+    delete []m_tf;
+    delete []m_channels;
+    delete []m_noise;
+}
+
+void CPURaycaster::setVolume(int width, int height, int depth, const float *data, float spacingX, float spacingY, float spacingZ)
+{
+    m_width = width;
+    m_height = height;
+    m_depth = depth;
+    m_data = data;
+    m_normals = NULL;
+    delete []m_bricks;
+    delete []m_brickedNormals;
+    m_bricks = NULL;
+    m_brickedNormals = NULL;
+    m_layout.setup(width, height, depth);
+    m_bbox = volumeBoundingBox(width, height, depth, spacingX, spacingY, spacingZ);
+    m_extent = Vec3(width*spacingX, height*spacingY, depth*spacingZ);
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) m_channels[i].m_data = NULL; //Registered to the previous volume
+}
+
+void CPURaycaster::setTransferFunction(const unsigned char *colorBuffer)
+{
+    for(int i=0; i<TF1D_SIZE; i++)
+        for(int c=0; c<4; c++)
+            m_tf[c*TF1D_SIZE + i] = colorBuffer[4*i + c]/255.0;
+    memcpy(m_tfColors, colorBuffer, sizeof(m_tfColors));
+}
+
+bool CPURaycaster::setChannel(int channel, int width, int height, int depth, const float *data, float spacingX,
+                              float spacingY, float spacingZ, bool nearest)
+{
+    if(channel < 1 || channel >= VOLUME_MAX_CHANNELS || !hasVolume()) {
+        fprintf(stderr, "Invalid channel %d\n", channel);
+        return false;
+    }
+    if(data && !sameProportions(m_extent, Vec3(width*spacingX, height*spacingY, depth*spacingZ))) {
+        fprintf(stderr, "Channel %d does not span the volume's extent. Ignoring...\n", channel);
+        return false;
+    }
+    CPURaycastChannel &c = m_channels[channel - 1];
+    c.m_data = data;
+    c.m_width = width;
+    c.m_height = height;
+    c.m_depth = depth;
+    c.m_nearest = nearest;
+    c.m_enabled = true;
+    memset(c.m_tf, 0, sizeof(c.m_tf)); //Transparent until its TF is set
+    return true;
+}
+
+void CPURaycaster::setChannelTransferFunction(int channel, const unsigned char *colorBuffer)
+{
+    if(channel < 1 || channel >= VOLUME_MAX_CHANNELS) return;
+    float *tf = m_channels[channel - 1].m_tf;
+    for(int i=0; i<TF1D_SIZE; i++)
+        for(int c=0; c<4; c++)
+            tf[c*TF1D_SIZE + i] = colorBuffer[4*i + c]/255.0;
+}
+
+void CPURaycaster::enableChannel(int channel, bool flag)
+{
+    if(channel >= 1 && channel < VOLUME_MAX_CHANNELS) m_channels[channel - 1].m_enabled = flag;
+}
+
+unsigned int CPURaycaster::channelMask() const
+{
+    unsigned int mask = 0;
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++)
+        if(m_channels[i].m_data && m_channels[i].m_enabled) mask |= 1u << i;
+    return mask;
+}
+
+void CPURaycaster::setNormals(const unsigned char *normals)
+{
+    m_normals = normals;
+    delete []m_brickedNormals;
+    m_brickedNormals = NULL;
+}
+
+void CPURaycaster::setInterpolationType(RaycastingInterpolationType type)
+{
+    if(type == InterpolationNearestNeighbour || type == InterpolationTrilinear || type == Interpolationcubic)
+        m_interpolationType = type;
+    else
+        fprintf(stderr, "Unknown texture interpolation mode. Ignoring...\n");
+}
+
+void CPURaycaster::setThreadCount(int threadCount)
+{
+    if(threadCount == m_threadCount) return;
+    m_threadCount = threadCount;
+    delete m_pool;
+    m_pool = NULL;
+    m_preintegratedTF.setThreadCount(threadCount);
+}
+
+//Swizzles whatever is missing into bricks, one z slab of bricks per pool task
+void CPURaycaster::updateBricks()
+{
+    bool volume = (m_data && !m_bricks);
+    bool normals = (m_normals && !m_brickedNormals);
+    if(!volume && !normals) return;
+    ScopedSpan span("cpu.swizzle");
+    if(volume) m_bricks = new float[m_layout.size()];
+    if(normals) m_brickedNormals = new unsigned int[m_layout.size()];
+    m_pool->run(m_layout.bricksZ(), [&](int bz) {
+        if(volume) m_layout.swizzleSlab(m_data, m_bricks, bz);
+        if(normals) m_layout.swizzleSlab((const unsigned int*)m_normals, m_brickedNormals, bz);
+    });
+}
+
+bool CPURaycaster::isSIMDSupported()
+{
+#if defined(BLAZE_AVX2_KERNEL) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+void CPURaycaster::render(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params,
+                          int width, int height, unsigned char *rgba)
+{
+    ScopedSpan span("cpu.raycast");
+    span.setBytes(4LL*width*height);
+    if(!m_pool) m_pool = new WorkStealingPool(m_threadCount);
+
+    CPURaycastFrame frame;
+    frame.m_data = m_data;
+    frame.m_normals = m_normals;
+    frame.m_layout = NULL;
+    frame.m_bricks = NULL;
+    frame.m_brickedNormals = NULL;
+    if(m_layoutType == VolumeLayoutBricked && m_data) {
+        updateBricks();
+        frame.m_layout = &m_layout;
+        frame.m_bricks = m_bricks;
+        frame.m_brickedNormals = m_brickedNormals;
+    }
+    frame.m_width = m_width;
+    frame.m_height = m_height;
+    frame.m_depth = m_depth;
+    frame.m_nearest = (m_interpolationType == InterpolationNearestNeighbour);
+    frame.m_cubic = (m_interpolationType == Interpolationcubic);
+    frame.m_bbox = m_bbox;
+    frame.m_tf = m_tf;
+    frame.m_preintegrated = NULL;
+    if(params.m_preintegrated) { //Recomputes only what the last TF edit touched
+        m_preintegratedTF.update(m_tfColors);
+        frame.m_preintegrated = m_preintegratedTF.table();
+    }
+    unsigned int channels = channelMask();
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) frame.m_channels[i] = (channels & (1u << i))?&m_channels[i]:NULL;
+    frame.m_noise = m_noise;
+    frame.m_noisePhase = fmod(m_jitterFrame*BLUE_NOISE_FRAME_STEP, 1.0); //Animated as in GLRaycaster
+    if(params.m_useJittering) m_jitterFrame++;
+    frame.m_invView = view.inverted();
+    frame.m_eye = frame.m_invView.transformPoint(Vec3(0, 0, 0));
+    frame.m_invProjX = 1.0/projection(0, 0);
+    frame.m_invProjY = 1.0/projection(1, 1);
+    frame.m_imageWidth = width;
+    frame.m_imageHeight = height;
+    frame.m_params = params;
+    if(!m_normals) frame.m_params.m_performPhongShading = false;
+
+    int tilesX = (width + CPU_RAYCAST_TILE_SIZE - 1)/CPU_RAYCAST_TILE_SIZE;
+    int tilesY = (height + CPU_RAYCAST_TILE_SIZE - 1)/CPU_RAYCAST_TILE_SIZE;
+    m_pool->run(tilesX*tilesY, [&](int tile) {
+        renderTile(frame, tile%tilesX, tile/tilesX, rgba);
+    });
+}
+
+static inline unsigned char toUnorm8(float v)
+{
+    if(v <= 0.0) return 0;
+    if(v >= 1.0) return 255;
+    return (unsigned char)(v*255.0 + 0.5);
+}
+
+void CPURaycaster::renderTile(CPURaycastFrame const &frame, int tileX, int tileY, unsigned char *rgba) const
+{
+    bool simd = usesSIMD();
+    int x0 = tileX*CPU_RAYCAST_TILE_SIZE;
+    int y0 = tileY*CPU_RAYCAST_TILE_SIZE;
+    int x1 = std::min(x0 + CPU_RAYCAST_TILE_SIZE, frame.m_imageWidth);
+    int y1 = std::min(y0 + CPU_RAYCAST_TILE_SIZE, frame.m_imageHeight);
+
+    const int N = CPU_RAYCAST_PACKET_SIZE;
+    float position[3*N], dir[3*N], deltaT[N], color[4*N];
+    for(int row=y0; row<y1; row++) {
+        int py = frame.m_imageHeight - 1 - row; //Image rows are top-down, GL pixels bottom-up
+        for(int x=x0; x<x1; x+=N) {
+            int n = std::min(N, x1 - x);
+            int activeMask = 0;
+            for(int i=0; i<n; i++) {
+                Vec3 p, d;
+                float dt;
+                if(!setupRay(frame, x + i, py, p, d, dt)) continue;
+                activeMask |= 1 << i;
+                for(int c=0; c<3; c++) {
+                    position[c*N + i] = p[c];
+                    dir[c*N + i] = d[c];
+                }
+                deltaT[i] = dt;
+            }
+
+            if(simd) {
+                if(activeMask) marchPacketAVX2(frame, position, dir, deltaT, activeMask, color);
+            } else {
+                for(int i=0; i<n; i++) {
+                    if(!(activeMask & (1 << i))) continue;
+                    float c[4];
+                    marchRay(frame, Vec3(position[i], position[N + i], position[2*N + i]),
+                            Vec3(dir[i], dir[N + i], dir[2*N + i]), deltaT[i], c);
+                    for(int k=0; k<4; k++) color[k*N + i] = c[k];
+                }
+            }
+
+            //Blend over the white background: GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+            for(int i=0; i<n; i++) {
+                unsigned char *pixel = rgba + 4*((long)row*frame.m_imageWidth + x + i);
+                if(!(activeMask & (1 << i))) {
+                    pixel[0] = pixel[1] = pixel[2] = pixel[3] = 255;
+                    continue;
+                }
+                float a = color[3*N + i];
+                for(int k=0; k<3; k++) pixel[k] = toUnorm8(color[k*N + i]*a + (1.0 - a));
+                pixel[3] = toUnorm8(a*a + (1.0 - a));
+            }
+        }
+    }
+}
+
+bool setupRay(CPURaycastFrame const &frame, int px, int py, Vec3 &position, Vec3 &dir, float &deltaT)
+{
+    //Eye space direction through the pixel centre, then world space
+    float ndcX = 2.0*(px + 0.5)/frame.m_imageWidth - 1.0;
+    float ndcY = 2.0*(py + 0.5)/frame.m_imageHeight - 1.0;
+    Vec3 eye = frame.m_eye;
+    dir = normalize(frame.m_invView.transformVector(Vec3(ndcX*frame.m_invProjX, ndcY*frame.m_invProjY, -1.0)));
+
+    //Entry through a front face (slab test), or at the eye when it is inside the volume
+    float tNear = -1e30, tFar = 1e30;
+    for(int a=0; a<3; a++) {
+        float half = frame.m_bbox[a]*0.5;
+        if(dir[a] == 0.0) {
+            if(eye[a] < -half || eye[a] > half) return false;
+            continue;
+        }
+        float t1 = (-half - eye[a])/dir[a];
+        float t2 = (half - eye[a])/dir[a];
+        tNear = fmax(tNear, fmin(t1, t2));
+        tFar = fmin(tFar, fmax(t1, t2));
+    }
+    if(tNear > tFar || tFar <= 0.0) return false;
+    tNear = fmax(tNear, 0.0);
+    position = eye + dir*tNear;
+    deltaT = tFar - tNear; //Exit through a back face, as rasterized by the GL ray setup pass
+
+    if(frame.m_params.m_useJittering) { //A fraction of a step along the ray, as cube.fs
+        float jitter = frame.m_noise[(py%BLUE_NOISE_SIZE)*BLUE_NOISE_SIZE + px%BLUE_NOISE_SIZE] + frame.m_noisePhase;
+        jitter = (jitter - floor(jitter))*frame.m_params.m_stepSize;
+        position = position + dir*jitter;
+        deltaT -= jitter;
+    }
+    return true;
+}
+
+//Texel of a GL_CLAMP_TO_BORDER texture (border = 0)
+static inline float voxel(CPURaycastFrame const &f, int x, int y, int z)
+{
+    if(x < 0 || y < 0 || z < 0 || x >= f.m_width || y >= f.m_height || z >= f.m_depth) return 0.0;
+    return f.m_data[x + (long)f.m_width*(y + (long)f.m_height*z)];
+}
+
+static inline void normalTexel(CPURaycastFrame const &f, int x, int y, int z, float w, Vec3 &n, float &mag)
+{
+    if(x < 0 || y < 0 || z < 0 || x >= f.m_width || y >= f.m_height || z >= f.m_depth) return;
+    const unsigned char *t = f.m_normals + 4*(x + (long)f.m_width*(y + (long)f.m_height*z));
+    n = n + Vec3(t[0], t[1], t[2])*(w/255.0f);
+    mag += t[3]*(w/255.0f);
+}
+
+static inline void brickedNormalTexel(CPURaycastFrame const &f, long index, float w, Vec3 &n, float &mag)
+{
+    unsigned int t = f.m_brickedNormals[index];
+    n = n + Vec3(t & 0xff, (t >> 8) & 0xff, (t >> 16) & 0xff)*(w/255.0f);
+    mag += (t >> 24)*(w/255.0f);
+}
+
+//Same filtering over the bricked copy of the volume
+static float sampleBricked(CPURaycastFrame const &f, Vec3 const &tc)
+{
+    BrickLayout const &layout = *f.m_layout;
+    if(f.m_nearest) return layout.sampleNearest(f.m_bricks, tc.x*f.m_width, tc.y*f.m_height, tc.z*f.m_depth);
+    return layout.sampleTrilinear(f.m_bricks, tc.x*f.m_width - 0.5, tc.y*f.m_height - 0.5, tc.z*f.m_depth - 0.5);
+}
+
+static void sampleBrickedNormal(CPURaycastFrame const &f, Vec3 const &tc, Vec3 &normal, float &mag)
+{
+    BrickLayout const &layout = *f.m_layout;
+    normal = Vec3(0, 0, 0);
+    mag = 0.0;
+    if(f.m_nearest) {
+        int x = floorf(tc.x*f.m_width), y = floorf(tc.y*f.m_height), z = floorf(tc.z*f.m_depth);
+        if(x >= 0 && y >= 0 && z >= 0 && x < f.m_width && y < f.m_height && z < f.m_depth)
+            brickedNormalTexel(f, layout.index(x, y, z), 1.0, normal, mag);
+        return;
+    }
+    float u = tc.x*f.m_width - 0.5, v = tc.y*f.m_height - 0.5, w = tc.z*f.m_depth - 0.5;
+    int x = floorf(u), y = floorf(v), z = floorf(w);
+    if(!layout.footprintInside(x, y, z)) return;
+    float fx = u - x, fy = v - y, fz = w - z;
+    long base = layout.index(x, y, z);
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        float weight = (dx?fx:1 - fx)*(dy?fy:1 - fy)*(dz?fz:1 - fz);
+        brickedNormalTexel(f, base + dx + VOLUME_BRICK_STRIDE*(dy + VOLUME_BRICK_STRIDE*dz), weight, normal, mag);
+    }
+}
+
+//GL_LINEAR lookup of the linear layout at texel coordinates (u, v, w) = tc*size - 0.5
+static inline float trilinear(CPURaycastFrame const &f, float u, float v, float w)
+{
+    int x = floorf(u), y = floorf(v), z = floorf(w);
+    float fx = u - x, fy = v - y, fz = w - z;
+    float value = 0.0;
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        value += (dx?fx:1 - fx)*(dy?fy:1 - fy)*(dz?fz:1 - fz)*voxel(f, x + dx, y + dy, z + dz);
+    }
+    return value;
+}
+
+//B-spline tricubic scalar from 8 trilinear lookups, as sample_volume() in cube.fs
+static float sampleCubic(CPURaycastFrame const &f, Vec3 const &tc)
+{
+    float h[3][2], g[3][2];
+    const int size[3] = {f.m_width, f.m_height, f.m_depth};
+    for(int a=0; a<3; a++) {
+        cubicBSplineFetches(tc[a], size[a], h[a][0], h[a][1], g[a][0]);
+        g[a][1] = 1.0f - g[a][0];
+    }
+    float value = 0.0;
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        float u = h[0][dx], v = h[1][dy], w = h[2][dz];
+        float texel = f.m_layout?f.m_layout->sampleTrilinear(f.m_bricks, u, v, w):trilinear(f, u, v, w);
+        value += g[0][dx]*g[1][dy]*g[2][dz]*texel;
+    }
+    return value;
+}
+
+//Scalar at texture coordinate tc, filtered like the GL texture
+static float sample(CPURaycastFrame const &f, Vec3 const &tc)
+{
+    if(f.m_layout) return sampleBricked(f, tc);
+    if(f.m_nearest) return voxel(f, floorf(tc.x*f.m_width), floorf(tc.y*f.m_height), floorf(tc.z*f.m_depth));
+    return trilinear(f, tc.x*f.m_width - 0.5, tc.y*f.m_height - 0.5, tc.z*f.m_depth - 0.5);
+}
+
+//Encoded normal and gradient magnitude at texture coordinate tc, always trilinear or nearest like the GL texture
+static void sampleNormal(CPURaycastFrame const &f, Vec3 const &tc, Vec3 &normal, float &mag)
+{
+    if(f.m_layout) {
+        sampleBrickedNormal(f, tc, normal, mag);
+        return;
+    }
+    normal = Vec3(0, 0, 0);
+    mag = 0.0;
+    if(f.m_nearest) {
+        normalTexel(f, floorf(tc.x*f.m_width), floorf(tc.y*f.m_height), floorf(tc.z*f.m_depth), 1.0, normal, mag);
+        return;
+    }
+    float u = tc.x*f.m_width - 0.5, v = tc.y*f.m_height - 0.5, w = tc.z*f.m_depth - 0.5;
+    int x = floorf(u), y = floorf(v), z = floorf(w);
+    float fx = u - x, fy = v - y, fz = w - z;
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        normalTexel(f, x + dx, y + dy, z + dz, (dx?fx:1 - fx)*(dy?fy:1 - fy)*(dz?fz:1 - fz), normal, mag);
+    }
+}
+
+//GL_LINEAR or GL_NEAREST lookup of a channel (GL_CLAMP_TO_BORDER) at texture coordinate tc
+static float sampleChannel(CPURaycastChannel const &c, Vec3 const &tc)
+{
+    float u = tc.x*c.m_width, v = tc.y*c.m_height, w = tc.z*c.m_depth;
+    if(!c.m_nearest) {
+        u -= 0.5;
+        v -= 0.5;
+        w -= 0.5;
+    }
+    int x = floorf(u), y = floorf(v), z = floorf(w);
+    float fx = u - x, fy = v - y, fz = w - z;
+    float value = 0.0;
+    for(int k=0; k<(c.m_nearest?1:8); k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        int vx = x + dx, vy = y + dy, vz = z + dz;
+        if(vx < 0 || vy < 0 || vz < 0 || vx >= c.m_width || vy >= c.m_height || vz >= c.m_depth) continue;
+        float weight = c.m_nearest?1.0f:(dx?fx:1 - fx)*(dy?fy:1 - fy)*(dz?fz:1 - fz);
+        value += weight*c.m_data[vx + (long)c.m_width*(vy + (long)c.m_height*vz)];
+    }
+    return value;
+}
+
+//GL_LINEAR lookup into a 1D TF texture (GL_CLAMP_TO_BORDER), tf as CPURaycastFrame::m_tf
+static void classify(const float *tf, float value, float *rgba)
+{
+    float u = value*TF1D_SIZE - 0.5;
+    int i = floorf(u);
+    float frac = u - i;
+    for(int c=0; c<4; c++) {
+        const float *table = tf + c*TF1D_SIZE;
+        float t0 = (i >= 0 && i < TF1D_SIZE)?table[i]:0.0;
+        float t1 = (i + 1 >= 0 && i + 1 < TF1D_SIZE)?table[i + 1]:0.0;
+        rgba[c] = t0*(1 - frac) + t1*frac;
+    }
+}
+
+//GL_LINEAR lookup into the pre-integrated table (GL_CLAMP_TO_EDGE)
+static void classifySegment(CPURaycastFrame const &f, float front, float back, float *rgba)
+{
+    float u = front*TF1D_SIZE - 0.5, v = back*TF1D_SIZE - 0.5;
+    int i = floorf(u), j = floorf(v);
+    float fu = u - i, fv = v - j;
+    int i0 = std::min(std::max(i, 0), TF1D_SIZE - 1), i1 = std::min(std::max(i + 1, 0), TF1D_SIZE - 1);
+    int j0 = std::min(std::max(j, 0), TF1D_SIZE - 1), j1 = std::min(std::max(j + 1, 0), TF1D_SIZE - 1);
+    const float *t00 = f.m_preintegrated + 4*(j0*TF1D_SIZE + i0), *t10 = f.m_preintegrated + 4*(j0*TF1D_SIZE + i1);
+    const float *t01 = f.m_preintegrated + 4*(j1*TF1D_SIZE + i0), *t11 = f.m_preintegrated + 4*(j1*TF1D_SIZE + i1);
+    for(int c=0; c<4; c++) {
+        float a = t00[c] + fu*(t10[c] - t00[c]);
+        float b = t01[c] + fu*(t11[c] - t01[c]);
+        rgba[c] = a + fv*(b - a);
+    }
+}
+
+//Fuses the classified channels into sample s, as fuse_channels() in cube.fs
+static void fuseChannels(CPURaycastFrame const &f, Vec3 const &tc, float *s)
+{
+    float alphaSum = s[3], transparency = 1.0 - s[3];
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) {
+        if(!f.m_channels[i]) continue;
+        float c[4];
+        classify(f.m_channels[i]->m_tf, sampleChannel(*f.m_channels[i], tc), c);
+        for(int k=0; k<3; k++) s[k] += c[k];
+        alphaSum += c[3];
+        transparency *= 1.0 - c[3];
+    }
+    float alpha = 1.0 - transparency;
+    float scale = (alphaSum > 0.0)?alpha/alphaSum:0.0;
+    for(int k=0; k<3; k++) s[k] *= scale;
+    s[3] = alpha;
+}
+
+void marchRay(CPURaycastFrame const &frame, Vec3 position, Vec3 dir, float deltaT, float *color)
+{
+    RaycastParameters const &params = frame.m_params;
+    Vec3 deltaDir = dir*params.m_stepSize;
+    Vec3 lightPos = frame.m_eye; //Headlight
+    Vec3 invBBox(1.0/frame.m_bbox.x, 1.0/frame.m_bbox.y, 1.0/frame.m_bbox.z);
+    color[0] = color[1] = color[2] = color[3] = 0.0;
+
+    float value, s[4], mag = 0.0;
+    float front = -1.0; //Pre-integration: no front sample yet, the first segment is a point sample
+    bool wantNormal = frame.m_normals && (params.m_performPhongShading || params.m_gradientOpacity > 0.0);
+    bool channels = false;
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) channels = channels || frame.m_channels[i];
+    Vec3 normal;
+    for(float t = 0; t < deltaT; t += params.m_stepSize) { //Front to back
+        Vec3 tc = position*invBBox + Vec3(0.5, 0.5, 0.5);
+        value = frame.m_cubic?sampleCubic(frame, tc):sample(frame, tc);
+        if(frame.m_preintegrated) {
+            classifySegment(frame, (front < 0.0)?value:front, value, s);
+            front = value;
+        } else
+            classify(frame.m_tf, value, s);
+        if(channels) fuseChannels(frame, tc, s); //Channels are point sampled
+        if(wantNormal && s[3] > 0.0) sampleNormal(frame, tc, normal, mag); //Normals stay trilinear with cubic
+        if(params.m_gradientOpacity > 0.0 && s[3] > 0.0) { //Emphasize boundaries over homogeneous regions
+            float scale = 1.0 + params.m_gradientOpacity*(mag - 1.0);
+            for(int c=0; c<4; c++) s[c] *= scale;
+        }
+        if(params.m_opacityCorrection != 1.0 && s[3] > 0.0) { //Keep the look of the configured step size
+            float alpha = 1.0 - powf(1.0 - fmin(s[3], 0.999), params.m_opacityCorrection);
+            float scale = alpha/s[3];
+            for(int c=0; c<4; c++) s[c] *= scale;
+        }
+        if(params.m_performPhongShading && s[3] > 0.0) {
+            if(mag > CPU_RAYCAST_MIN_GRADIENT && t > params.m_stepSize) {
+                Vec3 n = normalize(normal*2.0 - Vec3(1, 1, 1)); //Interpolation shortens the unit normals
+                Vec3 lightVec = normalize(lightPos - position);
+                float ndotl = dot(n, lightVec);
+                float diffuse = fmin(fabs(ndotl), 1.0); //Two-sided lighting
+                Vec3 reflected = n*(2.0*ndotl) - lightVec;
+                float specular = fmax(dot(-dir, reflected), 0.0);
+                for(int k=0; k<SHININESS_SQUARINGS; k++) specular *= specular;
+                specular = fmin(specular, 1.0);
+                for(int c=0; c<3; c++) s[c] = s[c]*diffuse + specular;
+            }
+        }
+        if(s[3] > 0.0)
+            for(int c=0; c<4; c++) color[c] += (1.0 - color[3])*s[c];
+        if(color[3] > 0.95) break; //Early ray termination
+        position = position + deltaDir;
+    }
+}
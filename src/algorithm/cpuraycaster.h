@@ -0,0 +1,155 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef CPURAYCASTER_H
+#define CPURAYCASTER_H
+
+#include <cstddef>
+#include <math.h>
+
+#include "camera.h"
+#include "bricklayout.h"
+#include "transferfunction1d.h"
+#include "preintegratedtf.h"
+#include "defines.h"
+
+class WorkStealingPool;
+
+#define CPU_RAYCAST_TILE_SIZE 32 // Tile edge in pixels; one pool task per tile
+#define CPU_RAYCAST_PACKET_SIZE 8 // Rays per SIMD packet
+#define CPU_RAYCAST_MIN_GRADIENT 0.1 // Samples of a lower relative gradient magnitude stay unshaded, as in cube.fs
+
+// A co-registered channel, sampled at the volume's texture coordinates and classified by its own TF
+struct CPURaycastChannel {
+    const float *m_data; // Normalized scalars, x fastest; NULL if the channel is not set. Not copied
+    int m_width, m_height, m_depth;
+    bool m_nearest; // Label volumes: no interpolation
+    bool m_enabled;
+    float m_tf[4*TF1D_SIZE]; // Planar like CPURaycastFrame::m_tf
+};
+
+// Everything the ray kernels need for one frame
+struct CPURaycastFrame {
+    const float *m_data; // Normalized scalars, x fastest
+    const unsigned char *m_normals; // RGBA8 encoded normals and gradient magnitude (encodeNormals()), NULL if not available
+    const BrickLayout *m_layout; // Set if the volume is sampled from bricks instead of m_data/m_normals
+    const float *m_bricks;
+    const unsigned int *m_brickedNormals; // RGBA8 packed in 32 bits
+    int m_width, m_height, m_depth;
+    bool m_nearest;
+    bool m_cubic; // B-spline tricubic scalars; normals stay trilinear as in cube.fs
+    Vec3 m_bbox;
+    const float *m_tf; // Planar R, G, B, A tables of TF1D_SIZE entries in [0, 1]
+    const float *m_preintegrated; // PreintegratedTF::table() if the frame classifies segments, else NULL
+    const CPURaycastChannel *m_channels[VOLUME_MAX_CHANNELS - 1]; // Enabled channels, NULL for the others
+    const float *m_noise; // Blue noise, BLUE_NOISE_SIZE^2
+    float m_noisePhase;
+    Vec3 m_eye;
+    Mat4 m_invView;
+    float m_invProjX, m_invProjY; // Eye space ray slope per unit NDC
+    int m_imageWidth, m_imageHeight;
+    RaycastParameters m_params;
+};
+
+//Ray through the centre of pixel (px, py), py counted bottom-up like gl_FragCoord. Returns false if the ray does not
+//enter the volume through a front face (i.e., the GL raycaster would not rasterize this pixel).
+bool setupRay(CPURaycastFrame const &frame, int px, int py, Vec3 &position, Vec3 &dir, float &deltaT);
+//Cubic B-spline along one axis as two linear fetches: for texture coordinate t on an axis of the given size, returns the
+//texel coordinates (tc*size - 0.5 convention) h0, h1 of the fetches and the weight g0 of the first; g1 = 1 - g0
+inline void cubicBSplineFetches(float t, int size, float &h0, float &h1, float &g0)
+{
+    float coord = t*size - 0.5f;
+    float index = floorf(coord);
+    float f = coord - index, f2 = f*f, f3 = f2*f;
+    float w0 = (1.0f - 3.0f*f + 3.0f*f2 - f3)*(1.0f/6.0f);
+    float w1 = (4.0f - 6.0f*f2 + 3.0f*f3)*(1.0f/6.0f);
+    float w3 = f3*(1.0f/6.0f);
+    g0 = w0 + w1;
+    h0 = index - 1.0f + w1/g0;
+    h1 = index + 1.0f + w3/(1.0f - g0);
+}
+//Scalar reference: the loop of shaders/cube.fs for one ray, returns the composited (associated) RGBA
+void marchRay(CPURaycastFrame const &frame, Vec3 position, Vec3 dir, float deltaT, float *rgba);
+//Same for CPU_RAYCAST_PACKET_SIZE rays at once; arrays are planar (x[8], y[8], z[8]) and rgba is r[8], g[8], ...
+void marchPacketAVX2(CPURaycastFrame const &frame, const float *position, const float *dir, const float *deltaT,
+                     int activeMask, float *rgba);
+
+// Multithreaded CPU implementation of the GL raycaster, for machines without a GPU and as a reference.
+// Tiles of the image are rendered on a work stealing pool; within a tile, rays are marched in packets of 8 with AVX2
+// when the CPU supports it. Frames with channels (see GLRaycaster) take the scalar path.
+class CPURaycaster
+{
+public:
+    CPURaycaster();
+    ~CPURaycaster();
+    void setVolume(int width, int height, int depth, const float *data, float spacingX, float spacingY, float spacingZ); // Not copied
+    void setTransferFunction(const unsigned char *colorBuffer); // 256 RGBA, alpha premultiplied
+    void setNormals(const unsigned char *normals); // RGBA8, same size as the volume. Not copied
+    void setInterpolationType(RaycastingInterpolationType type);
+    void setVolumeLayout(VolumeLayout layout) { m_layoutType = layout;} // Bricks are built on the next render
+    VolumeLayout volumeLayout() const { return m_layoutType;}
+    void setThreadCount(int threadCount); // 0: all hardware threads
+    void setUseSIMD(bool flag) { m_useSIMD = flag;}
+    bool usesSIMD() const { return m_useSIMD && isSIMDSupported() && !channelMask();} // The packet kernel has no channels
+    static bool isSIMDSupported();
+    bool hasVolume() const { return m_data != NULL;}
+    Vec3 const & bbox() const { return m_bbox;}
+
+    //Channels 1 .. VOLUME_MAX_CHANNELS - 1, as in GLRaycaster
+    bool setChannel(int channel, int width, int height, int depth, const float *data, float spacingX, float spacingY,
+                    float spacingZ, bool nearest); // Not copied
+    void setChannelTransferFunction(int channel, const unsigned char *colorBuffer);
+    void enableChannel(int channel, bool flag);
+    unsigned int channelMask() const; // Bit c - 1 for each channel that is set and enabled
+
+    //Renders width x height top-down RGBA8 pixels, composited over a white background like GLWidget
+    void render(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params,
+                int width, int height, unsigned char *rgba);
+
+private:
+    const float *m_data;
+    const unsigned char *m_normals;
+    int m_width, m_height, m_depth;
+    Vec3 m_bbox;
+    Vec3 m_extent; // Size times spacing, to check that channels are co-registered
+    RaycastingInterpolationType m_interpolationType;
+    VolumeLayout m_layoutType;
+    BrickLayout m_layout;
+    float *m_bricks;
+    unsigned int *m_brickedNormals;
+    float *m_tf;
+    unsigned char m_tfColors[4*TF1D_SIZE]; // As given, for the pre-integrated table
+    PreintegratedTF m_preintegratedTF;
+    CPURaycastChannel *m_channels; // VOLUME_MAX_CHANNELS - 1 of them
+    float *m_noise;
+    unsigned int m_jitterFrame; // Jittered frames so far, animates the noise
+    bool m_useSIMD;
+    int m_threadCount;
+    WorkStealingPool *m_pool;
+
+    void updateBricks();
+    void renderTile(CPURaycastFrame const &frame, int tileX, int tileY, unsigned char *rgba) const;
+};
+
+#endif // CPURAYCASTER_H
@@ -0,0 +1,404 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// AVX2 packet kernel of the CPU raycaster. This file alone is compiled with -mavx2 -mfma; CPURaycaster only calls
+// into it after checking the CPU at runtime.
+
+#include "cpuraycaster.h"
+
+#include <math.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+//Trilinear (or nearest) footprint of 8 sample positions: voxel indices, weights and in-volume masks of the corners
+struct Footprint {
+    int m_corners;
+    __m256i m_index[8];
+    __m256 m_weight[8];
+    __m256 m_mask[8]; // Corners outside the volume read the zero border
+};
+
+static inline __m256 insideMask(__m256i i, __m256i size)
+{
+    __m256i inside = _mm256_and_si256(_mm256_cmpgt_epi32(i, _mm256_set1_epi32(-1)), _mm256_cmpgt_epi32(size, i));
+    return _mm256_castsi256_ps(inside);
+}
+
+//Element index of voxels (x, y, z) in the bricked layout, see BrickLayout::index()
+static inline __m256i brickIndex(BrickLayout const &layout, __m256i x, __m256i y, __m256i z)
+{
+    __m256i one = _mm256_set1_epi32(1), localMask = _mm256_set1_epi32(VOLUME_BRICK_SIZE - 1);
+    x = _mm256_add_epi32(x, one);
+    y = _mm256_add_epi32(y, one);
+    z = _mm256_add_epi32(z, one);
+    __m256i brick = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(
+                        _mm256_mullo_epi32(_mm256_srli_epi32(z, VOLUME_BRICK_LOG2), _mm256_set1_epi32(layout.bricksY())),
+                        _mm256_srli_epi32(y, VOLUME_BRICK_LOG2)), _mm256_set1_epi32(layout.bricksX())),
+                        _mm256_srli_epi32(x, VOLUME_BRICK_LOG2));
+    __m256i stride = _mm256_set1_epi32(VOLUME_BRICK_STRIDE);
+    __m256i local = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(z, localMask), stride),
+                                                                         _mm256_and_si256(y, localMask)), stride),
+                                     _mm256_and_si256(x, localMask));
+    return _mm256_add_epi32(_mm256_mullo_epi32(brick, _mm256_set1_epi32(VOLUME_BRICK_ELEMENTS)), local);
+}
+
+//Bricked layout: the zero border is stored, so only footprints entirely outside the volume are masked, and the corners
+//are fixed offsets from the first one
+static void brickFootprint(CPURaycastFrame const &f, __m256 u, __m256 v, __m256 s, __m256 active, Footprint &fp)
+{
+    __m256i w = _mm256_set1_epi32(f.m_width), h = _mm256_set1_epi32(f.m_height), d = _mm256_set1_epi32(f.m_depth);
+    if(f.m_nearest) {
+        __m256i x = _mm256_cvttps_epi32(_mm256_floor_ps(u));
+        __m256i y = _mm256_cvttps_epi32(_mm256_floor_ps(v));
+        __m256i z = _mm256_cvttps_epi32(_mm256_floor_ps(s));
+        fp.m_corners = 1;
+        fp.m_mask[0] = _mm256_and_ps(active, _mm256_and_ps(insideMask(x, w), _mm256_and_ps(insideMask(y, h), insideMask(z, d))));
+        fp.m_index[0] = _mm256_and_si256(brickIndex(*f.m_layout, x, y, z), _mm256_castps_si256(fp.m_mask[0]));
+        fp.m_weight[0] = _mm256_set1_ps(1.0);
+        return;
+    }
+
+    __m256 half = _mm256_set1_ps(0.5);
+    u = _mm256_sub_ps(u, half);
+    v = _mm256_sub_ps(v, half);
+    s = _mm256_sub_ps(s, half);
+    __m256 fu = _mm256_floor_ps(u), fv = _mm256_floor_ps(v), fs = _mm256_floor_ps(s);
+    __m256 fx = _mm256_sub_ps(u, fu), fy = _mm256_sub_ps(v, fv), fz = _mm256_sub_ps(s, fs);
+    __m256 one = _mm256_set1_ps(1.0);
+    __m256 wx[2] = {_mm256_sub_ps(one, fx), fx};
+    __m256 wy[2] = {_mm256_sub_ps(one, fy), fy};
+    __m256 wz[2] = {_mm256_sub_ps(one, fz), fz};
+    __m256i x = _mm256_cvttps_epi32(fu), y = _mm256_cvttps_epi32(fv), z = _mm256_cvttps_epi32(fs);
+    __m256i minusOne = _mm256_set1_epi32(-1);
+    __m256 inside = _mm256_and_ps(insideMask(_mm256_sub_epi32(x, minusOne), _mm256_add_epi32(w, _mm256_set1_epi32(1))),
+                    _mm256_and_ps(insideMask(_mm256_sub_epi32(y, minusOne), _mm256_add_epi32(h, _mm256_set1_epi32(1))),
+                                  insideMask(_mm256_sub_epi32(z, minusOne), _mm256_add_epi32(d, _mm256_set1_epi32(1)))));
+    __m256 mask = _mm256_and_ps(active, inside);
+    __m256i base = _mm256_and_si256(brickIndex(*f.m_layout, x, y, z), _mm256_castps_si256(mask));
+    fp.m_corners = 8;
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        fp.m_index[k] = _mm256_add_epi32(base, _mm256_set1_epi32(dx + VOLUME_BRICK_STRIDE*(dy + VOLUME_BRICK_STRIDE*dz)));
+        fp.m_weight[k] = _mm256_mul_ps(wx[dx], _mm256_mul_ps(wy[dy], wz[dz]));
+        fp.m_mask[k] = mask;
+    }
+}
+
+static void footprint(CPURaycastFrame const &f, __m256 tx, __m256 ty, __m256 tz, __m256 active, Footprint &fp)
+{
+    if(f.m_layout) {
+        brickFootprint(f, _mm256_mul_ps(tx, _mm256_set1_ps(f.m_width)), _mm256_mul_ps(ty, _mm256_set1_ps(f.m_height)),
+                       _mm256_mul_ps(tz, _mm256_set1_ps(f.m_depth)), active, fp);
+        return;
+    }
+    __m256i w = _mm256_set1_epi32(f.m_width), h = _mm256_set1_epi32(f.m_height), d = _mm256_set1_epi32(f.m_depth);
+    __m256i wh = _mm256_set1_epi32(f.m_width*f.m_height);
+    __m256 u = _mm256_mul_ps(tx, _mm256_set1_ps(f.m_width));
+    __m256 v = _mm256_mul_ps(ty, _mm256_set1_ps(f.m_height));
+    __m256 s = _mm256_mul_ps(tz, _mm256_set1_ps(f.m_depth));
+    if(f.m_nearest) {
+        __m256i x = _mm256_cvttps_epi32(_mm256_floor_ps(u));
+        __m256i y = _mm256_cvttps_epi32(_mm256_floor_ps(v));
+        __m256i z = _mm256_cvttps_epi32(_mm256_floor_ps(s));
+        fp.m_corners = 1;
+        fp.m_index[0] = _mm256_add_epi32(x, _mm256_add_epi32(_mm256_mullo_epi32(y, w), _mm256_mullo_epi32(z, wh)));
+        fp.m_weight[0] = _mm256_set1_ps(1.0);
+        fp.m_mask[0] = _mm256_and_ps(active, _mm256_and_ps(insideMask(x, w), _mm256_and_ps(insideMask(y, h), insideMask(z, d))));
+        return;
+    }
+
+    __m256 half = _mm256_set1_ps(0.5);
+    u = _mm256_sub_ps(u, half);
+    v = _mm256_sub_ps(v, half);
+    s = _mm256_sub_ps(s, half);
+    __m256 fu = _mm256_floor_ps(u), fv = _mm256_floor_ps(v), fs = _mm256_floor_ps(s);
+    __m256 fx = _mm256_sub_ps(u, fu), fy = _mm256_sub_ps(v, fv), fz = _mm256_sub_ps(s, fs);
+    __m256 one = _mm256_set1_ps(1.0);
+    __m256 wx[2] = {_mm256_sub_ps(one, fx), fx};
+    __m256 wy[2] = {_mm256_sub_ps(one, fy), fy};
+    __m256 wz[2] = {_mm256_sub_ps(one, fz), fz};
+    __m256i x[2], y[2], z[2];
+    __m256 mx[2], my[2], mz[2];
+    x[0] = _mm256_cvttps_epi32(fu); y[0] = _mm256_cvttps_epi32(fv); z[0] = _mm256_cvttps_epi32(fs);
+    x[1] = _mm256_add_epi32(x[0], _mm256_set1_epi32(1));
+    y[1] = _mm256_add_epi32(y[0], _mm256_set1_epi32(1));
+    z[1] = _mm256_add_epi32(z[0], _mm256_set1_epi32(1));
+    for(int i=0; i<2; i++) {
+        mx[i] = insideMask(x[i], w);
+        my[i] = insideMask(y[i], h);
+        mz[i] = insideMask(z[i], d);
+    }
+    fp.m_corners = 8;
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        fp.m_index[k] = _mm256_add_epi32(x[dx], _mm256_add_epi32(_mm256_mullo_epi32(y[dy], w), _mm256_mullo_epi32(z[dz], wh)));
+        fp.m_weight[k] = _mm256_mul_ps(wx[dx], _mm256_mul_ps(wy[dy], wz[dz]));
+        fp.m_mask[k] = _mm256_and_ps(active, _mm256_and_ps(mx[dx], _mm256_and_ps(my[dy], mz[dz])));
+    }
+}
+
+static inline __m256 gatherScalar(CPURaycastFrame const &f, Footprint const &fp)
+{
+    const float *data = f.m_layout?f.m_bricks:f.m_data;
+    __m256 value = _mm256_setzero_ps();
+    for(int k=0; k<fp.m_corners; k++) {
+        __m256 texel = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), data, fp.m_index[k], fp.m_mask[k], 4);
+        value = _mm256_fmadd_ps(fp.m_weight[k], texel, value);
+    }
+    return value;
+}
+
+//Cubic B-spline along one axis as two linear fetches, see cubicBSplineFetches(); h0, h1 are texture coordinates
+static inline void cubicAxis(__m256 t, int size, __m256 &h0, __m256 &h1, __m256 &g0)
+{
+    __m256 one = _mm256_set1_ps(1.0), sixth = _mm256_set1_ps(1.0/6.0), three = _mm256_set1_ps(3.0);
+    __m256 scale = _mm256_set1_ps(size), invScale = _mm256_set1_ps(1.0/size);
+    __m256 coord = _mm256_fmsub_ps(t, scale, _mm256_set1_ps(0.5));
+    __m256 index = _mm256_floor_ps(coord);
+    __m256 f = _mm256_sub_ps(coord, index), f2 = _mm256_mul_ps(f, f), f3 = _mm256_mul_ps(f2, f);
+    __m256 w0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_fmadd_ps(three, _mm256_sub_ps(f2, f), one), f3), sixth);
+    __m256 w1 = _mm256_mul_ps(_mm256_fmadd_ps(three, f3, _mm256_fnmadd_ps(_mm256_set1_ps(6.0), f2, _mm256_set1_ps(4.0))), sixth);
+    __m256 w3 = _mm256_mul_ps(f3, sixth);
+    g0 = _mm256_add_ps(w0, w1);
+    h0 = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(index, _mm256_set1_ps(0.5)), _mm256_div_ps(w1, g0)), invScale);
+    h1 = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(index, _mm256_set1_ps(1.5)), _mm256_div_ps(w3, _mm256_sub_ps(one, g0))), invScale);
+}
+
+//B-spline tricubic scalar from 8 trilinear footprints, as sample_volume() in cube.fs
+static __m256 sampleCubic(CPURaycastFrame const &f, __m256 tx, __m256 ty, __m256 tz, __m256 active)
+{
+    __m256 one = _mm256_set1_ps(1.0);
+    __m256 hx[2], hy[2], hz[2], gx[2], gy[2], gz[2];
+    cubicAxis(tx, f.m_width, hx[0], hx[1], gx[0]);
+    cubicAxis(ty, f.m_height, hy[0], hy[1], gy[0]);
+    cubicAxis(tz, f.m_depth, hz[0], hz[1], gz[0]);
+    gx[1] = _mm256_sub_ps(one, gx[0]);
+    gy[1] = _mm256_sub_ps(one, gy[0]);
+    gz[1] = _mm256_sub_ps(one, gz[0]);
+    __m256 value = _mm256_setzero_ps();
+    Footprint fp;
+    for(int k=0; k<8; k++) {
+        int dx = k&1, dy = (k >> 1)&1, dz = k >> 2;
+        footprint(f, hx[dx], hy[dy], hz[dz], active, fp);
+        value = _mm256_fmadd_ps(_mm256_mul_ps(gx[dx], _mm256_mul_ps(gy[dy], gz[dz])), gatherScalar(f, fp), value);
+    }
+    return value;
+}
+
+//Normal channels and the gradient magnitude are unpacked from one 32 bit gather per corner
+static inline void gatherNormal(CPURaycastFrame const &f, Footprint const &fp, __m256 &nx, __m256 &ny, __m256 &nz,
+                                __m256 &mag)
+{
+    nx = ny = nz = mag = _mm256_setzero_ps();
+    const int *normals = f.m_layout?(const int*)f.m_brickedNormals:(const int*)f.m_normals;
+    __m256i byteMask = _mm256_set1_epi32(0xff);
+    for(int k=0; k<fp.m_corners; k++) {
+        __m256i texel = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), normals, fp.m_index[k],
+                                                    _mm256_castps_si256(fp.m_mask[k]), 4);
+        __m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(texel, byteMask));
+        __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texel, 8), byteMask));
+        __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texel, 16), byteMask));
+        __m256 a = _mm256_cvtepi32_ps(_mm256_srli_epi32(texel, 24));
+        nx = _mm256_fmadd_ps(fp.m_weight[k], r, nx);
+        ny = _mm256_fmadd_ps(fp.m_weight[k], g, ny);
+        nz = _mm256_fmadd_ps(fp.m_weight[k], b, nz);
+        mag = _mm256_fmadd_ps(fp.m_weight[k], a, mag);
+    }
+    __m256 scale = _mm256_set1_ps(1.0/255.0);
+    nx = _mm256_mul_ps(nx, scale);
+    ny = _mm256_mul_ps(ny, scale);
+    nz = _mm256_mul_ps(nz, scale);
+    mag = _mm256_mul_ps(mag, scale);
+}
+
+//GL_LINEAR lookup into the 1D TF with a zero border
+static inline void classify(CPURaycastFrame const &f, __m256 value, __m256 active, __m256 *rgba)
+{
+    __m256 u = _mm256_sub_ps(_mm256_mul_ps(value, _mm256_set1_ps(TF1D_SIZE)), _mm256_set1_ps(0.5));
+    __m256 fu = _mm256_floor_ps(u);
+    __m256 frac = _mm256_sub_ps(u, fu);
+    __m256i i0 = _mm256_cvttps_epi32(fu);
+    __m256i i1 = _mm256_add_epi32(i0, _mm256_set1_epi32(1));
+    __m256i size = _mm256_set1_epi32(TF1D_SIZE);
+    __m256 m0 = _mm256_and_ps(active, insideMask(i0, size));
+    __m256 m1 = _mm256_and_ps(active, insideMask(i1, size));
+    for(int c=0; c<4; c++) {
+        const float *table = f.m_tf + c*TF1D_SIZE;
+        __m256 t0 = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), table, i0, m0, 4);
+        __m256 t1 = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), table, i1, m1, 4);
+        rgba[c] = _mm256_fmadd_ps(frac, _mm256_sub_ps(t1, t0), t0);
+    }
+}
+
+//GL_LINEAR lookup into the pre-integrated table, clamped to its edges
+static inline void classifySegment(CPURaycastFrame const &f, __m256 front, __m256 back, __m256 active, __m256 *rgba)
+{
+    __m256 size = _mm256_set1_ps(TF1D_SIZE), half = _mm256_set1_ps(0.5);
+    __m256 u = _mm256_fmsub_ps(front, size, half), v = _mm256_fmsub_ps(back, size, half);
+    __m256 fu = _mm256_floor_ps(u), fv = _mm256_floor_ps(v);
+    __m256 wu = _mm256_sub_ps(u, fu), wv = _mm256_sub_ps(v, fv);
+    __m256i zero = _mm256_setzero_si256(), last = _mm256_set1_epi32(TF1D_SIZE - 1), one = _mm256_set1_epi32(1);
+    __m256i i = _mm256_cvttps_epi32(fu), j = _mm256_cvttps_epi32(fv);
+    __m256i i0 = _mm256_min_epi32(_mm256_max_epi32(i, zero), last), i1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(i, one), zero), last);
+    __m256i j0 = _mm256_min_epi32(_mm256_max_epi32(j, zero), last), j1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(j, one), zero), last);
+    __m256i row0 = _mm256_mullo_epi32(j0, _mm256_set1_epi32(TF1D_SIZE)), row1 = _mm256_mullo_epi32(j1, _mm256_set1_epi32(TF1D_SIZE));
+    __m256i index[4] = {_mm256_slli_epi32(_mm256_add_epi32(row0, i0), 2), _mm256_slli_epi32(_mm256_add_epi32(row0, i1), 2),
+                        _mm256_slli_epi32(_mm256_add_epi32(row1, i0), 2), _mm256_slli_epi32(_mm256_add_epi32(row1, i1), 2)};
+    for(int c=0; c<4; c++) {
+        __m256 t[4];
+        for(int k=0; k<4; k++) t[k] = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), f.m_preintegrated + c, index[k], active, 4);
+        __m256 a = _mm256_fmadd_ps(wu, _mm256_sub_ps(t[1], t[0]), t[0]);
+        __m256 b = _mm256_fmadd_ps(wu, _mm256_sub_ps(t[3], t[2]), t[2]);
+        rgba[c] = _mm256_fmadd_ps(wv, _mm256_sub_ps(b, a), a);
+    }
+}
+
+void marchPacketAVX2(CPURaycastFrame const &frame, const float *position, const float *dir, const float *deltaT,
+                     int activeMask, float *rgba)
+{
+    const int N = CPU_RAYCAST_PACKET_SIZE;
+    RaycastParameters const &params = frame.m_params;
+    __m256 step = _mm256_set1_ps(params.m_stepSize);
+    __m256 px = _mm256_loadu_ps(position), py = _mm256_loadu_ps(position + N), pz = _mm256_loadu_ps(position + 2*N);
+    __m256 dx = _mm256_loadu_ps(dir), dy = _mm256_loadu_ps(dir + N), dz = _mm256_loadu_ps(dir + 2*N);
+    __m256 ddx = _mm256_mul_ps(dx, step), ddy = _mm256_mul_ps(dy, step), ddz = _mm256_mul_ps(dz, step);
+    __m256 dt = _mm256_loadu_ps(deltaT);
+    __m256 ibx = _mm256_set1_ps(1.0/frame.m_bbox.x), iby = _mm256_set1_ps(1.0/frame.m_bbox.y), ibz = _mm256_set1_ps(1.0/frame.m_bbox.z);
+    __m256 half = _mm256_set1_ps(0.5), one = _mm256_set1_ps(1.0), zero = _mm256_setzero_ps();
+    __m256 ex = _mm256_set1_ps(frame.m_eye.x), ey = _mm256_set1_ps(frame.m_eye.y), ez = _mm256_set1_ps(frame.m_eye.z);
+
+    __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256 active = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(activeMask), laneBits), laneBits));
+    __m256 s = zero;
+    active = _mm256_and_ps(active, _mm256_cmp_ps(s, dt, _CMP_LT_OQ));
+
+    __m256 cr = zero, cg = zero, cb = zero, ca = zero;
+    __m256 sample[4];
+    __m256 front = _mm256_set1_ps(-1.0); //Pre-integration: no front sample yet, the first segment is a point sample
+    bool wantNormal = frame.m_normals && (params.m_performPhongShading || params.m_gradientOpacity > 0.0);
+    Footprint fp;
+    while(_mm256_movemask_ps(active)) { //Front to back
+        __m256 tx = _mm256_fmadd_ps(px, ibx, half);
+        __m256 ty = _mm256_fmadd_ps(py, iby, half);
+        __m256 tz = _mm256_fmadd_ps(pz, ibz, half);
+        if(!frame.m_cubic || wantNormal) footprint(frame, tx, ty, tz, active, fp);
+        __m256 value = frame.m_cubic?sampleCubic(frame, tx, ty, tz, active):gatherScalar(frame, fp); //Normals stay trilinear
+        if(frame.m_preintegrated) {
+            front = _mm256_blendv_ps(front, value, _mm256_cmp_ps(front, zero, _CMP_LT_OQ));
+            classifySegment(frame, front, value, active, sample);
+            front = value;
+        } else
+            classify(frame, value, active, sample);
+
+        //Normals are gathered only while some lane has a visible sample
+        __m256 nx = zero, ny = zero, nz = zero, mag = zero;
+        bool gathered = wantNormal && _mm256_movemask_ps(_mm256_and_ps(active, _mm256_cmp_ps(sample[3], zero, _CMP_GT_OQ)));
+        if(gathered) gatherNormal(frame, fp, nx, ny, nz, mag);
+        if(params.m_gradientOpacity > 0.0) { //Emphasize boundaries over homogeneous regions
+            __m256 scale = _mm256_fmadd_ps(_mm256_set1_ps(params.m_gradientOpacity), _mm256_sub_ps(mag, one), one);
+            for(int c=0; c<4; c++) sample[c] = _mm256_mul_ps(sample[c], scale);
+        }
+
+        if(params.m_opacityCorrection != 1.0) { //Rare (LOD frames): scalar pow per lane
+            float a[N], scale[N];
+            _mm256_storeu_ps(a, sample[3]);
+            for(int i=0; i<N; i++)
+                scale[i] = (a[i] > 0.0)?(1.0 - powf(1.0 - fminf(a[i], 0.999), params.m_opacityCorrection))/a[i]:1.0;
+            __m256 sc = _mm256_loadu_ps(scale);
+            for(int c=0; c<4; c++) sample[c] = _mm256_mul_ps(sample[c], sc);
+        }
+
+        if(params.m_performPhongShading && gathered) {
+            __m256 two = _mm256_set1_ps(2.0);
+            __m256 shade = _mm256_and_ps(_mm256_cmp_ps(mag, _mm256_set1_ps(CPU_RAYCAST_MIN_GRADIENT), _CMP_GT_OQ),
+                                         _mm256_cmp_ps(s, step, _CMP_GT_OQ));
+            if(_mm256_movemask_ps(shade)) {
+                nx = _mm256_fmsub_ps(nx, two, one);
+                ny = _mm256_fmsub_ps(ny, two, one);
+                nz = _mm256_fmsub_ps(nz, two, one);
+                //Interpolation shortens the unit normals
+                __m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(nx, nx, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nz, nz)))));
+                nx = _mm256_mul_ps(nx, invLength);
+                ny = _mm256_mul_ps(ny, invLength);
+                nz = _mm256_mul_ps(nz, invLength);
+                //Headlight
+                __m256 lx = _mm256_sub_ps(ex, px), ly = _mm256_sub_ps(ey, py), lz = _mm256_sub_ps(ez, pz);
+                __m256 invLen = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(lx, lx, _mm256_fmadd_ps(ly, ly, _mm256_mul_ps(lz, lz)))));
+                lx = _mm256_mul_ps(lx, invLen);
+                ly = _mm256_mul_ps(ly, invLen);
+                lz = _mm256_mul_ps(lz, invLen);
+                __m256 ndotl = _mm256_fmadd_ps(nx, lx, _mm256_fmadd_ps(ny, ly, _mm256_mul_ps(nz, lz)));
+                __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+                __m256 diffuse = _mm256_min_ps(_mm256_and_ps(ndotl, absMask), one); //Two-sided lighting
+                __m256 twoNdotL = _mm256_mul_ps(two, ndotl);
+                __m256 rx = _mm256_fmsub_ps(nx, twoNdotL, lx);
+                __m256 ry = _mm256_fmsub_ps(ny, twoNdotL, ly);
+                __m256 rz = _mm256_fmsub_ps(nz, twoNdotL, lz);
+                __m256 specular = _mm256_max_ps(_mm256_sub_ps(zero, _mm256_fmadd_ps(dx, rx, _mm256_fmadd_ps(dy, ry, _mm256_mul_ps(dz, rz)))), zero);
+                for(int k=0; k<7; k++) specular = _mm256_mul_ps(specular, specular); //^128
+                specular = _mm256_min_ps(specular, one);
+                for(int c=0; c<3; c++)
+                    sample[c] = _mm256_blendv_ps(sample[c], _mm256_fmadd_ps(sample[c], diffuse, specular), shade);
+            }
+        }
+
+        //Composite where the sample is not transparent
+        __m256 visible = _mm256_and_ps(active, _mm256_cmp_ps(sample[3], zero, _CMP_GT_OQ));
+        __m256 weight = _mm256_and_ps(visible, _mm256_sub_ps(one, ca));
+        cr = _mm256_fmadd_ps(weight, sample[0], cr);
+        cg = _mm256_fmadd_ps(weight, sample[1], cg);
+        cb = _mm256_fmadd_ps(weight, sample[2], cb);
+        ca = _mm256_fmadd_ps(weight, sample[3], ca);
+
+        //Early ray termination, then advance
+        active = _mm256_and_ps(active, _mm256_cmp_ps(ca, _mm256_set1_ps(0.95), _CMP_LE_OQ));
+        px = _mm256_add_ps(px, ddx);
+        py = _mm256_add_ps(py, ddy);
+        pz = _mm256_add_ps(pz, ddz);
+        s = _mm256_add_ps(s, step);
+        active = _mm256_and_ps(active, _mm256_cmp_ps(s, dt, _CMP_LT_OQ));
+    }
+    _mm256_storeu_ps(rgba, cr);
+    _mm256_storeu_ps(rgba + N, cg);
+    _mm256_storeu_ps(rgba + 2*N, cb);
+    _mm256_storeu_ps(rgba + 3*N, ca);
+}
+
+#else
+
+//Built without AVX2 support: CPURaycaster::isSIMDSupported() is false and this is never called
+void marchPacketAVX2(CPURaycastFrame const &frame, const float *position, const float *dir, const float *deltaT,
+                     int activeMask, float *rgba)
+{
+    for(int i=0; i<CPU_RAYCAST_PACKET_SIZE; i++) {
+        if(!(activeMask & (1 << i))) continue;
+        const int N = CPU_RAYCAST_PACKET_SIZE;
+        float c[4];
+        marchRay(frame, Vec3(position[i], position[N + i], position[2*N + i]), Vec3(dir[i], dir[N + i], dir[2*N + i]), deltaT[i], c);
+        for(int k=0; k<4; k++) rgba[k*N + i] = c[k];
+    }
+}
+
+#endif
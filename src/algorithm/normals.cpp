@@ -0,0 +1,78 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "normals.h"
+
+#include <math.h>
+#include <limits>
+
+void encodeNormals(const float *gradient, long nelem, unsigned char *normals)
+{
+    //Largest gradient magnitude
+    float gx, gy, gz, gmag;
+    float gmag_max = std::numeric_limits<float>::min();
+    for(long i=0; i<nelem; i++) {
+        gx = gradient[3*i];
+        gy = gradient[3*i+1];
+        gz = gradient[3*i+2];
+        gmag = sqrtf(gx*gx + gy*gy + gz*gz);
+        if(gmag > gmag_max) gmag_max = gmag;
+    }
+
+    //Encode unit shading normals and the relative magnitude to a uchar texture
+    for(long i=0; i<nelem; i++) {
+        gx = gradient[3*i];
+        gy = gradient[3*i+1];
+        gz = gradient[3*i+2];
+        gmag = sqrtf(gx*gx + gy*gy + gz*gz);
+        float inv = (gmag > 0.0)?1.0/gmag:0.0;
+        normals[4*i] = (unsigned char)(255.0*(gx*inv + 1.0)/2.0 + 0.5); //Map vector [-1, +1] -> [0, 1]
+        normals[4*i+1] = (unsigned char)(255.0*(gy*inv + 1.0)/2.0 + 0.5);
+        normals[4*i+2] = (unsigned char)(255.0*(gz*inv + 1.0)/2.0 + 0.5);
+        normals[4*i+3] = (unsigned char)(255.0*gmag/gmag_max + 0.5);
+    }
+}
+
+float maxGradientMagnitude(const float *data, int width, int height, int depth, float voxelX, float voxelY, float voxelZ)
+{
+    //Neighbours outside the volume clamp to the edge
+    float sx = 0.5/voxelX, sy = 0.5/voxelY, sz = 0.5/voxelZ;
+    long sliceSize = (long)width*height;
+    float gmag2_max = 0.0;
+    for(int z=0; z<depth; z++) {
+        long zm = (z > 0)?-sliceSize:0, zp = (z < depth - 1)?sliceSize:0;
+        for(int y=0; y<height; y++) {
+            long ym = (y > 0)?-width:0, yp = (y < height - 1)?width:0;
+            const float *row = data + z*sliceSize + (long)y*width;
+            for(int x=0; x<width; x++) {
+                float gx = sx*(row[(x < width - 1)?x + 1:x] - row[(x > 0)?x - 1:x]);
+                float gy = sy*(row[x + yp] - row[x + ym]);
+                float gz = sz*(row[x + zp] - row[x + zm]);
+                float gmag2 = gx*gx + gy*gy + gz*gz;
+                if(gmag2 > gmag2_max) gmag2_max = gmag2;
+            }
+        }
+    }
+    return sqrtf(gmag2_max);
+}
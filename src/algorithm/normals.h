@@ -0,0 +1,36 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef NORMALS_H
+#define NORMALS_H
+
+//Encodes a gradient field (gx, gy, gz, gx, ...) into RGBA8 shading normals for the raycasters: the unit normal mapped
+//[-1, +1] -> [0, 255] in RGB, and the gradient magnitude relative to the largest one in A. Zero gradients get a zero
+//normal and magnitude.
+void encodeNormals(const float *gradient, long nelem, unsigned char *normals);
+//Largest central difference gradient magnitude of a volume (x fastest) with the given voxel extents. Scales the
+//gradients that GLRaycaster computes on the fly to the [0, 1] range of the encoded ones.
+float maxGradientMagnitude(const float *data, int width, int height, int depth, float voxelX, float voxelY, float voxelZ);
+
+#endif // NORMALS_H
@@ -0,0 +1,97 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "occupancybuilder.h"
+#include "volumemanager.h"
+#include "profiler.h"
+
+#include <QtConcurrent>
+
+OccupancyBuilder::OccupancyBuilder(QObject *parent) : QObject(parent)
+{
+    m_volumeManager = NULL;
+    m_hasPending = false;
+    m_latestVersion = 0;
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(on_buildFinished()));
+}
+
+OccupancyBuilder::~OccupancyBuilder()
+{
+    //Invalidate any running build so that it returns early, then wait for it
+    m_latestVersion++;
+    m_hasPending = false;
+    m_watcher.waitForFinished();
+}
+
+void OccupancyBuilder::setVolume(VolumeManager *vm)
+{
+    //Abandon a build of the previous volume before its ranges and data go away, then rebuild with the last TF
+    m_latestVersion++;
+    m_watcher.waitForFinished();
+    m_volumeManager = vm;
+    m_ranges.clear();
+    m_grid.clear();
+    m_hasPending = !m_pendingTF.isEmpty();
+    startBuild();
+}
+
+void OccupancyBuilder::requestRebuild(unsigned char *colorBuffer)
+{
+    //Copy the TF now: the caller reuses its buffer on the next edit
+    m_pendingTF = QByteArray((const char*)colorBuffer, 256*4);
+    m_hasPending = true;
+    m_latestVersion++;
+    if(!m_watcher.isRunning()) startBuild();
+}
+
+void OccupancyBuilder::startBuild()
+{
+    if(!m_hasPending || !m_volumeManager) return;
+    m_hasPending = false;
+    m_watcher.setFuture(QtConcurrent::run(this, &OccupancyBuilder::build, m_pendingTF, m_latestVersion.load()));
+}
+
+void OccupancyBuilder::on_buildFinished()
+{
+    QSharedPointer<OccupancyGrid> result = m_watcher.result();
+    //Drop results of superseded TF versions; the newest request is still pending in that case
+    if(result && result->version() == m_latestVersion.load()) {
+        m_grid = result;
+        emit occupancyUpdated();
+    }
+    startBuild();
+}
+
+QSharedPointer<OccupancyGrid> OccupancyBuilder::build(QByteArray colorBuffer, unsigned int version)
+{
+    ScopedSpan span("occupancy");
+    if(m_ranges.isEmpty())
+        m_ranges.compute(m_volumeManager->data(), m_volumeManager->width(), m_volumeManager->height(),
+                         m_volumeManager->depth(), OCCUPANCY_BRICK_SIZE);
+
+    QSharedPointer<OccupancyGrid> grid(new OccupancyGrid());
+    if(!grid->classify(m_ranges, (const unsigned char*)colorBuffer.constData(), version, &m_latestVersion))
+        return QSharedPointer<OccupancyGrid>();
+    return grid;
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef OCCUPANCYBUILDER_H
+#define OCCUPANCYBUILDER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <atomic>
+
+#include "occupancygrid.h"
+
+class VolumeManager;
+
+// Rebuilds the TF dependent occupancy grid on a worker thread. Requests are coalesced: while a build is running
+// only the most recent TF is kept, and a build whose TF has been superseded is abandoned. Finished grids are
+// swapped in on the GUI thread, so the renderer keeps using the previous complete grid until the new one is ready.
+class OccupancyBuilder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OccupancyBuilder(QObject *parent = 0);
+    ~OccupancyBuilder();
+    void setVolume(VolumeManager *vm); // Waits for a running build; the grid is rebuilt for the new volume
+    QSharedPointer<OccupancyGrid> grid() const { return m_grid; }
+
+public slots:
+    void requestRebuild(unsigned char *colorBuffer);
+
+signals:
+    void occupancyUpdated();
+
+private slots:
+    void on_buildFinished();
+
+private:
+    VolumeManager *m_volumeManager;
+    BrickRanges m_ranges; // Only touched by the worker, and by setVolume() once no build runs
+    QSharedPointer<OccupancyGrid> m_grid; // Latest complete grid
+    QFutureWatcher<QSharedPointer<OccupancyGrid> > m_watcher;
+    QByteArray m_pendingTF;
+    bool m_hasPending;
+    std::atomic<unsigned int> m_latestVersion;
+
+    void startBuild();
+    QSharedPointer<OccupancyGrid> build(QByteArray colorBuffer, unsigned int version);
+};
+
+#endif // OCCUPANCYBUILDER_H
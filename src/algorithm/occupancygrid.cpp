@@ -0,0 +1,144 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "occupancygrid.h"
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+BrickRanges::BrickRanges()
+{
+    m_width = m_height = m_depth = 0;
+    m_brickSize = OCCUPANCY_BRICK_SIZE;
+    m_min = NULL;
+    m_max = NULL;
+}
+
+BrickRanges::~BrickRanges()
+{
+    clear();
+}
+
+void BrickRanges::clear()
+{
+    delete []m_min;
+    delete []m_max;
+    m_min = m_max = NULL;
+    m_width = m_height = m_depth = 0;
+}
+
+void BrickRanges::compute(const float *data, int width, int height, int depth, int brickSize)
+{
+    m_brickSize = brickSize;
+    m_width = (width + brickSize - 1)/brickSize;
+    m_height = (height + brickSize - 1)/brickSize;
+    m_depth = (depth + brickSize - 1)/brickSize;
+    long nbricks = (long)m_width*m_height*m_depth;
+    if(m_min) delete []m_min;
+    if(m_max) delete []m_max;
+    m_min = new float[nbricks];
+    m_max = new float[nbricks];
+
+    long sliceSize = (long)width*height;
+    for(int bz=0; bz<m_depth; bz++) {
+        //Voxel extents of the brick, grown by the one voxel interpolation apron
+        int z0 = bz*brickSize - 1; if(z0 < 0) z0 = 0;
+        int z1 = (bz + 1)*brickSize + 1; if(z1 > depth) z1 = depth;
+        for(int by=0; by<m_height; by++) {
+            int y0 = by*brickSize - 1; if(y0 < 0) y0 = 0;
+            int y1 = (by + 1)*brickSize + 1; if(y1 > height) y1 = height;
+            for(int bx=0; bx<m_width; bx++) {
+                int x0 = bx*brickSize - 1; if(x0 < 0) x0 = 0;
+                int x1 = (bx + 1)*brickSize + 1; if(x1 > width) x1 = width;
+                float vmin = data[z0*sliceSize + (long)y0*width + x0];
+                float vmax = vmin;
+                for(int z=z0; z<z1; z++)
+                    for(int y=y0; y<y1; y++) {
+                        const float *row = data + z*sliceSize + (long)y*width;
+                        for(int x=x0; x<x1; x++) {
+                            if(row[x] < vmin) vmin = row[x];
+                            if(row[x] > vmax) vmax = row[x];
+                        }
+                    }
+                long b = ((long)bz*m_height + by)*m_width + bx;
+                m_min[b] = vmin;
+                m_max[b] = vmax;
+            }
+        }
+    }
+}
+
+OccupancyGrid::OccupancyGrid()
+{
+    m_width = m_height = m_depth = 0;
+    m_brickSize = OCCUPANCY_BRICK_SIZE;
+    m_version = 0;
+    m_occupiedCount = 0;
+    m_occupancy = NULL;
+}
+
+OccupancyGrid::~OccupancyGrid()
+{
+    if(m_occupancy) delete []m_occupancy;
+}
+
+bool OccupancyGrid::classify(BrickRanges const &ranges, const unsigned char *colorBuffer, unsigned int version,
+                             std::atomic<unsigned int> const *latestVersion)
+{
+    m_width = ranges.width();
+    m_height = ranges.height();
+    m_depth = ranges.depth();
+    m_brickSize = ranges.brickSize();
+    m_version = version;
+    m_occupiedCount = 0;
+    long nbricks = (long)m_width*m_height*m_depth;
+    if(m_occupancy) delete []m_occupancy;
+    m_occupancy = new unsigned char[nbricks];
+
+    //Prefix count of visible TF entries: visible[j] - visible[i] = #entries in [i, j) with alpha > 0
+    int visible[257];
+    visible[0] = 0;
+    for(int i=0; i<256; i++)
+        visible[i+1] = visible[i] + ((colorBuffer[4*i + 3] > 0)?1:0);
+
+    const float *bmin = ranges.min();
+    const float *bmax = ranges.max();
+    long sliceBricks = (long)m_width*m_height;
+    for(int bz=0; bz<m_depth; bz++) {
+        //Bail out early if the TF has been edited again while we were working
+        if(latestVersion && latestVersion->load(std::memory_order_relaxed) != version) return false;
+        for(long b=bz*sliceBricks; b<(bz+1)*sliceBricks; b++) {
+            //A value v is looked up at texel coordinate v*256 - 0.5 with linear filtering, touching two entries
+            int lo = (int)floor(bmin[b]*256.0 - 0.5);
+            int hi = (int)floor(bmax[b]*256.0 - 0.5) + 1;
+            lo = std::min(std::max(lo, 0), 255);
+            hi = std::min(std::max(hi, 0), 255);
+            bool occupied = (visible[hi + 1] - visible[lo]) > 0;
+            m_occupancy[b] = occupied?255:0;
+            if(occupied) m_occupiedCount++;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <atomic>
+#include <cstddef>
+
+#define OCCUPANCY_BRICK_SIZE 8
+
+// Scalar range [min, max] of every brick of a volume. Ranges include a one voxel apron so that
+// trilinear samples taken near a brick face are covered. Independent of the TF, computed once per volume.
+class BrickRanges
+{
+public:
+    BrickRanges();
+    ~BrickRanges();
+    void compute(const float *data, int width, int height, int depth, int brickSize);
+    void clear(); // Back to empty, e.g. for another volume
+    bool isEmpty() const { return m_min == NULL; }
+    int const & width() const { return m_width;}
+    int const & height() const { return m_height;}
+    int const & depth() const { return m_depth;}
+    int const & brickSize() const { return m_brickSize;}
+    const float* min() const { return m_min;}
+    const float* max() const { return m_max;}
+
+private:
+    int m_width, m_height, m_depth; // Number of bricks along each axis
+    int m_brickSize;
+    float *m_min, *m_max;
+};
+
+// Binary occupancy of the bricks under one version of the 1D TF. A brick is marked occupied (255) if any TF
+// entry reachable from its scalar range has non-zero opacity; skipping unoccupied bricks never drops a sample.
+class OccupancyGrid
+{
+public:
+    OccupancyGrid();
+    ~OccupancyGrid();
+    //Returns false if a newer TF version was requested meanwhile (i.e., this result is stale)
+    bool classify(BrickRanges const &ranges, const unsigned char *colorBuffer, unsigned int version,
+                  std::atomic<unsigned int> const *latestVersion = NULL);
+    int const & width() const { return m_width;}
+    int const & height() const { return m_height;}
+    int const & depth() const { return m_depth;}
+    int const & brickSize() const { return m_brickSize;}
+    unsigned int const & version() const { return m_version;}
+    long const & occupiedCount() const { return m_occupiedCount;}
+    const unsigned char* data() const { return m_occupancy;}
+
+private:
+    int m_width, m_height, m_depth;
+    int m_brickSize;
+    unsigned int m_version; // TF version this grid was classified with
+    long m_occupiedCount;
+    unsigned char *m_occupancy;
+};
+
+#endif // OCCUPANCYGRID_H
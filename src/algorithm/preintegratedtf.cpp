@@ -0,0 +1,150 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "preintegratedtf.h"
+#include "workstealingpool.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#define PREINTEGRATED_SCAN_BLOCKS 8 // Blocks per prefix sum; TF1D_SIZE must be a multiple
+#define PREINTEGRATED_MAX_ALPHA 0.999 // As the opacity correction in cube.fs, keeps the extinction finite
+
+PreintegratedTF::PreintegratedTF()
+{
+    memset(m_colors, 0, sizeof(m_colors));
+    m_valid = false;
+    m_table = new float[4*TF1D_SIZE*TF1D_SIZE];
+    memset(m_table, 0, 4*TF1D_SIZE*TF1D_SIZE*sizeof(float));
+    m_terms = new double[4*TF1D_SIZE];
+    m_prefix = new double[4*(TF1D_SIZE + 1)];
+    m_lastUpdatedEntries = 0;
+    m_threadCount = 0;
+    m_pool = NULL;
+}
+
+PreintegratedTF::~PreintegratedTF()
+{
+    delete m_pool;
+    delete []m_table;
+    delete []m_terms;
+    delete []m_prefix;
+}
+
+void PreintegratedTF::setThreadCount(int threadCount)
+{
+    if(threadCount == m_threadCount) return;
+    m_threadCount = threadCount;
+    delete m_pool;
+    m_pool = NULL;
+}
+
+bool PreintegratedTF::update(const unsigned char *colorBuffer)
+{
+    //Range of TF entries that changed since the last update
+    int lo = 0, hi = TF1D_SIZE - 1;
+    if(m_valid) {
+        while(lo < TF1D_SIZE && !memcmp(m_colors + 4*lo, colorBuffer + 4*lo, 4)) lo++;
+        if(lo == TF1D_SIZE) {
+            m_lastUpdatedEntries = 0;
+            return false;
+        }
+        while(!memcmp(m_colors + 4*hi, colorBuffer + 4*hi, 4)) hi--;
+    }
+    ScopedSpan span("tf.preintegrate");
+    memcpy(m_colors, colorBuffer, sizeof(m_colors));
+    m_valid = true;
+    if(!m_pool) m_pool = new WorkStealingPool(m_threadCount);
+
+    for(int i=lo; i<=hi; i++) {
+        const unsigned char *c = m_colors + 4*i;
+        double alpha = std::min(c[3]/255.0, PREINTEGRATED_MAX_ALPHA);
+        double extinction = -log(1.0 - alpha);
+        m_terms[i] = extinction;
+        for(int k=0; k<3; k++) //Colors are premultiplied: weight the plain color by the extinction
+            m_terms[(k + 1)*TF1D_SIZE + i] = (c[3] > 0)?std::min(c[k]/(double)c[3], 1.0)*extinction:0.0;
+    }
+    prefixSums();
+
+    //Segment (front, back) covers the TF entries between the two, so only rows and columns reaching [lo, hi] change
+    m_pool->run(TF1D_SIZE, [&](int back) {
+        int begin = (back > hi)?0:((back < lo)?lo:0);
+        int end = (back < lo)?TF1D_SIZE - 1:((back > hi)?hi:TF1D_SIZE - 1);
+        for(int front=begin; front<=end; front++) updateEntry(front, back);
+    });
+    int above = TF1D_SIZE - 1 - hi;
+    m_lastUpdatedEntries = TF1D_SIZE*TF1D_SIZE - lo*lo - above*above;
+    return true;
+}
+
+//Blocked parallel scan of the 4 planes: block totals in parallel, a serial scan of the few totals, then each block
+//writes its running sums from its offset
+void PreintegratedTF::prefixSums()
+{
+    const int blocks = PREINTEGRATED_SCAN_BLOCKS, blockSize = TF1D_SIZE/PREINTEGRATED_SCAN_BLOCKS;
+    double totals[4*PREINTEGRATED_SCAN_BLOCKS];
+    m_pool->run(4*blocks, [&](int task) {
+        const double *terms = m_terms + (task/blocks)*TF1D_SIZE + (task%blocks)*blockSize;
+        double sum = 0.0;
+        for(int i=0; i<blockSize; i++) sum += terms[i];
+        totals[task] = sum;
+    });
+    for(int plane=0; plane<4; plane++) {
+        double offset = 0.0;
+        for(int b=0; b<blocks; b++) {
+            double total = totals[plane*blocks + b];
+            totals[plane*blocks + b] = offset;
+            offset += total;
+        }
+    }
+    m_pool->run(4*blocks, [&](int task) {
+        int plane = task/blocks, first = (task%blocks)*blockSize;
+        const double *terms = m_terms + plane*TF1D_SIZE;
+        double *prefix = m_prefix + plane*(TF1D_SIZE + 1);
+        double sum = totals[task];
+        for(int i=first; i<first + blockSize; i++) {
+            prefix[i] = sum;
+            sum += terms[i];
+        }
+        if(first + blockSize == TF1D_SIZE) prefix[TF1D_SIZE] = sum;
+    });
+}
+
+void PreintegratedTF::updateEntry(int front, int back)
+{
+    int lo = std::min(front, back), hi = std::max(front, back);
+    double sum[4];
+    for(int plane=0; plane<4; plane++) {
+        const double *prefix = m_prefix + plane*(TF1D_SIZE + 1), *terms = m_terms + plane*TF1D_SIZE;
+        sum[plane] = prefix[hi + 1] - prefix[lo];
+        if(hi > lo) sum[plane] -= 0.5*(terms[lo] + terms[hi]); //Trapezoidal rule over the linear scalar ramp
+    }
+    double extinction = std::max(sum[0], 0.0)/std::max(hi - lo, 1);
+    double alpha = 1.0 - exp(-extinction);
+    float *out = m_table + 4*(back*TF1D_SIZE + front);
+    for(int k=0; k<3; k++) out[k] = (sum[0] > 1e-12)?sum[k + 1]/sum[0]*alpha:0.0;
+    out[3] = alpha;
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef PREINTEGRATEDTF_H
+#define PREINTEGRATEDTF_H
+
+#include "transferfunction1d.h"
+
+class WorkStealingPool;
+
+// Pre-integrated classification (Engel et al. 2001): the RGBA of a ray segment whose scalar goes linearly from a front
+// to a back sample, for a segment as long as the configured step, so a coarse step does not slice through thin TF
+// features. Entry (front, back) averages the extinction -ln(1 - alpha) of the TF entries in between (trapezoidal rule)
+// and weights their colors by it, so the diagonal reproduces the 1D TF. Longer or shorter segments go through the
+// usual opacity correction.
+//
+// The averages come from prefix sums over the TF entries, computed with a parallel scan. A TF edit only recomputes the
+// entries whose segment covers a changed TF entry.
+class PreintegratedTF
+{
+public:
+    PreintegratedTF();
+    ~PreintegratedTF();
+    void setThreadCount(int threadCount); // 0: all hardware threads
+
+    //Brings the table up to date with a baked TF (TF1D_SIZE RGBA, premultiplied). Returns false if it did not change
+    bool update(const unsigned char *colorBuffer);
+    //TF1D_SIZE x TF1D_SIZE RGBA, premultiplied, in [0, 1]. Row = back sample, column = front sample
+    const float* table() const { return m_table;}
+    int lastUpdatedEntries() const { return m_lastUpdatedEntries;}
+
+private:
+    unsigned char m_colors[4*TF1D_SIZE];
+    bool m_valid;
+    float *m_table;
+    double *m_terms; // Extinction and extinction weighted R, G, B per TF entry (4 planes of TF1D_SIZE)
+    double *m_prefix; // Exclusive prefix sums of m_terms (4 planes of TF1D_SIZE + 1)
+    int m_lastUpdatedEntries;
+    int m_threadCount;
+    WorkStealingPool *m_pool;
+
+    void prefixSums();
+    void updateEntry(int front, int back);
+};
+
+#endif // PREINTEGRATEDTF_H
@@ -0,0 +1,232 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "profiler.h"
+#include "defines.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+SampleRing::SampleRing()
+{
+    m_next = m_count = 0;
+}
+
+void SampleRing::push(float value)
+{
+    m_samples[m_next] = value;
+    m_next = (m_next + 1) % PROFILER_RING_SIZE;
+    if(m_count < PROFILER_RING_SIZE) m_count++;
+}
+
+float SampleRing::last() const
+{
+    if(m_count == 0) return 0.0;
+    return m_samples[(m_next + PROFILER_RING_SIZE - 1) % PROFILER_RING_SIZE];
+}
+
+float SampleRing::mean() const
+{
+    if(m_count == 0) return 0.0;
+    double sum = 0.0;
+    for(int i=0; i<m_count; i++) sum += m_samples[i];
+    return sum/m_count;
+}
+
+float SampleRing::percentile(float p) const
+{
+    if(m_count == 0) return 0.0;
+    float sorted[PROFILER_RING_SIZE];
+    std::copy(m_samples, m_samples + m_count, sorted);
+    int k = (int)(p/100.0*(m_count - 1) + 0.5); //Nearest rank
+    std::nth_element(sorted, sorted + k, sorted + m_count);
+    return sorted[k];
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::record(const char *name, float ms, long long bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Channel &channel = m_channels[name];
+    channel.m_ms.push(ms);
+    channel.m_lastBytes = bytes;
+}
+
+bool Profiler::stats(const char *name, ProfilerStats &stats) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, Channel>::const_iterator it = m_channels.find(name);
+    if(it == m_channels.end()) return false;
+    const SampleRing &ring = it->second.m_ms;
+    stats.m_count = ring.size();
+    stats.m_last = ring.last();
+    stats.m_mean = ring.mean();
+    stats.m_p50 = ring.percentile(50);
+    stats.m_p95 = ring.percentile(95);
+    stats.m_p99 = ring.percentile(99);
+    stats.m_lastMBps = (stats.m_last > 0.0)?(it->second.m_lastBytes/(1e3*stats.m_last)):0.0;
+    return true;
+}
+
+std::vector<std::string> Profiler::channels() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> names;
+    for(std::map<std::string, Channel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+        names.push_back(it->first);
+    return names;
+}
+
+void Profiler::printSummary(FILE *fid) const
+{
+    std::vector<std::string> names = channels();
+    fprintf(fid, "%-20s %8s %10s %10s %10s %10s\n", "Channel", "Count", "Last(ms)", "p50(ms)", "p95(ms)", "p99(ms)");
+    for(size_t i=0; i<names.size(); i++) {
+        ProfilerStats s;
+        if(!stats(names[i].c_str(), s)) continue;
+        fprintf(fid, "%-20s %8d %10.3f %10.3f %10.3f %10.3f\n", names[i].c_str(), s.m_count, s.m_last, s.m_p50, s.m_p95, s.m_p99);
+    }
+}
+
+TraceBuffer::TraceBuffer(int tid) : m_count(0), m_dropped(0), m_tid(tid)
+{
+}
+
+void TraceBuffer::push(const char *name, long long startUs, long long durationUs)
+{
+    int n = m_count.load(std::memory_order_relaxed);
+    if(n == TRACE_BUFFER_SIZE) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_events[n].m_name = name;
+    m_events[n].m_startUs = startUs;
+    m_events[n].m_durationUs = durationUs;
+    m_count.store(n + 1, std::memory_order_release); //Publish
+}
+
+TraceRecorder::TraceRecorder()
+{
+    m_epoch = std::chrono::steady_clock::now();
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    for(size_t i=0; i<m_buffers.size(); i++) delete m_buffers[i];
+}
+
+TraceRecorder& TraceRecorder::instance()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceBuffer* TraceRecorder::threadBuffer()
+{
+    thread_local TraceBuffer *buffer = NULL;
+    if(!buffer) { //First span on this thread: register a new buffer
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer = new TraceBuffer((int)m_buffers.size() + 1);
+        m_buffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+void TraceRecorder::record(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    long long startUs = std::chrono::duration_cast<std::chrono::microseconds>(start - m_epoch).count();
+    long long durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    threadBuffer()->push(name, startUs, durationUs);
+}
+
+void TraceRecorder::setThreadName(const char *name)
+{
+    int tid = threadBuffer()->tid();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threadNames[tid] = name;
+}
+
+bool TraceRecorder::writeChromeTrace(const char *filename) const
+{
+    std::ofstream fid(filename);
+    if(!fid) {
+        fprintf(stderr, "Could not write trace to %s\n", filename);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    fid << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    long long dropped = 0;
+    for(size_t b=0; b<m_buffers.size(); b++) {
+        const TraceBuffer *buffer = m_buffers[b];
+        std::map<int, std::string>::const_iterator it = m_threadNames.find(buffer->tid());
+        std::string threadName = (it != m_threadNames.end())?it->second:("Worker " + std::to_string(buffer->tid()));
+        fid << (first?"":",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid()
+            << ", \"args\": {\"name\": \"" << threadName << "\"}}";
+        first = false;
+        int n = buffer->size(); //Snapshot; events past n may still be in flight
+        for(int i=0; i<n; i++) {
+            const TraceEvent &e = buffer->event(i);
+            fid << ",\n{\"name\": \"" << e.m_name << "\", \"cat\": \"blaze\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid()
+                << ", \"ts\": " << e.m_startUs << ", \"dur\": " << e.m_durationUs << "}";
+        }
+        dropped += buffer->dropped();
+    }
+    fid << "\n]}\n";
+    fid.close();
+    if(dropped) fprintf(stderr, "Trace buffers overflowed, %lld events dropped.\n", dropped);
+    fprintf(stderr, "Wrote trace to %s\n", filename);
+    return true;
+}
+
+ScopedSpan::ScopedSpan(const char *name) : m_name(name), m_stopped(false), m_bytes(0)
+{
+#if PROFILING
+    m_start = std::chrono::steady_clock::now();
+#endif
+}
+
+ScopedSpan::~ScopedSpan()
+{
+    stop();
+}
+
+void ScopedSpan::stop()
+{
+    if(m_stopped) return;
+    m_stopped = true;
+#if PROFILING
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    std::chrono::duration<float, std::milli> elapsed = end - m_start;
+    Profiler::instance().record(m_name, elapsed.count(), m_bytes);
+    TraceRecorder::instance().record(m_name, m_start, end);
+#endif
+}
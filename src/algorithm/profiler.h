@@ -0,0 +1,144 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PROFILER_RING_SIZE 256
+#define TRACE_BUFFER_SIZE 65536 // Events per thread; later events are dropped
+
+// Fixed size ring of the most recent samples of one quantity
+class SampleRing
+{
+public:
+    SampleRing();
+    void push(float value);
+    int const & size() const { return m_count;}
+    float last() const;
+    float mean() const;
+    float percentile(float p) const; // p in [0, 100]
+
+private:
+    float m_samples[PROFILER_RING_SIZE];
+    int m_next, m_count;
+};
+
+struct ProfilerStats {
+    int m_count;
+    float m_last, m_mean, m_p50, m_p95, m_p99; // Milliseconds
+    float m_lastMBps; // Bandwidth of the last sample, if it moved any bytes
+};
+
+// Process wide registry of timing channels (e.g. "load", "gpu.raycast"). Thread safe; spans recorded from
+// the preprocessing threads and the GUI thread end up in the same channels.
+class Profiler
+{
+public:
+    static Profiler& instance();
+    void record(const char *name, float ms, long long bytes = 0);
+    bool stats(const char *name, ProfilerStats &stats) const;
+    std::vector<std::string> channels() const;
+    void printSummary(FILE *fid) const;
+
+private:
+    struct Channel {
+        SampleRing m_ms;
+        long long m_lastBytes;
+    };
+    Profiler() {}
+    mutable std::mutex m_mutex;
+    std::map<std::string, Channel> m_channels;
+};
+
+struct TraceEvent {
+    const char *m_name;
+    long long m_startUs; // Relative to the TraceRecorder epoch
+    long long m_durationUs;
+};
+
+// Append-only event buffer owned by one thread. The owner publishes an event by bumping m_count after
+// writing it, so readers can take a consistent snapshot of [0, size()) without locking.
+class TraceBuffer
+{
+public:
+    explicit TraceBuffer(int tid);
+    void push(const char *name, long long startUs, long long durationUs); // Owner thread only
+    int size() const { return m_count.load(std::memory_order_acquire);}
+    TraceEvent const & event(int i) const { return m_events[i];}
+    int const & tid() const { return m_tid;}
+    long long dropped() const { return m_dropped.load(std::memory_order_relaxed);}
+
+private:
+    TraceEvent m_events[TRACE_BUFFER_SIZE];
+    std::atomic<int> m_count;
+    std::atomic<long long> m_dropped;
+    int m_tid;
+};
+
+// Collects spans from all threads into per-thread TraceBuffers and exports them as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Recording is lock-free; only a thread's first span takes a lock.
+class TraceRecorder
+{
+public:
+    static TraceRecorder& instance();
+    void record(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+    void setThreadName(const char *name); // Names the calling thread in the trace
+    bool writeChromeTrace(const char *filename) const;
+
+private:
+    TraceRecorder();
+    ~TraceRecorder();
+    TraceBuffer* threadBuffer();
+    std::chrono::steady_clock::time_point m_epoch;
+    mutable std::mutex m_mutex; // Guards the registry below, not the buffers
+    std::vector<TraceBuffer*> m_buffers;
+    std::map<int, std::string> m_threadNames;
+};
+
+// Times the enclosing scope into a Profiler channel and the trace. The name is kept by pointer until the trace
+// is written, so it must be a string literal.
+class ScopedSpan
+{
+public:
+    explicit ScopedSpan(const char *name);
+    ~ScopedSpan();
+    void setBytes(long long bytes) { m_bytes = bytes;}
+    void stop(); // Record now instead of at the end of the scope
+
+private:
+    const char *m_name;
+    bool m_stopped;
+    long long m_bytes;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,214 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "transferfunction1d.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+TransferFunction1D::TransferFunction1D()
+{
+    addAlphaNode(0.0, 1.0);
+    addAlphaNode(1.0, 1.0);
+    addColorNode(0.0, 0, 0, 255);
+    addColorNode(1.0, 255, 0, 0);
+}
+
+TransferFunction1D TransferFunction1D::channelDefault(int channel)
+{
+    //Green, magenta, yellow: apart from the volume's blue to red and from each other
+    const unsigned char palette[3][3] = {{0, 200, 0}, {220, 0, 220}, {230, 200, 0}};
+    const unsigned char *color = palette[(channel + 2)%3];
+    TransferFunction1D tf;
+    tf.clear();
+    tf.addAlphaNode(0.0, 0.0);
+    tf.addAlphaNode(1.0, 0.5);
+    tf.addColorNode(0.0, color[0], color[1], color[2]);
+    tf.addColorNode(1.0, color[0], color[1], color[2]);
+    return tf;
+}
+
+void TransferFunction1D::clear()
+{
+    m_alphaNodes.clear();
+    m_colorNodes.clear();
+}
+
+void TransferFunction1D::addAlphaNode(double key, double alpha)
+{
+    TFAlphaNode node = {key, alpha};
+    vector<TFAlphaNode>::iterator it = m_alphaNodes.begin();
+    while(it != m_alphaNodes.end() && it->m_key <= key) it++;
+    m_alphaNodes.insert(it, node);
+}
+
+void TransferFunction1D::addColorNode(double key, unsigned char red, unsigned char green, unsigned char blue)
+{
+    TFColorNode node = {key, red, green, blue};
+    vector<TFColorNode>::iterator it = m_colorNodes.begin();
+    while(it != m_colorNodes.end() && it->m_key <= key) it++;
+    m_colorNodes.insert(it, node);
+}
+
+//Value of attribute 'name' within a single XML tag, e.g. <Node Key="0.5" Value="#ff0000"/>
+static bool tagAttribute(string const &tag, const char *name, string &value)
+{
+    string pattern = string(name) + "=\"";
+    size_t pos = 0;
+    while((pos = tag.find(pattern, pos)) != string::npos) {
+        if(pos > 0 && !isspace(tag[pos - 1])) { pos++; continue; }
+        size_t begin = pos + pattern.size();
+        size_t end = tag.find('"', begin);
+        if(end == string::npos) return false;
+        value = tag.substr(begin, end - begin);
+        return true;
+    }
+    return false;
+}
+
+//Calls back with every <Node .../> tag inside <section> ... </section>
+template <typename Visitor>
+static void forEachNode(string const &xml, const char *section, Visitor visit)
+{
+    size_t begin = xml.find(string("<") + section + ">");
+    size_t end = xml.find(string("</") + section + ">");
+    if(begin == string::npos || end == string::npos) return;
+    size_t pos = begin;
+    while((pos = xml.find("<Node", pos)) != string::npos && pos < end) {
+        size_t close = xml.find('>', pos);
+        if(close == string::npos) break;
+        visit(xml.substr(pos, close - pos));
+        pos = close;
+    }
+}
+
+struct AlphaNodeReader {
+    TransferFunction1D *m_tf;
+    void operator()(string const &tag) {
+        string key, value;
+        if(tagAttribute(tag, "Key", key) && tagAttribute(tag, "Value", value))
+            m_tf->addAlphaNode(atof(key.c_str()), atof(value.c_str()));
+    }
+};
+
+struct ColorNodeReader {
+    TransferFunction1D *m_tf;
+    void operator()(string const &tag) {
+        string key, value;
+        unsigned int r, g, b;
+        if(tagAttribute(tag, "Key", key) && tagAttribute(tag, "Value", value) &&
+                sscanf(value.c_str(), "#%2x%2x%2x", &r, &g, &b) == 3)
+            m_tf->addColorNode(atof(key.c_str()), r, g, b);
+    }
+};
+
+bool TransferFunction1D::load(const char *filename)
+{
+    ifstream fid(filename);
+    if(!fid) {
+        fprintf(stderr, "Could not open 1D TF: %s\n", filename);
+        return false;
+    }
+    stringstream buffer;
+    buffer << fid.rdbuf();
+    string xml = buffer.str();
+
+    clear();
+    AlphaNodeReader alphaReader = {this};
+    ColorNodeReader colorReader = {this};
+    forEachNode(xml, "Alpha", alphaReader);
+    forEachNode(xml, "Color", colorReader);
+    if(!isValid()) {
+        fprintf(stderr, "Invalid 1D TF: %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+bool TransferFunction1D::save(const char *filename) const
+{
+    FILE *fid = fopen(filename, "w");
+    if(!fid) {
+        fprintf(stderr, "Could not write 1D TF: %s\n", filename);
+        return false;
+    }
+    //Same layout as QXmlStreamWriter with auto formatting
+    fprintf(fid, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<TransferFunction1D>\n    <Alpha>\n");
+    for(size_t i=0; i<m_alphaNodes.size(); i++)
+        fprintf(fid, "        <Node Key=\"%g\" Value=\"%g\"/>\n", m_alphaNodes[i].m_key, m_alphaNodes[i].m_alpha);
+    fprintf(fid, "    </Alpha>\n    <Color>\n");
+    for(size_t i=0; i<m_colorNodes.size(); i++)
+        fprintf(fid, "        <Node Key=\"%g\" Value=\"#%02x%02x%02x\"/>\n", m_colorNodes[i].m_key,
+                m_colorNodes[i].m_red, m_colorNodes[i].m_green, m_colorNodes[i].m_blue);
+    fprintf(fid, "    </Color>\n</TransferFunction1D>\n");
+    fclose(fid);
+    return true;
+}
+
+//Indices of the nodes bracketing key, and the interpolation weight of the second one
+template <typename Node>
+static void bracket(vector<Node> const &nodes, double key, int &i1, int &i2, double &frac)
+{
+    int n = nodes.size();
+    i2 = 0;
+    while(i2 < n - 1 && nodes[i2].m_key < key) i2++;
+    i1 = (i2 > 0)?(i2 - 1):0;
+    double k1 = nodes[i1].m_key;
+    double k2 = nodes[i2].m_key;
+    frac = (k2 > k1)?(key - k1)/(k2 - k1):1.0;
+    frac = std::min(std::max(frac, 0.0), 1.0);
+}
+
+void TransferFunction1D::bake(unsigned char *colorBuffer) const
+{
+    if(!isValid()) {
+        memset(colorBuffer, 0, TF1D_SIZE*4);
+        return;
+    }
+    int i1, i2;
+    double key, frac, alpha;
+    for(int i=0; i<TF1D_SIZE; i++) {
+        key = double(i)/(TF1D_SIZE - 1);
+        //1. Interpolate alpha
+        bracket(m_alphaNodes, key, i1, i2, frac);
+        alpha = m_alphaNodes[i1].m_alpha*(1 - frac) + m_alphaNodes[i2].m_alpha*frac;
+        colorBuffer[i*4 + 3] = 255.0*alpha;
+
+        //2. Interpolate color, premultiplied by alpha
+        bracket(m_colorNodes, key, i1, i2, frac);
+        TFColorNode const &c1 = m_colorNodes[i1];
+        TFColorNode const &c2 = m_colorNodes[i2];
+        colorBuffer[i*4 + 0] = (c1.m_red*(1 - frac) + c2.m_red*frac)*alpha;
+        colorBuffer[i*4 + 1] = (c1.m_green*(1 - frac) + c2.m_green*frac)*alpha;
+        colorBuffer[i*4 + 2] = (c1.m_blue*(1 - frac) + c2.m_blue*frac)*alpha;
+    }
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef TRANSFERFUNCTION1D_H
+#define TRANSFERFUNCTION1D_H
+
+#include <vector>
+
+#define TF1D_SIZE 256 // Number of entries of the baked RGBA lookup table
+
+struct TFAlphaNode {
+    double m_key; // Normalized scalar value in [0, 1]
+    double m_alpha;
+};
+
+struct TFColorNode {
+    double m_key;
+    unsigned char m_red, m_green, m_blue;
+};
+
+// Piecewise linear 1D transfer function with separate alpha and color nodes, as edited in Dialog1DTransferFunction.
+// Independent of Qt so that the headless tools can read .tf1 files and bake them exactly like the GUI does.
+class TransferFunction1D
+{
+public:
+    TransferFunction1D(); // Blue to red, fully opaque (the dialog's default)
+    static TransferFunction1D channelDefault(int channel); // Alpha ramp in a color of its own, for channels without a TF
+    void clear();
+    void addAlphaNode(double key, double alpha);
+    void addColorNode(double key, unsigned char red, unsigned char green, unsigned char blue);
+    std::vector<TFAlphaNode> const & alphaNodes() const { return m_alphaNodes;}
+    std::vector<TFColorNode> const & colorNodes() const { return m_colorNodes;}
+    bool isValid() const { return !m_alphaNodes.empty() && !m_colorNodes.empty();}
+
+    bool load(const char *filename); // .tf1 XML
+    bool save(const char *filename) const;
+    //Fills TF1D_SIZE RGBA entries with colors premultiplied by alpha (a.k.a. associated colors)
+    void bake(unsigned char *colorBuffer) const;
+
+private:
+    std::vector<TFAlphaNode> m_alphaNodes; // Sorted by key
+    std::vector<TFColorNode> m_colorNodes; // Sorted by key
+};
+
+#endif // TRANSFERFUNCTION1D_H
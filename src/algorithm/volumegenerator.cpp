@@ -0,0 +1,254 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "volumegenerator.h"
+#include "workstealingpool.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define GENERATOR_NOISE_OCTAVES 3
+#define GENERATOR_SLAB_SLICES 8 // Slices per task and per write
+#define GENERATOR_THRESHOLD_SAMPLES 65536 // Noise samples taken to place the blob threshold
+
+static inline unsigned int hash(unsigned int x, unsigned int y, unsigned int z, unsigned int seed)
+{
+    unsigned int h = seed*0x9e3779b9u ^ x*0x85ebca6bu ^ y*0xc2b2ae35u ^ z*0x27d4eb2fu;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    h *= 0x297a2d39u;
+    h ^= h >> 15;
+    return h;
+}
+
+static inline float lattice(int x, int y, int z, unsigned int seed)
+{
+    return (hash(x, y, z, seed) >> 8)*(1.0f/16777216.0f);
+}
+
+static inline float smooth(float t) { return t*t*(3.0f - 2.0f*t);}
+
+//Deterministic LCG for the placement of spheres and threshold samples
+static inline float random01(unsigned int &state)
+{
+    state = state*1664525u + 1013904223u;
+    return (state >> 8)*(1.0f/16777216.0f);
+}
+
+const char* sampleTypeName(VolumeSampleType type)
+{
+    switch(type) {
+    case SampleUnsignedChar: return "unsigned char";
+    case SampleUnsignedShort: return "unsigned short";
+    case SampleFloat: return "float";
+    }
+    return "unknown";
+}
+
+VolumeGenerator::VolumeGenerator(VolumeGeneratorParameters const &params)
+{
+    m_params = params;
+    m_params.m_count = std::max(m_params.m_count, 1);
+    m_params.m_occupancy = std::min(std::max(m_params.m_occupancy, 1e-6f), 1.0f);
+    m_threadCount = 0;
+    m_pool = NULL;
+
+    unsigned int state = m_params.m_seed;
+    float minSize = std::min(m_params.m_width, std::min(m_params.m_height, m_params.m_depth));
+    m_spheres = new float[5*m_params.m_count];
+    for(int i=0; i<m_params.m_count; i++) {
+        float *s = m_spheres + 5*i;
+        s[0] = (0.15 + 0.7*random01(state))*m_params.m_width;
+        s[1] = (0.15 + 0.7*random01(state))*m_params.m_height;
+        s[2] = (0.15 + 0.7*random01(state))*m_params.m_depth;
+        s[3] = (0.05 + 0.15*random01(state))*minSize;
+        s[4] = 0.3 + 0.7*random01(state);
+    }
+
+    m_threshold = 0.0;
+    if(m_params.m_pattern == PatternBlobs && m_params.m_occupancy < 1.0) {
+        std::vector<float> samples(GENERATOR_THRESHOLD_SAMPLES);
+        for(int i=0; i<GENERATOR_THRESHOLD_SAMPLES; i++)
+            samples[i] = noise(random01(state)*m_params.m_width, random01(state)*m_params.m_height, random01(state)*m_params.m_depth);
+        int k = (1.0 - m_params.m_occupancy)*(GENERATOR_THRESHOLD_SAMPLES - 1);
+        std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+        m_threshold = samples[k];
+    }
+}
+
+VolumeGenerator::~VolumeGenerator()
+{
+    delete m_pool;
+    delete []m_spheres;
+}
+
+void VolumeGenerator::setThreadCount(int threadCount)
+{
+    if(threadCount == m_threadCount) return;
+    m_threadCount = threadCount;
+    delete m_pool;
+    m_pool = NULL;
+}
+
+float VolumeGenerator::noise(float x, float y, float z) const
+{
+    float scale = m_params.m_frequency/std::max(m_params.m_width, std::max(m_params.m_height, m_params.m_depth));
+    float sum = 0.0, amplitude = 0.5, total = 0.0;
+    for(int octave=0; octave<GENERATOR_NOISE_OCTAVES; octave++) {
+        float u = x*scale, v = y*scale, w = z*scale;
+        float fu = floorf(u), fv = floorf(v), fw = floorf(w);
+        int i = fu, j = fv, k = fw;
+        float tx = smooth(u - fu), ty = smooth(v - fv), tz = smooth(w - fw);
+        unsigned int seed = m_params.m_seed + octave;
+        float c00 = lattice(i, j, k, seed) + tx*(lattice(i + 1, j, k, seed) - lattice(i, j, k, seed));
+        float c10 = lattice(i, j + 1, k, seed) + tx*(lattice(i + 1, j + 1, k, seed) - lattice(i, j + 1, k, seed));
+        float c01 = lattice(i, j, k + 1, seed) + tx*(lattice(i + 1, j, k + 1, seed) - lattice(i, j, k + 1, seed));
+        float c11 = lattice(i, j + 1, k + 1, seed) + tx*(lattice(i + 1, j + 1, k + 1, seed) - lattice(i, j + 1, k + 1, seed));
+        float c0 = c00 + ty*(c10 - c00), c1 = c01 + ty*(c11 - c01);
+        sum += amplitude*(c0 + tz*(c1 - c0));
+        total += amplitude;
+        amplitude *= 0.5;
+        scale *= 2.0;
+    }
+    return sum/total;
+}
+
+float VolumeGenerator::voxel(int x, int y, int z) const
+{
+    float px = x + 0.5, py = y + 0.5, pz = z + 0.5;
+    switch(m_params.m_pattern) {
+    case PatternNoise:
+        return noise(px, py, pz);
+    case PatternSpheres: {
+        float value = 0.0;
+        for(int i=0; i<m_params.m_count; i++) {
+            const float *s = m_spheres + 5*i;
+            float dx = px - s[0], dy = py - s[1], dz = pz - s[2];
+            float d = sqrtf(dx*dx + dy*dy + dz*dz) - s[3];
+            if(d < 1.0) value = std::max(value, s[4]*std::min(1.0f, 0.5f - 0.5f*d)); //Two voxel soft rim
+        }
+        return value;
+    }
+    case PatternBlobs: {
+        float n = noise(px, py, pz);
+        if(n <= m_threshold) return 0.0;
+        return std::min(1.0f, 0.05f + (n - m_threshold)/std::max(1.0f - m_threshold, 1e-6f));
+    }
+    case PatternLayers:
+        return layerValue(layerOffset(x, y), z);
+    }
+    return 0.0;
+}
+
+//Layers: vertical shift of the boundaries at column (x, y), up to half a layer
+float VolumeGenerator::layerOffset(int x, int y) const
+{
+    return (noise(x + 0.5, y + 0.5, 0.0) - 0.5)*0.5*m_params.m_depth/m_params.m_count;
+}
+
+float VolumeGenerator::layerValue(float offset, int z) const
+{
+    float layer = (z + 0.5 + offset)*m_params.m_count/m_params.m_depth;
+    int index = std::min(std::max((int)floorf(layer), 0), m_params.m_count - 1);
+    return (index + 1.0)/m_params.m_count;
+}
+
+void VolumeGenerator::generate(int z0, int z1, float *out)
+{
+    if(!m_pool) m_pool = new WorkStealingPool(m_threadCount);
+    long sliceSize = (long)m_params.m_width*m_params.m_height;
+    if(m_params.m_pattern == PatternLayers) { //Boundaries depend on x, y only
+        std::vector<float> offsets(sliceSize);
+        m_pool->run(m_params.m_height, [&](int y) {
+            for(int x=0; x<m_params.m_width; x++) offsets[y*m_params.m_width + x] = layerOffset(x, y);
+        });
+        m_pool->run(z1 - z0, [&](int slice) {
+            float *p = out + slice*sliceSize;
+            for(long i=0; i<sliceSize; i++) p[i] = layerValue(offsets[i], z0 + slice);
+        });
+        return;
+    }
+    m_pool->run(z1 - z0, [&](int slice) {
+        float *p = out + slice*sliceSize;
+        for(int y=0; y<m_params.m_height; y++)
+            for(int x=0; x<m_params.m_width; x++)
+                *p++ = voxel(x, y, z0 + slice);
+    });
+}
+
+template<typename T> static void quantize(const float *in, long n, float scale, T *out)
+{
+    for(long i=0; i<n; i++) out[i] = (T)(in[i]*scale + 0.5);
+}
+
+bool VolumeGenerator::writeNRRD(const char *filename, VolumeSampleType type)
+{
+    std::string rawName(filename);
+    size_t dot = rawName.rfind('.');
+    if(dot != std::string::npos && rawName.find('/', dot) == std::string::npos) rawName.erase(dot);
+    rawName += ".raw";
+    size_t slash = rawName.rfind('/');
+    std::string rawFile = (slash == std::string::npos)?rawName:rawName.substr(slash + 1);
+
+    FILE *header = fopen(filename, "w");
+    if(!header) {
+        fprintf(stderr, "Could not write %s\n", filename);
+        return false;
+    }
+    static const char *patternNames[] = {"noise", "spheres", "blobs", "layers"};
+    fprintf(header, "NRRD0004\ncontent: synthetic-%s\ntype: %s\ndimension: 3\nsizes: %d %d %d\nspacings: 1 1 1\n"
+                    "data file: ./%s\nendian: little\nencoding: raw\n", patternNames[m_params.m_pattern],
+            sampleTypeName(type), m_params.m_width, m_params.m_height, m_params.m_depth, rawFile.c_str());
+    fclose(header);
+
+    FILE *raw = fopen(rawName.c_str(), "wb");
+    if(!raw) {
+        fprintf(stderr, "Could not write %s\n", rawName.c_str());
+        return false;
+    }
+    long sliceSize = (long)m_params.m_width*m_params.m_height;
+    int sampleSize = (type == SampleUnsignedChar)?1:(type == SampleUnsignedShort)?2:4;
+    float *slab = new float[GENERATOR_SLAB_SLICES*sliceSize];
+    unsigned char *buffer = new unsigned char[GENERATOR_SLAB_SLICES*sliceSize*sampleSize];
+    bool ok = true;
+    for(int z=0; z<m_params.m_depth && ok; z+=GENERATOR_SLAB_SLICES) {
+        int slices = std::min(GENERATOR_SLAB_SLICES, m_params.m_depth - z);
+        long n = slices*sliceSize;
+        generate(z, z + slices, slab);
+        if(type == SampleUnsignedChar) quantize(slab, n, 255.0, buffer);
+        else if(type == SampleUnsignedShort) quantize(slab, n, 65535.0, (unsigned short*)buffer);
+        else memcpy(buffer, slab, n*sizeof(float));
+        ok = (fwrite(buffer, sampleSize, n, raw) == (size_t)n);
+    }
+    delete []slab;
+    delete []buffer;
+    if(fclose(raw) != 0) ok = false;
+    if(!ok) fprintf(stderr, "Could not write %s\n", rawName.c_str());
+    return ok;
+}
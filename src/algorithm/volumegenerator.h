@@ -0,0 +1,80 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef VOLUMEGENERATOR_H
+#define VOLUMEGENERATOR_H
+
+class WorkStealingPool;
+
+enum VolumePattern {PatternNoise, PatternSpheres, PatternBlobs, PatternLayers};
+enum VolumeSampleType {SampleUnsignedChar, SampleUnsignedShort, SampleFloat};
+
+struct VolumeGeneratorParameters {
+    VolumePattern m_pattern;
+    int m_width, m_height, m_depth;
+    unsigned int m_seed;
+    int m_count; // Spheres or layers
+    float m_frequency; // Noise features per volume edge (noise, blobs, layer boundaries)
+    float m_occupancy; // Blobs: fraction of non-zero voxels, in (0, 1]
+    VolumeGeneratorParameters() : m_pattern(PatternSpheres), m_width(128), m_height(128), m_depth(128), m_seed(1),
+        m_count(8), m_frequency(8.0), m_occupancy(0.1) {}
+};
+
+// Deterministic procedural volumes for benchmarks and tests. Every voxel is a pure function of its position and the
+// parameters, so a volume comes out the same whatever the slab size or the number of threads it is generated with,
+// and volumes larger than memory can be written slab by slab.
+//   noise:   fractal value noise
+//   spheres: m_count solid spheres of different densities with soft rims, over an empty background
+//   blobs:   thresholded noise, zero except in about m_occupancy of the voxels
+//   layers:  m_count stacked materials of increasing density along z, with wavy boundaries
+class VolumeGenerator
+{
+public:
+    explicit VolumeGenerator(VolumeGeneratorParameters const &params);
+    ~VolumeGenerator();
+    VolumeGeneratorParameters const & parameters() const { return m_params;}
+    void setThreadCount(int threadCount); // 0: all hardware threads
+
+    float voxel(int x, int y, int z) const; // In [0, 1]
+    //Slices [z0, z1) as normalized floats, x fastest; out holds width*height*(z1 - z0) values
+    void generate(int z0, int z1, float *out);
+    //Header and raw data of the whole volume, written slab by slab. filename is the .nhdr; the raw file gets the
+    //same name with the extension .raw
+    bool writeNRRD(const char *filename, VolumeSampleType type);
+
+private:
+    VolumeGeneratorParameters m_params;
+    float *m_spheres; // x, y, z, radius, density per sphere, in voxels
+    float m_threshold; // Blobs: noise level exceeded by m_occupancy of the voxels
+    int m_threadCount;
+    WorkStealingPool *m_pool;
+
+    float noise(float x, float y, float z) const; // Fractal noise in [0, 1], coordinates in voxels
+    float layerOffset(int x, int y) const;
+    float layerValue(float offset, int z) const;
+};
+
+const char* sampleTypeName(VolumeSampleType type); // As written in the NRRD header
+
+#endif // VOLUMEGENERATOR_H
@@ -23,17 +23,16 @@
 ****************************************************************************/
 
 #include "volumemanager.h"
+#include "volumegenerator.h"
+#include "profiler.h"
 #include "defines.h"
 
 #include <fstream>
 #include <string>
-#include <QFileInfo>
-#include <QDir>
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QtConcurrent>
-#include <QColor>
+#include <thread>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include <math.h>
 #include <float.h>
 
@@ -95,11 +94,13 @@ VolumeManager::~VolumeManager()
 
 void VolumeManager::readNHDR(const char *filename)
 {
+    ScopedSpan span("load");
     //Read the .nhdr first in text mode
     string line;
     int linecount = 0;
     ifstream fid(filename);
     int vol_typeSize;
+    bool bigEndian = false;
     char datafilename[256];
     if(fid) {
         while (getline(fid, line)) {
@@ -122,6 +123,9 @@ void VolumeManager::readNHDR(const char *filename)
                 else if (strncmp(type_str, "unsigned short", 14) == 0){
                     vol_typeSize = 2;
                 }
+                else if (strncmp(type_str, "float", 5) == 0){
+                    vol_typeSize = 4;
+                }
                 else {
                     fprintf(stderr, "Unknown data type: %s\n", type_str);
                     fid.close();
@@ -139,6 +143,8 @@ void VolumeManager::readNHDR(const char *filename)
                     fid.close();
                     return;
                 }
+            } else if (strncmp(line.c_str(), "endian", 6) == 0) {
+                bigEndian = (line.find("big") != string::npos);
             } else if (strncmp(line.c_str(), "data file", 9) == 0) {
                 sscanf(line.c_str(), "data file: %[^\n\r]\n", datafilename);
             }
@@ -148,78 +154,129 @@ void VolumeManager::readNHDR(const char *filename)
     fid.close();
 
     //Load data from binary raw file
-    int nelements = m_width*m_height*m_depth;
+    long nelements = (long)m_width*m_height*m_depth;
     m_data  = new float[nelements];
-
-    QFileInfo nhdr_file(filename);
-    QFileInfo raw_file(datafilename);
-    QString qdatafile("");
-    qdatafile.append(nhdr_file.path()).append("/").append(raw_file.fileName());
-    FILE *data_fid = fopen(qdatafile.toStdString().c_str(), "rb");
+    span.setBytes((long long)nelements*vol_typeSize);
+
+    //The raw file is looked up next to the header
+    string nhdrPath(filename), rawName(datafilename);
+    size_t slash = nhdrPath.rfind('/');
+    string directory = (slash == string::npos)?string("."):nhdrPath.substr(0, slash);
+    slash = rawName.rfind('/');
+    if(slash != string::npos) rawName = rawName.substr(slash + 1);
+    string datafile = directory + "/" + rawName;
+    FILE *data_fid = fopen(datafile.c_str(), "rb");
+    const unsigned short one = 1;
+    bool swapBytes = (vol_typeSize > 1) && (bigEndian != (*(const unsigned char*)&one == 0));
     if(data_fid) {
 #define IO_BLOCK_SIZE 4096
         char *block4k = new char[IO_BLOCK_SIZE*vol_typeSize];
         int elements_read;
-        int k=0;
+        long k=0;
         do {
             elements_read = fread((void*)block4k, vol_typeSize, IO_BLOCK_SIZE, data_fid);
             if(elements_read < 0) break;
             //Convert from NHRD data type to float and store in volume
             if(vol_typeSize == 1)
                 for(int i=0; i<elements_read; i++) *(m_data + k++) = (float)*((unsigned char*)block4k + i);
+            else if(vol_typeSize == 2 && swapBytes)
+                for(int i=0; i<elements_read; i++) {
+                    unsigned short v = *((unsigned short*)block4k + i);
+                    *(m_data + k++) = (float)(unsigned short)((v << 8) | (v >> 8));
+                }
             else if(vol_typeSize == 2)
                 for(int i=0; i<elements_read; i++) *(m_data + k++) = (float)*((unsigned short*)block4k + i);
+            else if(vol_typeSize == 4 && swapBytes)
+                for(int i=0; i<elements_read; i++) {
+                    unsigned int v = *((unsigned int*)block4k + i);
+                    v = (v << 24) | ((v << 8) & 0x00ff0000u) | ((v >> 8) & 0x0000ff00u) | (v >> 24);
+                    memcpy(m_data + k++, &v, sizeof(float));
+                }
+            else if(vol_typeSize == 4) {
+                memcpy(m_data + k, block4k, elements_read*sizeof(float));
+                k += elements_read;
+            }
         } while(elements_read == IO_BLOCK_SIZE);
 
         delete []block4k;
         fclose(data_fid);
     }
 
+    ScopedSpan convertSpan("convert");
+    convertSpan.setBytes((long long)nelements*sizeof(float));
     //Find min-max
     m_min = m_data[0];
     m_max = m_data[0];
-    for(int i=1; i<nelements; i++) {
+    for(long i=1; i<nelements; i++) {
         if (m_data[i] < m_min) m_min = m_data[i];
         if (m_data[i] > m_max) m_max = m_data[i];
     }
 
     //Rescale data to [0, 1]
-    for(int i=0; i<nelements; i++) {
+    for(long i=0; i<nelements; i++) {
         m_data[i] = (m_data[i] - m_min) / (m_max - m_min);
     }
+    convertSpan.stop();
 
     fprintf(stderr, "Read volume: %s\n", filename);
     fprintf(stderr, "\tName: %s\n", m_volumeName);
-    fprintf(stderr, "\tType: %s\n", (vol_typeSize==1)?"unsigned char":(vol_typeSize == 2)?"unsigned short":"unknown");
+    fprintf(stderr, "\tType: %s\n", (vol_typeSize==1)?"unsigned char":(vol_typeSize == 2)?"unsigned short":(vol_typeSize == 4)?"float":"unknown");
     fprintf(stderr, "\tSize: %d x %d x %d\n", m_width, m_height, m_depth);
     fprintf(stderr, "\tSpacing: %f x %f x %f\n", m_spacingX, m_spacingY, m_spacingZ);
     fprintf(stderr, "\tData range: [%f, %f] normalized to [0, 1]\n", m_min, m_max);
 
     computeHistogram();
+    span.stop(); //Don't account for the GUI work triggered below
 
-    emit volumeDataCreated(this);
+    notify(VolumeDataCreated);
+}
+
+void VolumeManager::generate(VolumeGenerator &generator)
+{
+    ScopedSpan span("generate");
+    VolumeGeneratorParameters const &params = generator.parameters();
+    if(m_data) delete []m_data;
+    m_width = params.m_width;
+    m_height = params.m_height;
+    m_depth = params.m_depth;
+    m_spacingX = m_spacingY = m_spacingZ = 1.0;
+    long nelements = (long)m_width*m_height*m_depth;
+    m_data = new float[nelements];
+    span.setBytes((long long)nelements*sizeof(float));
+    generator.generate(0, m_depth, m_data); //Already normalized
+    m_min = 0.0;
+    m_max = 1.0;
+    snprintf(m_volumeName, 256, "synthetic");
+
+    fprintf(stderr, "Generated volume:\n");
+    fprintf(stderr, "\tSize: %d x %d x %d\n", m_width, m_height, m_depth);
+
+    computeHistogram();
+    span.stop();
+
+    notify(VolumeDataCreated);
 }
 
 void VolumeManager::preprocess()
 {
     //Add any volume preprocessing code here.
     fprintf(stderr, "Processing volume:\n");
+    ScopedSpan span("preprocess");
 
 #if TIME_PROCESSES
     computeCannyEdges();
     computeGradient();
 #else
-    //Run independent tasks in seperate threads with QFuture class
-    //N.B.: Any task that depends on another must be started after the previous one has finished (use waitForFinished())
+    //Run independent tasks in seperate threads; the calling thread takes the gradient
+    //N.B.: Any task that depends on another must be started after the previous one has finished (use join())
 
-    QFuture<void> futureComputeCannyEdges = QtConcurrent::run(this, &VolumeManager::computeCannyEdges);
-    QFuture<void> futureComputeGradient = QtConcurrent::run(this, &VolumeManager::computeGradient);
-
-    futureComputeCannyEdges.waitForFinished();
-    futureComputeGradient.waitForFinished();
+    std::thread threadComputeCannyEdges(&VolumeManager::computeCannyEdges, this);
+    computeGradient();
+    threadComputeCannyEdges.join();
 #endif
 
-    emit volumePreprocessCompleted(this);
+    span.stop();
+    notify(VolumePreprocessCompleted);
     fprintf(stderr, "Done.\n");
 }
 
@@ -230,12 +287,13 @@ void VolumeManager::readVTK(const char *filename)
 
 void VolumeManager::computeHistogram()
 {
-    int count = m_width*m_height*m_depth;
+    ScopedSpan span("histogram");
+    long count = (long)m_width*m_height*m_depth;
     for(int i=0; i<m_histogram.m_nbins; i++)
         m_histogram.m_freq[i] = 0.0;
 
-    for(int i=0; i<count; i++)
-        m_histogram.m_freq[(int)ceil(m_data[i]*m_histogram.m_nbins)]++;
+    for(long i=0; i<count; i++)
+        m_histogram.m_freq[std::min((int)ceil(m_data[i]*m_histogram.m_nbins), m_histogram.m_nbins - 1)]++;
 
     for(int i=0; i<m_histogram.m_nbins; i++)
         m_histogram.m_logFreq[i] = log(1.0 + m_histogram.m_freq[i]);
@@ -244,6 +302,7 @@ void VolumeManager::computeHistogram()
 void VolumeManager::computeCannyEdges()
 {
     fprintf(stderr, "\tDetecting Canny edges... \n");
+    ScopedSpan span("edges");
 
     typedef itk::Image<float, 3> InputImageType;
     typedef itk::Image<unsigned char, 3> OutputImageType;
@@ -281,14 +340,16 @@ void VolumeManager::computeCannyEdges()
     OutputImageType::PixelContainer *container;
     container = output->GetPixelContainer();
     container->SetContainerManageMemory(false);
+    if(m_cannyEdges) delete []m_cannyEdges;
     m_cannyEdges = (unsigned char*) container->GetImportPointer();
 
     //Signal task completion to the application
-    emit volumeEdgesComputed(this);
+    notify(VolumeEdgesComputed);
 }
 
 void  VolumeManager::computeGradient() {
     fprintf(stderr, "\tComputing gradient... \n");
+    ScopedSpan span("gradient");
 
     typedef itk::CovariantVector<float, 3> GradientType;
     typedef itk::Image<float, 3> InputImageType;
@@ -305,11 +366,12 @@ void  VolumeManager::computeGradient() {
     gradientFilter->Update();
 
     gradientFilter->GetOutput()->GetPixelContainer()->SetContainerManageMemory(false);
+    if(m_gradient) delete []m_gradient;
     m_gradient = reinterpret_cast<float*>(gradientFilter->GetOutput()->GetPixelContainer()->GetImportPointer());
     gradientFilter->Update();
 
     //Signal task completion to the application
-    emit volumeGradientComputed(this);
+    notify(VolumeGradientComputed);
 }
 
 itk::Image<float, 3>::Pointer VolumeManager::getITKImage()
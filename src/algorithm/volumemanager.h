@@ -25,10 +25,12 @@
 #ifndef VOLUMEMANAGER_H
 #define VOLUMEMANAGER_H
 
-#include <QObject> //Need this to use Signal-Slot mechanism
+#include <functional>
 
 #define TINY 1e-12
 
+class VolumeGenerator;
+
 struct Histogram {
     int m_nbins;
     float* m_logFreq;
@@ -46,15 +48,21 @@ typedef itk::Image<GradientType, 3> GradientImageType;
 typedef itk::InterpolateImageFunction<FloatImageType, float> ImageInterpolatorType;
 typedef itk::InterpolateImageFunction<GradientImageType, float> GradientInterpolatorType;
 
-class VolumeManager : public QObject
-{
-    Q_OBJECT
+class VolumeManager;
+
+// Notifications of VolumeManager. Callbacks run on the thread that finished the step: the caller of readNHDR() and
+// generate() for VolumeDataCreated, a preprocessing thread for the others. GUI code has to hop to its own thread.
+enum VolumeEvent {VolumeDataCreated, VolumeEdgesComputed, VolumeGradientComputed, VolumePreprocessCompleted, VolumeEventCount};
+typedef std::function<void(VolumeManager *vm)> VolumeCallback;
 
+class VolumeManager
+{
 public:
     VolumeManager();
     ~VolumeManager();
     void readNHDR(const char *filename);
     void readVTK(const char* filename);
+    void generate(VolumeGenerator &generator); // Procedural volume straight into memory, no file involved
     int const & width() const { return m_width;}
     int const & height() const { return m_height;}
     int const & depth() const { return m_depth;}
@@ -67,12 +75,11 @@ public:
     itk::Image<float, 3>::Pointer getITKImage();
     Histogram const & histogram() const { return m_histogram; }
     void preprocess(); //Perform preprocessing and data preparation
-
-signals:
-    void volumeDataCreated(VolumeManager *vm);
-    void volumeEdgesComputed(VolumeManager *vm);
-    void volumeGradientComputed(VolumeManager *vm);
-    void volumePreprocessCompleted(VolumeManager *vm);
+    void setCallback(VolumeEvent event, VolumeCallback callback) { m_callbacks[event] = callback;}
+    //Individual preprocessing steps, run by preprocess() and readNHDR(); public for the benchmarks
+    void computeCannyEdges(); // Canny edge detection on volume
+    void computeGradient();
+    void computeHistogram();
 
 private:
     int m_width, m_height, m_depth;
@@ -81,16 +88,14 @@ private:
     char* m_volumeName;
     char* filePathName;
     Histogram m_histogram;
+    VolumeCallback m_callbacks[VolumeEventCount];
 
     //Derived data
     float *m_data; // Normalized voxel values in the range [0, 1]
     unsigned char *m_cannyEdges;// Edge voxels marked as 255
     float *m_gradient; // Stored as gx, gy, gz, gx, gy, gz, ...
 
-    //Private functions
-    void computeCannyEdges(); // Canny edge detection on volume
-    void computeGradient();
-    void computeHistogram();
+    void notify(VolumeEvent event) { if(m_callbacks[event]) m_callbacks[event](this);}
 };
 
 #endif // VOLUMEMANAGER_H
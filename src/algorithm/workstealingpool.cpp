@@ -0,0 +1,128 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "workstealingpool.h"
+
+WorkStealingPool::WorkStealingPool(int threadCount)
+{
+    if(threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+    if(threadCount <= 0) threadCount = 1;
+    m_task = NULL;
+    m_remaining = 0;
+    m_generation = 0;
+    m_stop = false;
+    for(int i=0; i<threadCount; i++)
+        m_workers.push_back(new Worker());
+    //Participant 0 is the thread calling run()
+    for(int i=1; i<threadCount; i++)
+        m_threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(size_t i=0; i<m_threads.size(); i++)
+        m_threads[i].join();
+    for(size_t i=0; i<m_workers.size(); i++)
+        delete m_workers[i];
+}
+
+void WorkStealingPool::run(int count, std::function<void(int)> const &task)
+{
+    if(count <= 0) return;
+    m_task = &task;
+    m_remaining = count;
+
+    //Contiguous blocks keep neighbouring tasks together
+    int n = m_workers.size();
+    for(int w=0; w<n; w++) {
+        std::lock_guard<std::mutex> lock(m_workers[w]->m_mutex);
+        for(int i=(long)count*w/n; i<(long)count*(w + 1)/n; i++)
+            m_workers[w]->m_tasks.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_remaining == 0; });
+}
+
+bool WorkStealingPool::pop(int worker, int &task)
+{
+    Worker *w = m_workers[worker];
+    std::lock_guard<std::mutex> lock(w->m_mutex);
+    if(w->m_tasks.empty()) return false;
+    task = w->m_tasks.front();
+    w->m_tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::steal(int thief, int &task)
+{
+    int n = m_workers.size();
+    for(int i=1; i<n; i++) {
+        Worker *victim = m_workers[(thief + i)%n];
+        std::lock_guard<std::mutex> lock(victim->m_mutex);
+        if(victim->m_tasks.empty()) continue;
+        task = victim->m_tasks.back();
+        victim->m_tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(int worker)
+{
+    int task;
+    while(pop(worker, task) || steal(worker, task)) {
+        (*m_task)(task);
+        if(--m_remaining == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::workerLoop(int worker)
+{
+    unsigned int seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+        if(m_stop) return;
+        seen = m_generation;
+        lock.unlock();
+        execute(worker);
+        lock.lock();
+    }
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size thread pool for data parallel loops. Task indices are split into contiguous blocks, one deque per
+// participant; a participant drains its own deque from the front and steals from the back of the others once it runs
+// dry, which keeps neighbouring tasks (e.g. image tiles) on the same core while balancing uneven task costs.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int threadCount = 0); // 0: one participant per hardware thread
+    ~WorkStealingPool();
+    int threadCount() const { return m_workers.size();} // Including the calling thread
+
+    //Runs task(i) for i in [0, count) and returns once all of them have finished. The calling thread takes part.
+    void run(int count, std::function<void(int)> const &task);
+
+private:
+    struct Worker {
+        std::deque<int> m_tasks;
+        std::mutex m_mutex;
+    };
+    std::vector<Worker*> m_workers;
+    std::vector<std::thread> m_threads;
+    std::function<void(int)> const *m_task;
+    std::atomic<int> m_remaining;
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_done;
+    unsigned int m_generation;
+    bool m_stop;
+
+    bool pop(int worker, int &task);
+    bool steal(int thief, int &task);
+    void execute(int worker);
+    void workerLoop(int worker);
+};
+
+#endif // WORKSTEALINGPOOL_H
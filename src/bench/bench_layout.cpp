@@ -0,0 +1,176 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// Linear vs bricked voxel layout: trilinear sampling along rays of different directions, and the CPU raycaster from
+// a few viewpoints. Along x both layouts stream through memory; along z the linear layout jumps a whole slice per step.
+
+#include <benchmark/benchmark.h>
+
+#include "algorithm/bricklayout.h"
+#include "algorithm/cpuraycaster.h"
+
+#include <math.h>
+#include <string>
+#include <vector>
+
+#define BENCH_LAYOUT_SIZE 256
+#define BENCH_LAYOUT_RAYS 4096
+
+enum RayDirection {DirectionX, DirectionY, DirectionZ, DirectionDiagonal};
+static const char *directionNames[] = {"x", "y", "z", "diagonal"};
+
+//Smooth synthetic volume, x fastest
+static std::vector<float> const & benchVolume()
+{
+    static std::vector<float> volume;
+    if(volume.empty()) {
+        const int n = BENCH_LAYOUT_SIZE;
+        volume.resize((long)n*n*n);
+        for(int z=0; z<n; z++)
+            for(int y=0; y<n; y++)
+                for(int x=0; x<n; x++)
+                    volume[x + (long)n*(y + (long)n*z)] = 0.5 + 0.25*sinf(x*0.05)*cosf(y*0.07) + 0.25*sinf(z*0.03 + x*0.01);
+    }
+    return volume;
+}
+
+static BrickLayout const & benchLayout()
+{
+    static BrickLayout layout;
+    if(layout.width() == 0) layout.setup(BENCH_LAYOUT_SIZE, BENCH_LAYOUT_SIZE, BENCH_LAYOUT_SIZE);
+    return layout;
+}
+
+static std::vector<float> const & benchBricks()
+{
+    static std::vector<float> bricks;
+    if(bricks.empty()) {
+        bricks.resize(benchLayout().size());
+        benchLayout().swizzle(benchVolume().data(), bricks.data());
+    }
+    return bricks;
+}
+
+//Border clamped trilinear fetch from the linear layout, as the CPU raycaster does it
+static inline float linearVoxel(const float *data, int n, int x, int y, int z)
+{
+    if(x < 0 || y < 0 || z < 0 || x >= n || y >= n || z >= n) return 0.0;
+    return data[x + (long)n*(y + (long)n*z)];
+}
+
+static inline float linearTrilinear(const float *data, int n, float u, float v, float w)
+{
+    float fu = floorf(u), fv = floorf(v), fw = floorf(w);
+    int x = fu, y = fv, z = fw;
+    float fx = u - fu, fy = v - fv, fz = w - fw;
+    float c00 = linearVoxel(data, n, x, y, z)*(1 - fx) + linearVoxel(data, n, x + 1, y, z)*fx;
+    float c10 = linearVoxel(data, n, x, y + 1, z)*(1 - fx) + linearVoxel(data, n, x + 1, y + 1, z)*fx;
+    float c01 = linearVoxel(data, n, x, y, z + 1)*(1 - fx) + linearVoxel(data, n, x + 1, y, z + 1)*fx;
+    float c11 = linearVoxel(data, n, x, y + 1, z + 1)*(1 - fx) + linearVoxel(data, n, x + 1, y + 1, z + 1)*fx;
+    float c0 = c00*(1 - fy) + c10*fy;
+    float c1 = c01*(1 - fy) + c11*fy;
+    return c0*(1 - fz) + c1*fz;
+}
+
+//Ray origins spread over the face the rays enter through, in texel units
+static void rayOrigin(RayDirection direction, int ray, float *origin, float *dir)
+{
+    const int n = BENCH_LAYOUT_SIZE;
+    float a = (ray*37 % n) + 0.3, b = (ray*101 % n) + 0.7;
+    dir[0] = dir[1] = dir[2] = 0.0;
+    switch(direction) {
+    case DirectionX: origin[0] = 0; origin[1] = a; origin[2] = b; dir[0] = 1; break;
+    case DirectionY: origin[0] = a; origin[1] = 0; origin[2] = b; dir[1] = 1; break;
+    case DirectionZ: origin[0] = a; origin[1] = b; origin[2] = 0; dir[2] = 1; break;
+    case DirectionDiagonal:
+        origin[0] = a*0.25; origin[1] = b*0.25; origin[2] = 0;
+        dir[0] = dir[1] = dir[2] = 1.0/sqrtf(3.0);
+        break;
+    }
+}
+
+template<bool bricked> static void BM_SampleAlongRays(benchmark::State &state)
+{
+    RayDirection direction = (RayDirection)state.range(0);
+    const int n = BENCH_LAYOUT_SIZE;
+    const float *data = bricked?benchBricks().data():benchVolume().data();
+    BrickLayout const &layout = benchLayout();
+    const float step = 0.5; //Texels
+    long samples = 0;
+    for(auto _ : state) {
+        float sum = 0.0;
+        for(int r=0; r<BENCH_LAYOUT_RAYS; r++) {
+            float o[3], d[3];
+            rayOrigin(direction, r, o, d);
+            for(float t=0; ; t+=step) {
+                float u = o[0] + d[0]*t, v = o[1] + d[1]*t, w = o[2] + d[2]*t;
+                if(u >= n || v >= n || w >= n) break;
+                sum += bricked?layout.sampleTrilinear(data, u, v, w):linearTrilinear(data, n, u, v, w);
+                samples++;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(samples);
+    state.SetLabel(directionNames[direction]);
+}
+BENCHMARK_TEMPLATE(BM_SampleAlongRays, false)->DenseRange(DirectionX, DirectionDiagonal)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SampleAlongRays, true)->DenseRange(DirectionX, DirectionDiagonal)->Unit(benchmark::kMillisecond);
+
+//Full CPU raycast, single thread, viewing along x (azimuth 90), z (0) and obliquely
+static void BM_RaycastLayout(benchmark::State &state)
+{
+    VolumeLayout layout = (VolumeLayout)state.range(0);
+    const int n = BENCH_LAYOUT_SIZE, size = 256;
+    static const float views[][2] = {{90, 0}, {0, 90}, {0, 0}, {35, 25}};
+    static const char *viewNames[] = {"x", "y", "z", "oblique"};
+    int view = state.range(1);
+
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    TransferFunction1D tf;
+    tf.clear();
+    tf.addAlphaNode(0.0, 0.0);
+    tf.addAlphaNode(1.0, 0.02);
+    tf.addColorNode(0.0, 0, 0, 255);
+    tf.addColorNode(1.0, 255, 0, 0);
+    tf.bake(colorBuffer);
+
+    CPURaycaster raycaster;
+    raycaster.setThreadCount(1);
+    raycaster.setVolume(n, n, n, benchVolume().data(), 1, 1, 1);
+    raycaster.setTransferFunction(colorBuffer);
+    raycaster.setVolumeLayout(layout);
+    Camera camera;
+    camera.m_azimuth = views[view][0];
+    camera.m_elevation = views[view][1];
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    std::vector<unsigned char> image(4*size*size);
+    raycaster.render(camera.viewMatrix(), camera.projectionMatrix(1.0), params, size, size, image.data()); //Builds bricks
+    for(auto _ : state)
+        raycaster.render(camera.viewMatrix(), camera.projectionMatrix(1.0), params, size, size, image.data());
+    state.SetItemsProcessed(state.iterations()*size*size);
+    state.SetLabel(std::string(layout == VolumeLayoutBricked?"bricked/":"linear/") + viewNames[view]);
+}
+BENCHMARK(BM_RaycastLayout)->ArgsProduct({{VolumeLayoutLinear, VolumeLayoutBricked}, {0, 1, 2, 3}})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,148 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// Load and preprocessing stages: volume generation, NRRD parse + conversion per sample type, histogram, gradient,
+// Canny edges, normal encoding and transfer function baking, on synthetic volumes of increasing size.
+
+#include <benchmark/benchmark.h>
+
+#include "algorithm/volumemanager.h"
+#include "algorithm/transferfunction1d.h"
+#include "algorithm/normals.h"
+#include "benchvolumes.h"
+
+#include <map>
+#include <vector>
+
+//Volume manager holding the synthetic volume of the given size, generated once
+static VolumeManager* loadedVolume(int size)
+{
+    static std::map<int, VolumeManager*> managers;
+    VolumeManager *&volume = managers[size];
+    if(!volume) {
+        volume = new VolumeManager();
+        VolumeGenerator generator(syntheticParameters(size));
+        volume->generate(generator);
+    }
+    return volume;
+}
+
+static void BM_Generate(benchmark::State &state)
+{
+    VolumeGeneratorParameters params = syntheticParameters(state.range(1));
+    params.m_pattern = (VolumePattern)state.range(0);
+    static const char *names[] = {"noise", "spheres", "blobs", "layers"};
+    long nelem = (long)params.m_width*params.m_height*params.m_depth;
+    std::vector<float> volume(nelem);
+    VolumeGenerator generator(params);
+    for(auto _ : state) {
+        generator.generate(0, params.m_depth, volume.data());
+        benchmark::DoNotOptimize(volume.data());
+    }
+    state.SetItemsProcessed(state.iterations()*nelem);
+    state.SetLabel(names[params.m_pattern]);
+}
+BENCHMARK(BM_Generate)->ArgsProduct({{PatternNoise, PatternSpheres, PatternBlobs, PatternLayers}, {128, 256}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ReadNHDR(benchmark::State &state)
+{
+    int size = state.range(0), bytesPerVoxel = state.range(1);
+    const char *file = syntheticNRRD(size, bytesPerVoxel);
+    for(auto _ : state) {
+        VolumeManager volume;
+        volume.readNHDR(file);
+        benchmark::DoNotOptimize(volume.data());
+    }
+    state.SetBytesProcessed(state.iterations()*bytesPerVoxel*(long long)size*size*size);
+    state.SetLabel(bytesPerVoxel == 1?"unsigned char":bytesPerVoxel == 2?"unsigned short":"float");
+}
+BENCHMARK(BM_ReadNHDR)->ArgsProduct({benchmark::CreateRange(128, BENCH_MAX_VOLUME_SIZE, 2), {1, 2, 4}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Histogram(benchmark::State &state)
+{
+    int size = state.range(0);
+    VolumeManager *volume = loadedVolume(size);
+    for(auto _ : state) {
+        volume->computeHistogram();
+        benchmark::DoNotOptimize(volume->histogram().m_freq[0]);
+    }
+    state.SetItemsProcessed(state.iterations()*(long long)size*size*size);
+}
+BENCHMARK(BM_Histogram)->RangeMultiplier(2)->Range(128, BENCH_MAX_VOLUME_SIZE)->Unit(benchmark::kMillisecond);
+
+static void BM_Gradient(benchmark::State &state)
+{
+    int size = state.range(0);
+    VolumeManager *volume = loadedVolume(size);
+    for(auto _ : state)
+        volume->computeGradient();
+    state.SetItemsProcessed(state.iterations()*(long long)size*size*size);
+}
+BENCHMARK(BM_Gradient)->RangeMultiplier(2)->Range(128, BENCH_MAX_FILTER_SIZE)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_CannyEdges(benchmark::State &state)
+{
+    int size = state.range(0);
+    VolumeManager *volume = loadedVolume(size);
+    for(auto _ : state)
+        volume->computeCannyEdges();
+    state.SetItemsProcessed(state.iterations()*(long long)size*size*size);
+}
+BENCHMARK(BM_CannyEdges)->RangeMultiplier(2)->Range(128, BENCH_MAX_FILTER_SIZE)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_EncodeNormals(benchmark::State &state)
+{
+    int size = state.range(0);
+    long nelem = (long)size*size*size;
+    const float *gradient = syntheticGradient(size);
+    std::vector<unsigned char> normals(4*nelem);
+    for(auto _ : state) {
+        encodeNormals(gradient, nelem, normals.data());
+        benchmark::DoNotOptimize(normals.data());
+    }
+    state.SetItemsProcessed(state.iterations()*nelem);
+}
+BENCHMARK(BM_EncodeNormals)->RangeMultiplier(2)->Range(128, BENCH_MAX_FILTER_SIZE)->Unit(benchmark::kMillisecond);
+
+//Baking cost grows with the number of nodes
+static void BM_TransferFunctionBake(benchmark::State &state)
+{
+    int nodes = state.range(0);
+    TransferFunction1D tf;
+    tf.clear();
+    for(int i=0; i<nodes; i++) {
+        float key = i/float(nodes - 1);
+        tf.addAlphaNode(key, (i%3)/2.0);
+        tf.addColorNode(key, (i*53)%256, (i*97)%256, (i*31)%256);
+    }
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    for(auto _ : state) {
+        tf.bake(colorBuffer);
+        benchmark::DoNotOptimize(colorBuffer);
+    }
+    state.SetItemsProcessed(state.iterations()*TF1D_SIZE);
+}
+BENCHMARK(BM_TransferFunctionBake)->Arg(2)->Arg(8)->Arg(64);
@@ -0,0 +1,104 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// CPU raycaster throughput against image resolution, volume size, thread count and volume occupancy.
+
+#include <benchmark/benchmark.h>
+
+#include "algorithm/cpuraycaster.h"
+#include "algorithm/normals.h"
+#include "benchvolumes.h"
+
+#include <thread>
+#include <vector>
+
+static void raycast(benchmark::State &state, int volumeSize, int imageSize, int threads, bool shading,
+                    const float *data = NULL)
+{
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    TransferFunction1D tf;
+    tf.clear();
+    tf.addAlphaNode(0.0, 0.0);
+    tf.addAlphaNode(0.15, 0.0);
+    tf.addAlphaNode(0.5, 0.1);
+    tf.addAlphaNode(1.0, 0.9);
+    tf.addColorNode(0.0, 0, 0, 255);
+    tf.addColorNode(1.0, 255, 128, 0);
+    tf.bake(colorBuffer);
+
+    long nelem = (long)volumeSize*volumeSize*volumeSize;
+    std::vector<unsigned char> normals;
+    CPURaycaster raycaster;
+    raycaster.setThreadCount(threads);
+    raycaster.setVolume(volumeSize, volumeSize, volumeSize, data?data:syntheticVolume(volumeSize), 1, 1, 1);
+    raycaster.setTransferFunction(colorBuffer);
+    if(shading) {
+        normals.resize(4*nelem);
+        encodeNormals(syntheticGradient(volumeSize), nelem, normals.data());
+        raycaster.setNormals(normals.data());
+    }
+    Camera camera;
+    camera.m_azimuth = 30;
+    camera.m_elevation = 20;
+    RaycastParameters params;
+    params.m_performPhongShading = shading;
+    std::vector<unsigned char> image(4L*imageSize*imageSize);
+    raycaster.render(camera.viewMatrix(), camera.projectionMatrix(1.0), params, imageSize, imageSize, image.data()); //Bricks
+    for(auto _ : state)
+        raycaster.render(camera.viewMatrix(), camera.projectionMatrix(1.0), params, imageSize, imageSize, image.data());
+    state.SetItemsProcessed(state.iterations()*(long long)imageSize*imageSize);
+    state.counters["threads"] = threads?threads:std::thread::hardware_concurrency();
+}
+
+static void BM_CPURaycastResolution(benchmark::State &state)
+{
+    raycast(state, 256, state.range(0), 0, state.range(1));
+}
+BENCHMARK(BM_CPURaycastResolution)->ArgsProduct({{256, 512, 1024}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_CPURaycastVolumeSize(benchmark::State &state)
+{
+    raycast(state, state.range(0), 512, 0, false);
+}
+BENCHMARK(BM_CPURaycastVolumeSize)->RangeMultiplier(2)->Range(128, BENCH_MAX_FILTER_SIZE)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_CPURaycastThreads(benchmark::State &state)
+{
+    raycast(state, 256, 512, state.range(0), false);
+}
+//1, 2, 4, ... up to the hardware threads
+static void threadCounts(benchmark::internal::Benchmark *benchmark)
+{
+    int hardware = std::thread::hardware_concurrency();
+    for(int threads=1; threads<hardware; threads*=2) benchmark->Arg(threads);
+    benchmark->Arg(hardware > 0?hardware:1);
+}
+BENCHMARK(BM_CPURaycastThreads)->Apply(threadCounts)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+//Sparse blobs, occupancy in percent
+static void BM_CPURaycastOccupancy(benchmark::State &state)
+{
+    raycast(state, 256, 512, 0, false, sparseVolume(256, state.range(0)/100.0));
+}
+BENCHMARK(BM_CPURaycastOccupancy)->Arg(1)->Arg(5)->Arg(20)->Arg(50)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,116 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "benchvolumes.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+static std::map<int, std::vector<float> > volumes;
+static std::map<int, std::vector<float> > gradients;
+static std::map<int, std::string> nrrdFiles;
+
+static void removeNRRDFiles()
+{
+    for(std::map<int, std::string>::iterator it = nrrdFiles.begin(); it != nrrdFiles.end(); ++it) {
+        remove(it->second.c_str());
+        std::string raw = it->second.substr(0, it->second.size() - 5) + ".raw";
+        remove(raw.c_str());
+    }
+}
+
+VolumeGeneratorParameters syntheticParameters(int size)
+{
+    VolumeGeneratorParameters params;
+    params.m_pattern = PatternSpheres;
+    params.m_width = params.m_height = params.m_depth = size;
+    params.m_count = 6;
+    return params;
+}
+
+const float* syntheticVolume(int size)
+{
+    std::vector<float> &volume = volumes[size];
+    if(!volume.empty()) return volume.data();
+
+    volume.resize((long)size*size*size);
+    VolumeGenerator generator(syntheticParameters(size));
+    generator.generate(0, size, volume.data());
+    return volume.data();
+}
+
+const float* sparseVolume(int size, float occupancy)
+{
+    static std::map<std::pair<int, float>, std::vector<float> > sparseVolumes;
+    std::vector<float> &volume = sparseVolumes[std::make_pair(size, occupancy)];
+    if(!volume.empty()) return volume.data();
+
+    VolumeGeneratorParameters params;
+    params.m_pattern = PatternBlobs;
+    params.m_width = params.m_height = params.m_depth = size;
+    params.m_occupancy = occupancy;
+    volume.resize((long)size*size*size);
+    VolumeGenerator generator(params);
+    generator.generate(0, size, volume.data());
+    return volume.data();
+}
+
+const float* syntheticGradient(int size)
+{
+    std::vector<float> &gradient = gradients[size];
+    if(!gradient.empty()) return gradient.data();
+
+    const float *v = syntheticVolume(size);
+    gradient.assign(3L*size*size*size, 0.0);
+    long sy = size, sz = (long)size*size;
+    for(int z=1; z<size - 1; z++)
+        for(int y=1; y<size - 1; y++)
+            for(int x=1; x<size - 1; x++) {
+                long i = x + sy*y + sz*z;
+                gradient[3*i] = 0.5*(v[i + 1] - v[i - 1]);
+                gradient[3*i + 1] = 0.5*(v[i + sy] - v[i - sy]);
+                gradient[3*i + 2] = 0.5*(v[i + sz] - v[i - sz]);
+            }
+    return gradient.data();
+}
+
+const char* syntheticNRRD(int size, int bytesPerVoxel)
+{
+    int key = size*8 + bytesPerVoxel;
+    std::string &file = nrrdFiles[key];
+    if(!file.empty()) return file.c_str();
+    if(nrrdFiles.size() == 1) atexit(removeNRRDFiles);
+
+    char name[256];
+    snprintf(name, sizeof(name), "blaze-bench-%d-%d.nhdr", size, bytesPerVoxel);
+    const char *tmp = getenv("TMPDIR");
+    file = std::string((tmp && *tmp)?tmp:"/tmp") + "/" + name;
+    VolumeGenerator generator(syntheticParameters(size));
+    generator.writeNRRD(file.c_str(), (bytesPerVoxel == 1)?SampleUnsignedChar:(bytesPerVoxel == 2)?SampleUnsignedShort:SampleFloat);
+    return file.c_str();
+}
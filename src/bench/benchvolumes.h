@@ -0,0 +1,47 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef BENCHVOLUMES_H
+#define BENCHVOLUMES_H
+
+#include "algorithm/volumegenerator.h"
+
+#define BENCH_MAX_VOLUME_SIZE 1024 // Edge of the largest volume for streaming stages (load, histogram); ~5 GB
+#define BENCH_MAX_FILTER_SIZE 512 // Largest volume for filters and rendering; 1024^3 would need ~20 GB for the gradient
+
+// Synthetic volumes for the benchmarks, generated on first use and kept for the whole run
+
+//size^3 normalized scalars, x fastest: VolumeGenerator spheres, so that transfer functions, histograms and edge
+//detection see structure rather than constant or random data
+const float* syntheticVolume(int size);
+//VolumeGenerator blobs with the given fraction of non-zero voxels, for sparsity dependent stages
+const float* sparseVolume(int size, float occupancy);
+//Gradient (gx, gy, gz, ...) of syntheticVolume(size) by central differences
+const float* syntheticGradient(int size);
+//syntheticVolume(size) quantized to unsigned char (bytesPerVoxel 1), unsigned short (2) or float (4) and written as
+//a raw NRRD in the temporary directory; returns the .nhdr path. Files are removed at exit.
+const char* syntheticNRRD(int size, int bytesPerVoxel);
+VolumeGeneratorParameters syntheticParameters(int size);
+
+#endif // BENCHVOLUMES_H
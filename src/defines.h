@@ -26,9 +26,27 @@
 #define DEFINES_H
 
 enum RaycastingInterpolationType {InterpolationNearestNeighbour, InterpolationTrilinear, Interpolationcubic};
+enum RenderBackend {RenderBackendGL, RenderBackendCPU, RenderBackendGLCompute};
+enum VolumeLayout {VolumeLayoutLinear, VolumeLayoutBricked};
+
+#define VOLUME_MAX_CHANNELS 4 // The volume and up to three co-registered channels, fused in one raycast pass
+#define CHANNEL_EXTENT_TOLERANCE 0.01 // Relative difference in proportions still accepted for a channel
+
+//Per-frame raycasting settings shared by the GL and CPU raycasters
+struct RaycastParameters {
+    float m_stepSize;
+    float m_opacityCorrection; // Ratio of the step size used to the configured one
+    bool m_useJittering;
+    bool m_performPhongShading;
+    bool m_preintegrated; // Classify segments between samples with the pre-integrated TF instead of single samples
+    float m_gradientOpacity; // 0..1: how far opacity is scaled by the normalized gradient magnitude, 0 disables
+    RaycastParameters() : m_stepSize(0.01), m_opacityCorrection(1.0), m_useJittering(false), m_performPhongShading(true),
+        m_preintegrated(false), m_gradientOpacity(0.0) {}
+};
 
 #define TIME_PROCESSES 0
 #define GL_DEBUG 0
+#define PROFILING 1 // Record ScopedSpan timings into the Profiler
 
 #endif // DEFINES_H
 
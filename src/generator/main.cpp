@@ -0,0 +1,143 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// blaze-generate: writes deterministic synthetic volumes as NRRD, e.g. for benchmarks and tests.
+//   blaze-generate -o blobs.nhdr --pattern blobs --size 1024 --occupancy 0.05 --type ushort
+//   blaze-generate -o layers.nhdr --pattern layers --width 512 --height 512 --depth 256 --count 6
+
+#include "algorithm/volumegenerator.h"
+#include "algorithm/profiler.h"
+#include "defines.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct GenerateJob {
+    const char *m_outputFile;
+    VolumeGeneratorParameters m_params;
+    VolumeSampleType m_type;
+    int m_threads;
+};
+
+static void printUsage()
+{
+    fprintf(stderr, "Usage: blaze-generate -o <volume.nhdr> [options]\n"
+                    "  -o, --output <file>      NRRD header; the raw data goes next to it with the extension .raw\n"
+                    "  -p, --pattern <name>     noise, spheres (default), blobs or layers\n"
+                    "  -s, --size <n>           Cube of n^3 voxels, default: 128\n"
+                    "  --width <n>, --height <n>, --depth <n>\n"
+                    "  --type <uchar|ushort|float>  Sample type, default: uchar\n"
+                    "  --seed <n>               Default: 1; the same seed always gives the same volume\n"
+                    "  --count <n>              Number of spheres or layers, default: 8\n"
+                    "  --frequency <f>          Noise features per volume edge, default: 8\n"
+                    "  --occupancy <f>          Blobs: fraction of non-zero voxels, default: 0.1\n"
+                    "  --threads <n>            Default: all hardware threads\n");
+}
+
+static bool parseArguments(int argc, char *argv[], GenerateJob &job)
+{
+    job.m_outputFile = NULL;
+    job.m_type = SampleUnsignedChar;
+    job.m_threads = 0;
+
+    for(int i=1; i<argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc)?argv[i + 1]:NULL;
+#define MATCH(s, l) (!strcmp(arg, s) || !strcmp(arg, l))
+#define NEEDS_VALUE if(!value) { fprintf(stderr, "Missing value for %s\n", arg); return false; } i++
+        if(MATCH("-o", "--output")) { NEEDS_VALUE; job.m_outputFile = value; }
+        else if(MATCH("-s", "--size")) {
+            NEEDS_VALUE;
+            job.m_params.m_width = job.m_params.m_height = job.m_params.m_depth = atoi(value);
+        }
+        else if(!strcmp(arg, "--width")) { NEEDS_VALUE; job.m_params.m_width = atoi(value); }
+        else if(!strcmp(arg, "--height")) { NEEDS_VALUE; job.m_params.m_height = atoi(value); }
+        else if(!strcmp(arg, "--depth")) { NEEDS_VALUE; job.m_params.m_depth = atoi(value); }
+        else if(!strcmp(arg, "--seed")) { NEEDS_VALUE; job.m_params.m_seed = strtoul(value, NULL, 10); }
+        else if(!strcmp(arg, "--count")) { NEEDS_VALUE; job.m_params.m_count = atoi(value); }
+        else if(!strcmp(arg, "--frequency")) { NEEDS_VALUE; job.m_params.m_frequency = atof(value); }
+        else if(!strcmp(arg, "--occupancy")) { NEEDS_VALUE; job.m_params.m_occupancy = atof(value); }
+        else if(!strcmp(arg, "--threads")) { NEEDS_VALUE; job.m_threads = atoi(value); }
+        else if(MATCH("-p", "--pattern")) {
+            NEEDS_VALUE;
+            if(!strcmp(value, "noise")) job.m_params.m_pattern = PatternNoise;
+            else if(!strcmp(value, "spheres")) job.m_params.m_pattern = PatternSpheres;
+            else if(!strcmp(value, "blobs")) job.m_params.m_pattern = PatternBlobs;
+            else if(!strcmp(value, "layers")) job.m_params.m_pattern = PatternLayers;
+            else {
+                fprintf(stderr, "Unknown pattern: %s\n", value);
+                return false;
+            }
+        }
+        else if(!strcmp(arg, "--type")) {
+            NEEDS_VALUE;
+            if(!strcmp(value, "uchar")) job.m_type = SampleUnsignedChar;
+            else if(!strcmp(value, "ushort")) job.m_type = SampleUnsignedShort;
+            else if(!strcmp(value, "float")) job.m_type = SampleFloat;
+            else {
+                fprintf(stderr, "Unknown sample type: %s\n", value);
+                return false;
+            }
+        }
+        else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+#undef NEEDS_VALUE
+#undef MATCH
+    }
+
+    if(!job.m_outputFile) {
+        fprintf(stderr, "No output file given.\n");
+        return false;
+    }
+    if(job.m_params.m_width <= 0 || job.m_params.m_height <= 0 || job.m_params.m_depth <= 0) {
+        fprintf(stderr, "Invalid volume size.\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    GenerateJob job;
+    if(!parseArguments(argc, argv, job)) {
+        printUsage();
+        return 1;
+    }
+
+    VolumeGenerator generator(job.m_params);
+    generator.setThreadCount(job.m_threads);
+    ScopedSpan span("generate");
+    if(!generator.writeNRRD(job.m_outputFile, job.m_type)) return 1;
+    span.stop();
+
+    VolumeGeneratorParameters const &p = job.m_params;
+    fprintf(stderr, "Wrote %s (%d x %d x %d, %s)\n", job.m_outputFile, p.m_width, p.m_height, p.m_depth, sampleTypeName(job.m_type));
+#if PROFILING
+    Profiler::instance().printSummary(stderr);
+#endif
+    return 0;
+}
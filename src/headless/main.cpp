@@ -0,0 +1,374 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// blaze-render: renders a volume to a PNG without a window system, e.g. for batch image generation.
+//   blaze-render -i data/engine.nhdr -t engine.tf1 -o engine.png --azimuth 30 --elevation 20
+//   blaze-render -i data/tooth.nhdr -c camera.json -o tooth.png --backend cpu
+//   blaze-render -i ct.nhdr -t ct.tf1 --channel pet.nhdr --channel-tf pet.tf1 --channel labels.nhdr --channel-nearest
+// camera.json: {"azimuth": 30, "elevation": 20, "distance": 2.5, "fov": 45, "width": 512, "height": 512}
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "headless/offscreencontext.h"
+#include "render/glheaders.h"
+#include "render/glraycaster.h"
+#include "algorithm/cpuraycaster.h"
+#include "algorithm/volumemanager.h"
+#include "algorithm/transferfunction1d.h"
+#include "algorithm/occupancygrid.h"
+#include "algorithm/normals.h"
+#include "algorithm/camera.h"
+#include "algorithm/profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//A co-registered volume fused into the same rays, see GLRaycaster::setChannel()
+struct ChannelJob {
+    const char *m_volumeFile;
+    const char *m_tfFile; // NULL: TransferFunction1D::channelDefault()
+    bool m_nearest;
+};
+
+struct RenderJob {
+    const char *m_volumeFile;
+    const char *m_tfFile;
+    const char *m_outputFile;
+    int m_width, m_height;
+    Camera m_camera;
+    RaycastParameters m_params;
+    RaycastingInterpolationType m_interpolation;
+    RenderBackend m_backend;
+    int m_threads;
+    bool m_useSIMD;
+    VolumeLayout m_layout;
+    const char *m_programCache;
+    int m_accumulate; // GL backends: frames averaged into the image, 0 renders one
+    bool m_onTheFlyGradients; // GL backends: no normals texture, and no gradient preprocessing
+    ChannelJob m_channels[VOLUME_MAX_CHANNELS - 1];
+    int m_nChannels;
+};
+
+static void printUsage()
+{
+    fprintf(stderr, "Usage: blaze-render -i <volume.nhdr> [options]\n"
+                    "  -i, --input <file>       NRRD volume (.nhdr + raw)\n"
+                    "  -t, --tf <file>          1D transfer function (.tf1), default: blue to red, opaque\n"
+                    "  -o, --output <file>      PNG image, default: render.png\n"
+                    "  -c, --camera <file>      JSON camera, overridden by the options below\n"
+                    "  --width <px>, --height <px>\n"
+                    "  --azimuth <deg>, --elevation <deg>, --distance <d>, --fov <deg>\n"
+                    "  --step <size>            Raycasting step size, default: 0.01\n"
+                    "  --nearest                Nearest neighbour instead of trilinear interpolation\n"
+                    "  --cubic                  B-spline tricubic instead of trilinear interpolation\n"
+                    "  --jitter                 Jittered sampling\n"
+                    "  --no-shading             Skip gradient computation and Phong shading\n"
+                    "  --preintegrated          Classify segments between samples with a pre-integrated TF\n"
+                    "  --gradient-opacity <k>   Scale opacity towards the gradient magnitude by k in [0, 1]\n"
+                    "  --on-the-fly-gradients   GL backends: shade with gradients computed in the shader, skipping the\n"
+                    "                           gradient computation and the normals texture\n"
+                    "  --accumulate <n>         GL backends: average n jittered frames (implies --jitter)\n"
+                    "  --channel <file>         Co-registered NRRD volume fused into the rendering, up to 3 times\n"
+                    "  --channel-tf <file>      TF of the last --channel, default: an alpha ramp in a color per channel\n"
+                    "  --channel-nearest        Sample the last --channel without interpolation (label volumes)\n"
+                    "  --software               Ask Mesa for its software rasterizer (llvmpipe)\n"
+                    "  --program-cache <dir>    Keep linked GL programs as driver binaries in <dir>\n"
+                    "  --backend <gl|gl-compute|cpu>\n"
+                    "                           Raycast with OpenGL (default), with OpenGL 4.3 compute shaders, or on the\n"
+                    "                           CPU, no GL context needed\n"
+                    "  --threads <n>            CPU backend threads, default: all hardware threads\n"
+                    "  --no-simd                CPU backend: scalar reference kernel instead of AVX2 ray packets\n"
+                    "  --linear-layout          CPU backend: sample the volume in place instead of from 8^3 bricks\n");
+}
+
+static bool readCameraFile(const char *filename, RenderJob &job)
+{
+    QFile file(filename);
+    if(!file.open(QFile::ReadOnly)) {
+        fprintf(stderr, "Could not open camera file: %s\n", filename);
+        return false;
+    }
+    QJsonParseError error;
+    QJsonObject camera = QJsonDocument::fromJson(file.readAll(), &error).object();
+    if(error.error != QJsonParseError::NoError) {
+        fprintf(stderr, "Invalid camera file %s: %s\n", filename, qPrintable(error.errorString()));
+        return false;
+    }
+    job.m_camera.m_azimuth = camera.value("azimuth").toDouble(job.m_camera.m_azimuth);
+    job.m_camera.m_elevation = camera.value("elevation").toDouble(job.m_camera.m_elevation);
+    job.m_camera.m_distance = camera.value("distance").toDouble(job.m_camera.m_distance);
+    job.m_camera.m_fovy = camera.value("fov").toDouble(job.m_camera.m_fovy);
+    job.m_width = camera.value("width").toInt(job.m_width);
+    job.m_height = camera.value("height").toInt(job.m_height);
+    return true;
+}
+
+static bool parseArguments(int argc, char *argv[], RenderJob &job)
+{
+    job.m_volumeFile = NULL;
+    job.m_tfFile = NULL;
+    job.m_outputFile = "render.png";
+    job.m_width = job.m_height = 512;
+    job.m_interpolation = InterpolationTrilinear;
+    job.m_backend = RenderBackendGL;
+    job.m_threads = 0;
+    job.m_useSIMD = true;
+    job.m_layout = VolumeLayoutBricked;
+    job.m_programCache = NULL;
+    job.m_accumulate = 0;
+    job.m_onTheFlyGradients = false;
+    job.m_nChannels = 0;
+
+    //The camera file is applied first so that command line values override it
+    for(int i=1; i<argc - 1; i++)
+        if(!strcmp(argv[i], "-c") || !strcmp(argv[i], "--camera"))
+            if(!readCameraFile(argv[i + 1], job)) return false;
+
+    for(int i=1; i<argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc)?argv[i + 1]:NULL;
+#define MATCH(s, l) (!strcmp(arg, s) || !strcmp(arg, l))
+#define NEEDS_VALUE if(!value) { fprintf(stderr, "Missing value for %s\n", arg); return false; } i++
+        if(MATCH("-i", "--input")) { NEEDS_VALUE; job.m_volumeFile = value; }
+        else if(MATCH("-t", "--tf")) { NEEDS_VALUE; job.m_tfFile = value; }
+        else if(MATCH("-o", "--output")) { NEEDS_VALUE; job.m_outputFile = value; }
+        else if(MATCH("-c", "--camera")) { NEEDS_VALUE; }
+        else if(!strcmp(arg, "--width")) { NEEDS_VALUE; job.m_width = atoi(value); }
+        else if(!strcmp(arg, "--height")) { NEEDS_VALUE; job.m_height = atoi(value); }
+        else if(!strcmp(arg, "--azimuth")) { NEEDS_VALUE; job.m_camera.m_azimuth = atof(value); }
+        else if(!strcmp(arg, "--elevation")) { NEEDS_VALUE; job.m_camera.m_elevation = atof(value); }
+        else if(!strcmp(arg, "--distance")) { NEEDS_VALUE; job.m_camera.m_distance = atof(value); }
+        else if(!strcmp(arg, "--fov")) { NEEDS_VALUE; job.m_camera.m_fovy = atof(value); }
+        else if(!strcmp(arg, "--step")) { NEEDS_VALUE; job.m_params.m_stepSize = atof(value); }
+        else if(!strcmp(arg, "--nearest")) job.m_interpolation = InterpolationNearestNeighbour;
+        else if(!strcmp(arg, "--cubic")) job.m_interpolation = Interpolationcubic;
+        else if(!strcmp(arg, "--jitter")) job.m_params.m_useJittering = true;
+        else if(!strcmp(arg, "--no-shading")) job.m_params.m_performPhongShading = false;
+        else if(!strcmp(arg, "--preintegrated")) job.m_params.m_preintegrated = true;
+        else if(!strcmp(arg, "--gradient-opacity")) { NEEDS_VALUE; job.m_params.m_gradientOpacity = atof(value); }
+        else if(!strcmp(arg, "--on-the-fly-gradients")) job.m_onTheFlyGradients = true;
+        else if(!strcmp(arg, "--accumulate")) { NEEDS_VALUE; job.m_accumulate = atoi(value); job.m_params.m_useJittering = true; }
+        else if(!strcmp(arg, "--channel")) {
+            NEEDS_VALUE;
+            if(job.m_nChannels == VOLUME_MAX_CHANNELS - 1) {
+                fprintf(stderr, "At most %d channels are supported.\n", VOLUME_MAX_CHANNELS - 1);
+                return false;
+            }
+            ChannelJob channel = {value, NULL, false};
+            job.m_channels[job.m_nChannels++] = channel;
+        }
+        else if(!strcmp(arg, "--channel-tf") || !strcmp(arg, "--channel-nearest")) {
+            if(!job.m_nChannels) {
+                fprintf(stderr, "%s needs a preceding --channel\n", arg);
+                return false;
+            }
+            if(!strcmp(arg, "--channel-nearest")) job.m_channels[job.m_nChannels - 1].m_nearest = true;
+            else { NEEDS_VALUE; job.m_channels[job.m_nChannels - 1].m_tfFile = value; }
+        }
+        else if(!strcmp(arg, "--software")) setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+        else if(!strcmp(arg, "--program-cache")) { NEEDS_VALUE; job.m_programCache = value; }
+        else if(!strcmp(arg, "--backend")) {
+            NEEDS_VALUE;
+            if(!strcmp(value, "cpu")) job.m_backend = RenderBackendCPU;
+            else if(!strcmp(value, "gl")) job.m_backend = RenderBackendGL;
+            else if(!strcmp(value, "gl-compute")) job.m_backend = RenderBackendGLCompute;
+            else {
+                fprintf(stderr, "Unknown backend: %s\n", value);
+                return false;
+            }
+        }
+        else if(!strcmp(arg, "--threads")) { NEEDS_VALUE; job.m_threads = atoi(value); }
+        else if(!strcmp(arg, "--no-simd")) job.m_useSIMD = false;
+        else if(!strcmp(arg, "--linear-layout")) job.m_layout = VolumeLayoutLinear;
+        else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+#undef NEEDS_VALUE
+#undef MATCH
+    }
+
+    if(!job.m_volumeFile) {
+        fprintf(stderr, "No input volume given.\n");
+        return false;
+    }
+    if(job.m_width <= 0 || job.m_height <= 0 || job.m_params.m_stepSize <= 0.0 || job.m_accumulate < 0 ||
+            job.m_accumulate > ACCUMULATION_MAX_FRAMES || job.m_params.m_gradientOpacity < 0.0 ||
+            job.m_params.m_gradientOpacity > 1.0) {
+        fprintf(stderr, "Invalid image size, step size, frame count or gradient opacity.\n");
+        return false;
+    }
+    return true;
+}
+
+//Uploads the channels of the job, identically for both raycasters
+template <class Raycaster>
+static void setChannels(Raycaster &raycaster, RenderJob const &job, VolumeManager *volumes, unsigned char (*colorBuffers)[TF1D_SIZE*4])
+{
+    for(int i=0; i<job.m_nChannels; i++) {
+        VolumeManager &volume = volumes[i];
+        if(raycaster.setChannel(i + 1, volume.width(), volume.height(), volume.depth(), volume.data(), volume.spacingX(),
+                                volume.spacingY(), volume.spacingZ(), job.m_channels[i].m_nearest))
+            raycaster.setChannelTransferFunction(i + 1, colorBuffers[i]);
+    }
+}
+
+static QByteArray readResource(const char *name)
+{
+    QFile file(name);
+    file.open(QFile::ReadOnly);
+    return file.readAll();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    RenderJob job;
+    if(!parseArguments(argc, argv, job)) {
+        printUsage();
+        return 1;
+    }
+
+    //Transfer function
+    TransferFunction1D tf;
+    if(job.m_tfFile && !tf.load(job.m_tfFile)) return 1;
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    tf.bake(colorBuffer);
+
+    //Volume
+    VolumeManager volume;
+    volume.readNHDR(job.m_volumeFile);
+    if(!volume.data() || volume.width() <= 0) {
+        fprintf(stderr, "Could not read volume: %s\n", job.m_volumeFile);
+        return 1;
+    }
+    bool onTheFly = job.m_onTheFlyGradients && job.m_backend != RenderBackendCPU;
+    if((job.m_params.m_performPhongShading || job.m_params.m_gradientOpacity > 0.0) && !onTheFly)
+        volume.preprocess(); //Synchronous; computes the gradient
+    long nelem = (long)volume.width()*volume.height()*volume.depth();
+
+    //Channels
+    VolumeManager channelVolumes[VOLUME_MAX_CHANNELS - 1];
+    unsigned char channelColors[VOLUME_MAX_CHANNELS - 1][TF1D_SIZE*4];
+    for(int i=0; i<job.m_nChannels; i++) {
+        ChannelJob const &channel = job.m_channels[i];
+        TransferFunction1D channelTF = TransferFunction1D::channelDefault(i + 1);
+        if(channel.m_tfFile && !channelTF.load(channel.m_tfFile)) return 1;
+        channelTF.bake(channelColors[i]);
+        channelVolumes[i].readNHDR(channel.m_volumeFile);
+        if(!channelVolumes[i].data() || channelVolumes[i].width() <= 0) {
+            fprintf(stderr, "Could not read channel: %s\n", channel.m_volumeFile);
+            return 1;
+        }
+    }
+
+    unsigned char *normals = NULL;
+    if(volume.gradient()) {
+        normals = new unsigned char[4*nelem];
+        encodeNormals(volume.gradient(), nelem, normals);
+    }
+    Mat4 view = job.m_camera.viewMatrix();
+    Mat4 projection = job.m_camera.projectionMatrix(job.m_width/float(job.m_height));
+    QImage image(job.m_width, job.m_height, QImage::Format_RGBA8888);
+
+    if(job.m_backend == RenderBackendCPU) {
+        CPURaycaster raycaster;
+        raycaster.setThreadCount(job.m_threads);
+        raycaster.setUseSIMD(job.m_useSIMD);
+        raycaster.setVolumeLayout(job.m_layout);
+        raycaster.setVolume(volume.width(), volume.height(), volume.depth(), volume.data(),
+                            volume.spacingX(), volume.spacingY(), volume.spacingZ());
+        raycaster.setInterpolationType(job.m_interpolation);
+        raycaster.setTransferFunction(colorBuffer);
+        raycaster.setNormals(normals);
+        setChannels(raycaster, job, channelVolumes, channelColors);
+        fprintf(stderr, "Renderer: CPU (%s)\n", raycaster.usesSIMD()?"AVX2":"scalar");
+
+        ScopedSpan span("frame");
+        raycaster.render(view, projection, job.m_params, job.m_width, job.m_height, image.bits());
+        span.stop();
+    } else {
+        //Context and raycaster
+        OffscreenContext context;
+        if(!context.create(job.m_width, job.m_height)) return 1;
+        fprintf(stderr, "Renderer: %s\n", context.renderer());
+
+        GLRaycaster raycaster;
+        raycaster.setUseCompute(job.m_backend == RenderBackendGLCompute);
+        raycaster.setAccumulation(job.m_accumulate > 0);
+        if(job.m_programCache) {
+            if(QDir().mkpath(job.m_programCache)) raycaster.setProgramCache(job.m_programCache);
+            else fprintf(stderr, "Could not create program cache directory: %s\n", job.m_programCache);
+        }
+        if(!raycaster.create(readResource(":/shaders/cube.vs").constData(), readResource(":/shaders/cube.fs").constData()))
+            return 1;
+        if(job.m_backend == RenderBackendGLCompute && !raycaster.usesCompute())
+            fprintf(stderr, "OpenGL 4.3 is not available, using the fragment raycaster\n");
+        raycaster.setVolume(volume.width(), volume.height(), volume.depth(), volume.data(),
+                            volume.spacingX(), volume.spacingY(), volume.spacingZ());
+        raycaster.setInterpolationType(job.m_interpolation);
+        raycaster.setTransferFunction(colorBuffer);
+        if(normals) raycaster.setNormals(normals);
+        raycaster.setOnTheFlyGradients(onTheFly);
+        setChannels(raycaster, job, channelVolumes, channelColors);
+        BrickRanges ranges;
+        ranges.compute(volume.data(), volume.width(), volume.height(), volume.depth(), OCCUPANCY_BRICK_SIZE);
+        OccupancyGrid occupancy;
+        occupancy.classify(ranges, colorBuffer, 1);
+        raycaster.setOccupancy(occupancy);
+
+        //Render
+        ScopedSpan span("frame");
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        int frames = job.m_accumulate > 0?job.m_accumulate:1;
+        for(int i=0; i<frames; i++) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            raycaster.render(view, projection, job.m_params);
+        }
+        context.readPixels(image.bits());
+        span.stop();
+        if(job.m_programCache) //The frame includes building its program variant: cold without cached binaries
+            fprintf(stderr, "Programs: %d loaded from cache, %d compiled\n", raycaster.programCacheHits(), raycaster.programCacheMisses());
+
+        raycaster.destroy();
+        context.destroy();
+    }
+    delete []normals;
+
+    if(!image.save(job.m_outputFile, "PNG")) {
+        fprintf(stderr, "Could not write image: %s\n", job.m_outputFile);
+        return 1;
+    }
+    fprintf(stderr, "Wrote %s (%d x %d)\n", job.m_outputFile, job.m_width, job.m_height);
+#if PROFILING
+    Profiler::instance().printSummary(stderr);
+#endif
+    return 0;
+}
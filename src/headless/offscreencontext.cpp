@@ -0,0 +1,180 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "offscreencontext.h"
+#include "render/glheaders.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_EGL_DEVICES 16
+
+OffscreenContext::OffscreenContext()
+{
+    m_display = m_context = m_surface = NULL;
+    m_framebuffer = m_colorBuffer = 0;
+    m_width = m_height = 0;
+}
+
+OffscreenContext::~OffscreenContext()
+{
+    destroy();
+}
+
+bool OffscreenContext::initializeDisplay()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    PFNEGLQUERYDEVICESEXTPROC queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+
+    //1. Headless GPUs
+    if(getPlatformDisplay && queryDevices) {
+        EGLDeviceEXT devices[MAX_EGL_DEVICES];
+        EGLint nDevices = 0;
+        queryDevices(MAX_EGL_DEVICES, devices, &nDevices);
+        for(int i=0; i<nDevices; i++) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], NULL);
+            if(display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+                m_display = display;
+                return true;
+            }
+        }
+    }
+
+    //2. Mesa without any window system
+    if(getPlatformDisplay) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+            m_display = display;
+            return true;
+        }
+    }
+
+    //3. Whatever the EGL implementation picks
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+        m_display = display;
+        return true;
+    }
+    return false;
+}
+
+bool OffscreenContext::create(int width, int height)
+{
+    if(!initializeDisplay()) {
+        fprintf(stderr, "Could not initialize an EGL display.\n");
+        return false;
+    }
+
+    EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                 EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                 EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+                                 EGL_NONE};
+    EGLConfig config = NULL;
+    EGLint nConfigs = 0;
+    if(!eglChooseConfig(m_display, configAttributes, &config, 1, &nConfigs) || nConfigs == 0) {
+        //Surfaceless displays may not expose pbuffer configs; any GL config will do
+        EGLint anyAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        eglChooseConfig(m_display, anyAttributes, &config, 1, &nConfigs);
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 1,
+                                  EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                  EGL_NONE};
+    m_context = eglCreateContext(m_display, (nConfigs > 0)?config:NULL, EGL_NO_CONTEXT, contextAttributes);
+    if(m_context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Could not create an OpenGL 4.1 core context (EGL error 0x%x).\n", eglGetError());
+        destroy();
+        return false;
+    }
+
+    //We render into our own FBO; only fall back to a dummy pbuffer if surfaceless contexts are unsupported
+    const char *extensions = eglQueryString(m_display, EGL_EXTENSIONS);
+    if(!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        m_surface = eglCreatePbufferSurface(m_display, config, pbufferAttributes);
+    }
+    if(!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+        fprintf(stderr, "Could not make the EGL context current (EGL error 0x%x).\n", eglGetError());
+        destroy();
+        return false;
+    }
+
+    //Framebuffer
+    m_width = width;
+    m_height = height;
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Offscreen framebuffer is incomplete.\n");
+        destroy();
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void OffscreenContext::destroy()
+{
+    if(m_context && eglGetCurrentContext() == m_context) {
+        if(m_framebuffer) glDeleteFramebuffers(1, &m_framebuffer);
+        if(m_colorBuffer) glDeleteRenderbuffers(1, &m_colorBuffer);
+    }
+    m_framebuffer = m_colorBuffer = 0;
+    if(m_display) {
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(m_surface) eglDestroySurface(m_display, m_surface);
+        if(m_context) eglDestroyContext(m_display, m_context);
+        eglTerminate(m_display);
+    }
+    m_display = m_context = m_surface = NULL;
+}
+
+const char* OffscreenContext::renderer() const
+{
+    return m_context?(const char*)glGetString(GL_RENDERER):"none";
+}
+
+void OffscreenContext::readPixels(unsigned char *rgba)
+{
+    glFinish();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    //GL rows are bottom-up
+    int stride = 4*m_width;
+    unsigned char *row = new unsigned char[stride];
+    for(int y=0; y<m_height/2; y++) {
+        memcpy(row, rgba + y*stride, stride);
+        memcpy(rgba + y*stride, rgba + (m_height - 1 - y)*stride, stride);
+        memcpy(rgba + (m_height - 1 - y)*stride, row, stride);
+    }
+    delete [] row;
+}
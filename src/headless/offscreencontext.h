@@ -0,0 +1,52 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef OFFSCREENCONTEXT_H
+#define OFFSCREENCONTEXT_H
+
+// Window-system free OpenGL 4.1 core context through EGL, with a single RGBA8 framebuffer to render into.
+// Tries GPU devices first (EGL_EXT_platform_device), then Mesa's surfaceless platform (llvmpipe works here),
+// then the default display.
+class OffscreenContext
+{
+public:
+    OffscreenContext();
+    ~OffscreenContext();
+    bool create(int width, int height);
+    void destroy();
+    int width() const { return m_width;}
+    int height() const { return m_height;}
+    const char* renderer() const;
+    //Reads the framebuffer back as top-down RGBA8 rows
+    void readPixels(unsigned char *rgba);
+
+private:
+    void *m_display, *m_context, *m_surface;
+    unsigned int m_framebuffer, m_colorBuffer;
+    int m_width, m_height;
+
+    bool initializeDisplay();
+};
+
+#endif // OFFSCREENCONTEXT_H
@@ -0,0 +1,1194 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "glraycaster.h"
+#include "glheaders.h"
+#include "algorithm/bluenoise.h"
+#include "algorithm/normals.h"
+#include "algorithm/occupancygrid.h"
+#include "algorithm/profiler.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RAY_SETUP_PROGRAM_KEY 0xffffffffu // Program of the ray setup pass, outside the variantKey() range
+#define COMPOSITE_PROGRAM_KEY 0xfffffffeu // Program blending a ray image (compute, accumulation)
+#define REPROJECT_PROGRAM_KEY 0xfffffffdu // Program carrying the previous frame's pixels forward
+
+//recordFrame() results
+#define FRAME_VIEW_CHANGED 1
+#define FRAME_SETTINGS_CHANGED 2 // Anything that changes the image of an unmoved camera
+#define COMPUTE_TILE_SIZE 8 // TILE_SIZE in cube.fs
+#define COMPUTE_PERSISTENT_GROUPS 512 // Work groups kept resident; they share the tiles through an atomic counter
+#define CHANNEL_TEXTURE_UNIT 9 // Channel volumes on units 9.., their TFs on the units after those
+
+//Where freeTextureMemory() comes from
+#define MEMORY_INFO_NONE 0
+#define MEMORY_INFO_NVX 1 // GL_NVX_gpu_memory_info
+#define MEMORY_INFO_ATI 2 // GL_ATI_meminfo
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+static GLuint compileShader(GLenum type, const char *source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if(!status) {
+        char log[4096];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Shader compilation failed:\n%s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint linkProgram(const char *vertexShaderSource, const char *fragmentShaderSource, bool retrievable)
+{
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if(!vs || !fs) {
+        if(vs) glDeleteShader(vs);
+        if(fs) glDeleteShader(fs);
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glBindAttribLocation(program, 0, "position");
+    if(retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(!status) {
+        char log[4096];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Program link failed:\n%s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static GLuint linkComputeProgram(const char *computeShaderSource, bool retrievable)
+{
+#ifdef GL_COMPUTE_SHADER
+    GLuint cs = compileShader(GL_COMPUTE_SHADER, computeShaderSource);
+    if(!cs) return 0;
+    GLuint program = glCreateProgram();
+    glAttachShader(program, cs);
+    if(retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDeleteShader(cs);
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(!status) {
+        char log[4096];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Program link failed:\n%s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+#else
+    (void)computeShaderSource;
+    (void)retrievable;
+    return 0; //Headers without OpenGL 4.3
+#endif
+}
+
+GLRaycaster::GLRaycaster()
+{
+    m_VAO = m_VBO = 0;
+    m_nVertices = 0;
+    m_width = m_height = m_depth = 0;
+    m_useEmptySpaceSkipping = 0;
+    m_interpolationType = InterpolationTrilinear;
+    m_programCacheHits = m_programCacheMisses = 0;
+    m_textureVol = m_textureTF1D = m_textureNoise = m_textureVolNormals = m_textureOccupancy = m_texturePreintegrated = 0;
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) {
+        m_textureChannel[i] = m_textureChannelTF[i] = 0;
+        m_channelEnabled[i] = false;
+    }
+    memset(m_tfColors, 0, sizeof(m_tfColors));
+    m_preintegratedUploaded = false;
+    m_exitFBO = m_textureExit = 0;
+    m_exitWidth = m_exitHeight = 0;
+    m_computeSupported = m_useCompute = false;
+    m_raycastFBO = m_textureRaycast = m_tileCounter = 0;
+    m_raycastWidth = m_raycastHeight = 0;
+    m_useAccumulation = false;
+    m_accumulatedFrames = 0;
+    m_jitterFrame = 0;
+    m_accumulationFBO = m_textureAccumulation = 0;
+    m_accumulationWidth = m_accumulationHeight = 0;
+    m_frameKey = 0;
+    m_frameStepSize = m_frameOpacityCorrection = m_frameGradientOpacity = 0.0f;
+    memset(m_frameViewport, 0, sizeof(m_frameViewport));
+    m_useReprojection = m_reprojectionValid = m_reprojectionQueried = false;
+    m_texturePrevRaycast = m_texturePoints = m_texturePrevPoints = m_raycastDepth = m_reprojectionQuery = 0;
+    m_reprojectionWidth = m_reprojectionHeight = 0;
+    m_onTheFlyGradients = false;
+    m_gradientScale = 0.0f;
+    m_volumeData = NULL;
+    m_memoryInfo = MEMORY_INFO_NONE;
+}
+
+GLRaycaster::~GLRaycaster()
+{
+    //GL objects must be released with destroy() while the context is still current
+}
+
+void GLRaycaster::setProgramCache(const char *directory)
+{
+    m_programCacheDirectory = directory?directory:"";
+}
+
+bool GLRaycaster::create(const char *vertexShaderSource, const char *fragmentShaderSource)
+{
+    m_vertexSource = vertexShaderSource;
+    m_fragmentSource = fragmentShaderSource;
+
+    //Compile the default variant up front so that broken sources are reported here
+    RaycastParameters defaults;
+    if(!program(variantKey(defaults)).m_program) {
+        m_programs.clear();
+        return false;
+    }
+
+#ifdef GL_COMPUTE_SHADER
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    m_computeSupported = (major > 4 || (major == 4 && minor >= 3));
+#endif
+    GLint nExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+    for(GLint i=0; i<nExtensions; i++) {
+        const char *extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if(!strcmp(extension, "GL_NVX_gpu_memory_info")) m_memoryInfo = MEMORY_INFO_NVX;
+        else if(!strcmp(extension, "GL_ATI_meminfo")) m_memoryInfo = MEMORY_INFO_ATI;
+    }
+    createCube();
+    return true;
+}
+
+unsigned int GLRaycaster::variantKey(RaycastParameters const &params) const
+{
+    unsigned int key = 0;
+    if(params.m_performPhongShading) key |= VariantPhongShading;
+    if(params.m_useJittering) key |= VariantJittering;
+    if(m_useEmptySpaceSkipping && !channelMask()) key |= VariantEmptySpaceSkipping;
+    if(params.m_opacityCorrection != 1.0f) key |= VariantOpacityCorrection;
+    if(params.m_preintegrated) key |= VariantPreintegrated;
+    if(usesCompute()) key |= VariantCompute;
+    if(params.m_gradientOpacity > 0.0f) key |= VariantGradientOpacity;
+    if(m_onTheFlyGradients && (params.m_performPhongShading || params.m_gradientOpacity > 0.0f))
+        key |= VariantGradientOnTheFly;
+    key |= (unsigned int)m_interpolationType << VariantInterpolationShift;
+    key |= channelMask() << VariantChannelShift;
+    return key;
+}
+
+// 64 bit FNV-1a
+static unsigned long long hashString(std::string const &text, unsigned long long hash = 14695981039346656037ULL)
+{
+    for(size_t i=0; i<text.size(); i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string GLRaycaster::programBinaryPath(std::string const &fragmentSource) const
+{
+    //A binary is only valid for the driver that produced it: key by driver, GL version and both shader sources
+    std::string driver;
+    const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION};
+    for(int i=0; i<4; i++) {
+        const char *value = (const char*)glGetString(strings[i]);
+        driver.append(value?value:"").append("\n");
+    }
+    unsigned long long hash = hashString(fragmentSource, hashString(m_vertexSource, hashString(driver)));
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", hash);
+    return m_programCacheDirectory + name;
+}
+
+unsigned int GLRaycaster::loadProgramBinary(std::string const &path) const
+{
+    FILE *fid = fopen(path.c_str(), "rb");
+    if(!fid) return 0;
+    GLenum format = 0;
+    GLint length = 0;
+    char *binary = NULL;
+    if(fread(&format, sizeof(format), 1, fid) == 1 && fread(&length, sizeof(length), 1, fid) == 1 && length > 0) {
+        binary = new char[length];
+        if(fread(binary, 1, length, fid) != (size_t)length) {
+            delete []binary;
+            binary = NULL;
+        }
+    }
+    fclose(fid);
+    if(!binary) return 0;
+
+    //The driver may still reject the binary (e.g. after an update that kept the version string)
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary, length);
+    delete []binary;
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(!status) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void GLRaycaster::saveProgramBinary(unsigned int program, std::string const &path) const
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) return;
+    char *binary = new char[length];
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary);
+
+    //Write to a temporary name first so that a concurrent reader never sees a partial file
+    std::string temporary = path + ".tmp";
+    FILE *fid = fopen(temporary.c_str(), "wb");
+    if(fid) {
+        bool ok = fwrite(&format, sizeof(format), 1, fid) == 1 && fwrite(&length, sizeof(length), 1, fid) == 1 &&
+                fwrite(binary, 1, length, fid) == (size_t)length;
+        ok = (fclose(fid) == 0) && ok;
+        if(!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+            fprintf(stderr, "Could not write program binary: %s\n", path.c_str());
+            remove(temporary.c_str());
+        }
+    }
+    delete []binary;
+}
+
+bool GLRaycaster::compileVariant(unsigned int key, Program &program)
+{
+    //#defines go right after the #version line, which must stay first
+    bool raySetup = (key == RAY_SETUP_PROGRAM_KEY), composite = (key == COMPOSITE_PROGRAM_KEY);
+    bool reproject = (key == REPROJECT_PROGRAM_KEY);
+    unsigned int flags = (raySetup || composite || reproject)?0:key;
+    bool compute = (flags & VariantCompute) != 0;
+    char defines[512];
+    snprintf(defines, sizeof(defines), "#define PHONG_SHADING %d\n#define JITTERING %d\n#define EMPTY_SPACE_SKIPPING %d\n"
+             "#define OPACITY_CORRECTION %d\n#define PREINTEGRATED %d\n#define GRADIENT_OPACITY %d\n"
+             "#define GRADIENT_ON_THE_FLY %d\n#define INTERPOLATION %u\n#define CHANNELS %u\n"
+             "#define RAY_SETUP %d\n#define COMPUTE %d\n#define COMPOSITE %d\n#define REPROJECT %d\n",
+             (flags & VariantPhongShading)?1:0, (flags & VariantJittering)?1:0, (flags & VariantEmptySpaceSkipping)?1:0,
+             (flags & VariantOpacityCorrection)?1:0, (flags & VariantPreintegrated)?1:0,
+             (flags & VariantGradientOpacity)?1:0, (flags & VariantGradientOnTheFly)?1:0,
+             (flags >> VariantInterpolationShift) & 3, flags >> VariantChannelShift,
+             raySetup?1:0, compute?1:0, composite?1:0, reproject?1:0);
+    std::string fragmentSource = m_fragmentSource;
+    size_t version = fragmentSource.find("#version");
+    size_t insertAt = (version == std::string::npos)?0:fragmentSource.find('\n', version);
+    insertAt = (insertAt == std::string::npos)?fragmentSource.size():insertAt + 1;
+    fragmentSource.insert(insertAt, defines);
+    if(compute && version != std::string::npos) //Compute shaders, image stores and atomic counters need GLSL 4.30
+        fragmentSource.replace(version, insertAt - 1 - version, "#version 430");
+
+    memset(&program, 0, sizeof(Program));
+    GLint nBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nBinaryFormats);
+    bool useCache = !m_programCacheDirectory.empty() && nBinaryFormats > 0;
+    std::string binaryPath = useCache?programBinaryPath(fragmentSource):std::string();
+    GLuint id = useCache?loadProgramBinary(binaryPath):0;
+    if(id) {
+        m_programCacheHits++;
+    } else {
+        id = compute?linkComputeProgram(fragmentSource.c_str(), useCache):
+                     linkProgram(m_vertexSource.c_str(), fragmentSource.c_str(), useCache);
+        if(!id) {
+            fprintf(stderr, "Could not build raycasting program variant 0x%x\n", key);
+            return false;
+        }
+        m_programCacheMisses++;
+        if(useCache) saveProgramBinary(id, binaryPath);
+    }
+
+    //Get attribute/uniform locations
+    program.m_program = id;
+    program.m_uView = glGetUniformLocation(id, "uView");
+    program.m_uProjection = glGetUniformLocation(id, "uProjection");
+    program.m_uEye = glGetUniformLocation(id, "uEye");
+    program.m_uCameraInside = glGetUniformLocation(id, "uCameraInside");
+    program.m_uTexExit = glGetUniformLocation(id, "uTexExit");
+    program.m_uInvView = glGetUniformLocation(id, "uInvView");
+    program.m_uInvProjectionScale = glGetUniformLocation(id, "uInvProjectionScale");
+    program.m_uViewport = glGetUniformLocation(id, "uViewport");
+    program.m_uTilesX = glGetUniformLocation(id, "uTilesX");
+    program.m_uTileCount = glGetUniformLocation(id, "uTileCount");
+    program.m_uTexRaycast = glGetUniformLocation(id, "uTexRaycast");
+    program.m_uPremultiply = glGetUniformLocation(id, "uPremultiply");
+    program.m_uNoisePhase = glGetUniformLocation(id, "uNoisePhase");
+    program.m_uTexPrevPoints = glGetUniformLocation(id, "uTexPrevPoints");
+    program.m_uPrevViewProjection = glGetUniformLocation(id, "uPrevViewProjection");
+    program.m_uTexVol = glGetUniformLocation(id, "uTexVol");
+    program.m_uTexTF1D = glGetUniformLocation(id, "uTexTF1D");
+    program.m_uTexNoise = glGetUniformLocation(id, "uTexNoise");
+    program.m_uTexVolNormals = glGetUniformLocation(id, "uTexVolNormals");
+    program.m_uTexOccupancy = glGetUniformLocation(id, "uTexOccupancy");
+    program.m_uTexPreintegrated = glGetUniformLocation(id, "uTexPreintegrated");
+    program.m_uStepSize  = glGetUniformLocation(id, "uStepSize");
+    program.m_uBBox = glGetUniformLocation(id, "uBBox");
+    program.m_uBrickTexSize = glGetUniformLocation(id, "uBrickTexSize");
+    program.m_uOpacityCorrection = glGetUniformLocation(id, "uOpacityCorrection");
+    program.m_uGradientOpacity = glGetUniformLocation(id, "uGradientOpacity");
+    program.m_uGradientScale = glGetUniformLocation(id, "uGradientScale");
+    program.m_uTexChannel = glGetUniformLocation(id, "uTexChannel");
+    program.m_uTexChannelTF = glGetUniformLocation(id, "uTexChannelTF");
+    return true;
+}
+
+GLRaycaster::Program const & GLRaycaster::program(unsigned int key)
+{
+    std::map<unsigned int, Program>::iterator it = m_programs.find(key);
+    if(it != m_programs.end()) return it->second;
+
+    //A failed variant is cached as well (program 0) so that it is not recompiled every frame
+    ScopedSpan span("compile.shaders");
+    Program &entry = m_programs[key];
+    compileVariant(key, entry);
+    return entry;
+}
+
+int GLRaycaster::precompileVariants()
+{
+    //The combinations a settings toggle can reach from the current interpolation kernel, raycasting path, gradient
+    //source and channels; switching one of those compiles on first use instead. Gradient modulated opacity is left out:
+    //only the headless renderer sets it
+    const unsigned int toggles = VariantPhongShading | VariantJittering | VariantEmptySpaceSkipping |
+            VariantOpacityCorrection | VariantPreintegrated;
+    unsigned int channels = channelMask();
+    unsigned int fixed = ((unsigned int)m_interpolationType << VariantInterpolationShift) | (channels << VariantChannelShift);
+    if(usesCompute()) fixed |= VariantCompute;
+    for(unsigned int flags = 0; flags <= toggles; flags++) {
+        if((flags & ~toggles) || (channels && (flags & VariantEmptySpaceSkipping))) continue;
+        unsigned int key = flags | fixed;
+        if(m_onTheFlyGradients && (flags & VariantPhongShading)) key |= VariantGradientOnTheFly;
+        program(key);
+    }
+    //Passes around the raycast: compositing (compute path, accumulation), ray setup and reprojection (fragment path)
+    program(COMPOSITE_PROGRAM_KEY);
+    if(!usesCompute()) {
+        program(RAY_SETUP_PROGRAM_KEY);
+        program(REPROJECT_PROGRAM_KEY);
+    }
+    return programCount();
+}
+
+void GLRaycaster::destroy()
+{
+    for(std::map<unsigned int, Program>::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+        if(it->second.m_program) glDeleteProgram(it->second.m_program);
+    m_programs.clear();
+    if(m_VBO) glDeleteBuffers(1, &m_VBO);
+    if(m_VAO) glDeleteVertexArrays(1, &m_VAO);
+    m_VAO = m_VBO = 0;
+    if(m_exitFBO) glDeleteFramebuffers(1, &m_exitFBO);
+    if(m_textureExit) glDeleteTextures(1, &m_textureExit);
+    m_exitFBO = m_textureExit = 0;
+    m_exitWidth = m_exitHeight = 0;
+    if(m_raycastFBO) glDeleteFramebuffers(1, &m_raycastFBO);
+    if(m_textureRaycast) glDeleteTextures(1, &m_textureRaycast);
+    if(m_tileCounter) glDeleteBuffers(1, &m_tileCounter);
+    m_raycastFBO = m_textureRaycast = m_tileCounter = 0;
+    m_raycastWidth = m_raycastHeight = 0;
+    if(m_accumulationFBO) glDeleteFramebuffers(1, &m_accumulationFBO);
+    if(m_textureAccumulation) glDeleteTextures(1, &m_textureAccumulation);
+    m_accumulationFBO = m_textureAccumulation = 0;
+    m_accumulationWidth = m_accumulationHeight = 0;
+    m_accumulatedFrames = 0;
+    if(m_texturePrevRaycast) glDeleteTextures(1, &m_texturePrevRaycast);
+    if(m_texturePoints) glDeleteTextures(1, &m_texturePoints);
+    if(m_texturePrevPoints) glDeleteTextures(1, &m_texturePrevPoints);
+    if(m_raycastDepth) glDeleteRenderbuffers(1, &m_raycastDepth);
+    if(m_reprojectionQuery) glDeleteQueries(1, &m_reprojectionQuery);
+    m_texturePrevRaycast = m_texturePoints = m_texturePrevPoints = m_raycastDepth = m_reprojectionQuery = 0;
+    m_reprojectionWidth = m_reprojectionHeight = 0;
+    m_reprojectionValid = m_reprojectionQueried = false;
+    if(!hasVolume()) return;
+
+    clearChannels();
+    glDeleteTextures(1, &m_textureVol);
+    glDeleteTextures(1, &m_textureTF1D);
+    glDeleteTextures(1, &m_textureNoise);
+    glDeleteTextures(1, &m_textureVolNormals);
+    glDeleteTextures(1, &m_textureOccupancy);
+    glDeleteTextures(1, &m_texturePreintegrated);
+    m_textureVol = m_textureTF1D = m_textureNoise = m_textureVolNormals = m_textureOccupancy = m_texturePreintegrated = 0;
+}
+
+void GLRaycaster::createCube()
+{
+    //Geometry data: [-1, 1]^3
+    GLfloat cube_vertices[] = {1, 1, 1, -1, 1, 1, -1, -1, 1, 1, -1, 1, //Front
+                   1, 1, -1, -1, 1, -1, -1, -1, -1, 1, -1, -1}; //Back
+    GLushort cube_indices[] = {0, 2, 3, 0, 1, 2, //Front
+                4, 7, 6, 4, 6, 5, //Back
+                5, 2, 1, 5, 6, 2, //Left
+                4, 3, 7, 4, 0, 3, //Right
+                1, 0, 4, 1, 4, 5, //Top
+                2, 7, 3, 2, 6, 7}; //Bottom
+    m_nVertices = 6*2*3; //(6 faces) * (2 triangles each) * (3 vertices each)
+    GLfloat *expanded_vertices = new GLfloat[m_nVertices*3];
+
+    for(int i=0; i<m_nVertices; i++) {
+        expanded_vertices[i*3] = cube_vertices[cube_indices[i]*3];
+        expanded_vertices[i*3 + 1] = cube_vertices[cube_indices[i]*3+1];
+        expanded_vertices[i*3 + 2] = cube_vertices[cube_indices[i]*3+2];
+    }
+
+    //Setup VBO and save its layout in the VAO
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+    glGenBuffers(1, &m_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, m_nVertices*3*sizeof(GLfloat), expanded_vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+    //Release/unbind all
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    delete[] expanded_vertices;
+}
+
+void GLRaycaster::setVolume(int width, int height, int depth, const float *data, float spacingX, float spacingY, float spacingZ)
+{
+    if(hasVolume()) {
+        glDeleteTextures(1, &m_textureVol);
+        glDeleteTextures(1, &m_textureTF1D);
+        glDeleteTextures(1, &m_textureNoise);
+        glDeleteTextures(1, &m_textureVolNormals);
+        glDeleteTextures(1, &m_textureOccupancy);
+        glDeleteTextures(1, &m_texturePreintegrated);
+        clearChannels(); //Registered to the previous volume
+    }
+    invalidateHistory();
+    m_width = width;
+    m_height = height;
+    m_depth = depth;
+    m_bbox = volumeBoundingBox(width, height, depth, spacingX, spacingY, spacingZ);
+    m_extent = Vec3(width*spacingX, height*spacingY, depth*spacingZ);
+    m_volumeData = data;
+    m_gradientScale = 0.0f;
+    if(m_onTheFlyGradients) updateGradientScale();
+
+    //Prepare texture
+    glGenTextures(1, &m_textureVol);
+    glBindTexture(GL_TEXTURE_3D, m_textureVol);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    ScopedSpan uploadSpan("upload.volume"); //CPU side; the driver copies client memory before returning
+    uploadSpan.setBytes((long long)width*height*depth*sizeof(float));
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F,
+                 width, height, depth,
+                 0, GL_RED, GL_FLOAT, (GLvoid*)data);
+    uploadSpan.stop();
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    createTextures();
+}
+
+void GLRaycaster::createTextures()
+{
+    //Create 1D texture for Trasfer function (size: 256)
+    glGenTextures(1, &m_textureTF1D);
+    glBindTexture(GL_TEXTURE_1D, m_textureTF1D);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL); //Need to fill data into this texture later.
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    //Create 2D texture for noise: tileable blue noise, shared with the CPU raycaster
+    glGenTextures(1, &m_textureNoise);
+    glBindTexture(GL_TEXTURE_2D, m_textureNoise);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, blueNoiseTexture());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //No normals until the gradient is known
+    m_textureVolNormals = 0;
+    clearNormals();
+
+    //Occupancy texture: a single occupied brick until the first TF dependent grid has been built
+    unsigned char occupied = 255;
+    glGenTextures(1, &m_textureOccupancy);
+    glBindTexture(GL_TEXTURE_3D, m_textureOccupancy);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, 1, 1, 1, 0, GL_RED, GL_UNSIGNED_BYTE, &occupied);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    m_brickTexSize = Vec3(OCCUPANCY_BRICK_SIZE/(float)m_width, OCCUPANCY_BRICK_SIZE/(float)m_height, OCCUPANCY_BRICK_SIZE/(float)m_depth);
+    m_useEmptySpaceSkipping = 0; //Enabled once the first occupancy grid is ready
+
+    //Pre-integrated TF table, filled when a frame first asks for it
+    glGenTextures(1, &m_texturePreintegrated);
+    glBindTexture(GL_TEXTURE_2D, m_texturePreintegrated);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, TF1D_SIZE, TF1D_SIZE, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_preintegratedUploaded = false;
+}
+
+void GLRaycaster::setTransferFunction(const unsigned char *colorBuffer)
+{
+    //colorbuffer has associated colors (i.e., alpha is premultiplied)
+    glBindTexture(GL_TEXTURE_1D, m_textureTF1D);
+    glTexSubImage1D(GL_TEXTURE_1D, 0, 0, 256, GL_RGBA, GL_UNSIGNED_BYTE, colorBuffer);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    memcpy(m_tfColors, colorBuffer, sizeof(m_tfColors));
+    invalidateHistory();
+}
+
+void GLRaycaster::updatePreintegratedTexture()
+{
+    //Only the entries touched by a TF edit are recomputed; the table is small enough to upload whole
+    if(!m_preintegratedTF.update(m_tfColors) && m_preintegratedUploaded) return;
+    ScopedSpan uploadSpan("upload.preintegrated");
+    glBindTexture(GL_TEXTURE_2D, m_texturePreintegrated);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TF1D_SIZE, TF1D_SIZE, GL_RGBA, GL_FLOAT, m_preintegratedTF.table());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_preintegratedUploaded = true;
+}
+
+void GLRaycaster::resizeExitTarget(int width, int height)
+{
+    if(m_exitFBO && width == m_exitWidth && height == m_exitHeight) return;
+    if(!m_exitFBO) {
+        glGenFramebuffers(1, &m_exitFBO);
+        glGenTextures(1, &m_textureExit);
+    }
+    glBindTexture(GL_TEXTURE_2D, m_textureExit);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_exitFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureExit, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Ray setup framebuffer incomplete\n");
+    m_exitWidth = width;
+    m_exitHeight = height;
+}
+
+void GLRaycaster::renderExitPositions(Mat4 const &view, Mat4 const &projection)
+{
+    //Same viewport as the raycasting pass, so that it can fetch at gl_FragCoord
+    GLint viewport[4], framebuffer;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    resizeExitTarget(viewport[0] + viewport[2], viewport[1] + viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_exitFBO);
+
+    Program const &setup = program(RAY_SETUP_PROGRAM_KEY);
+    const GLfloat uncovered[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, uncovered); //Leaves the caller's clear color alone
+    glDisable(GL_BLEND);
+    glCullFace(GL_FRONT); //No depth attachment: the one back face per pixel of the box always lands
+    glUseProgram(setup.m_program);
+    glUniformMatrix4fv(setup.m_uProjection, 1, GL_FALSE, projection.data());
+    glUniformMatrix4fv(setup.m_uView, 1, GL_FALSE, view.data());
+    glUniform3f(setup.m_uBBox, m_bbox.x, m_bbox.y, m_bbox.z);
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, m_nVertices);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void GLRaycaster::resizeRayTarget(int width, int height)
+{
+    if(m_raycastFBO && width == m_raycastWidth && height == m_raycastHeight) return;
+    if(!m_raycastFBO) {
+        glGenFramebuffers(1, &m_raycastFBO);
+        glGenTextures(1, &m_textureRaycast);
+    }
+    glBindTexture(GL_TEXTURE_2D, m_textureRaycast);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_raycastFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureRaycast, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Raycast framebuffer incomplete\n");
+    m_raycastWidth = width;
+    m_raycastHeight = height;
+}
+
+void GLRaycaster::resizeAccumulationTarget(int width, int height)
+{
+    if(m_accumulationFBO && width == m_accumulationWidth && height == m_accumulationHeight) return;
+    if(!m_accumulationFBO) {
+        glGenFramebuffers(1, &m_accumulationFBO);
+        glGenTextures(1, &m_textureAccumulation);
+    }
+    //32 bit floats: a half float mean stops moving long before 1/ACCUMULATION_MAX_FRAMES weights
+    glBindTexture(GL_TEXTURE_2D, m_textureAccumulation);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_accumulationFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureAccumulation, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "Accumulation framebuffer incomplete\n");
+    m_accumulationWidth = width;
+    m_accumulationHeight = height;
+    m_accumulatedFrames = 0;
+}
+
+void GLRaycaster::resizeReprojectionTarget(int width, int height)
+{
+    if(m_raycastDepth && width == m_reprojectionWidth && height == m_reprojectionHeight) return;
+    if(!m_raycastDepth) {
+        glGenTextures(1, &m_texturePrevRaycast);
+        glGenTextures(1, &m_texturePoints);
+        glGenTextures(1, &m_texturePrevPoints);
+        glGenRenderbuffers(1, &m_raycastDepth);
+        glGenQueries(1, &m_reprojectionQuery);
+    }
+    //The ray image (sized by resizeRayTarget()) and its predecessor trade places every frame
+    GLuint textures[3] = {m_texturePrevRaycast, m_texturePoints, m_texturePrevPoints};
+    for(int i=0; i<3; i++) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, (i == 0)?GL_RGBA16F:GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_raycastDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    m_reprojectionWidth = width;
+    m_reprojectionHeight = height;
+    m_reprojectionValid = false;
+}
+
+//Compares the frame against the last one, and records it; returns FRAME_* bits for what changed
+unsigned int GLRaycaster::recordFrame(unsigned int key, Mat4 const &view, Mat4 const &projection,
+                                      RaycastParameters const &params, const int *viewport)
+{
+    unsigned int changes = 0;
+    if(memcmp(view.data(), m_frameView.data(), 16*sizeof(float))) changes |= FRAME_VIEW_CHANGED;
+    if(key != m_frameKey || params.m_stepSize != m_frameStepSize || params.m_opacityCorrection != m_frameOpacityCorrection ||
+            params.m_gradientOpacity != m_frameGradientOpacity || memcmp(projection.data(), m_frameProjection.data(), 16*sizeof(float)) ||
+            memcmp(viewport, m_frameViewport, sizeof(m_frameViewport)))
+        changes |= FRAME_SETTINGS_CHANGED;
+    m_frameKey = key;
+    m_frameStepSize = params.m_stepSize;
+    m_frameOpacityCorrection = params.m_opacityCorrection;
+    m_frameGradientOpacity = params.m_gradientOpacity;
+    m_frameView = view;
+    m_frameProjection = projection;
+    memcpy(m_frameViewport, viewport, sizeof(m_frameViewport));
+    return changes;
+}
+
+//Fills the reusable pixels of the ray image from the previous frame, at depth 0 so that raycasting skips them
+void GLRaycaster::reprojectPreviousFrame(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params,
+                                         Vec3 const &eye, const int *viewport)
+{
+    Program const &reproject = program(REPROJECT_PROGRAM_KEY);
+    glUseProgram(reproject.m_program);
+    glUniformMatrix4fv(reproject.m_uProjection, 1, GL_FALSE, projection.data());
+    glUniformMatrix4fv(reproject.m_uView, 1, GL_FALSE, view.data());
+    glUniformMatrix4fv(reproject.m_uPrevViewProjection, 1, GL_FALSE, m_prevViewProjection.data());
+    glUniform3f(reproject.m_uBBox, m_bbox.x, m_bbox.y, m_bbox.z);
+    glUniform3f(reproject.m_uEye, eye.x, eye.y, eye.z);
+    glUniform4i(reproject.m_uViewport, viewport[0], viewport[1], viewport[2], viewport[3]);
+    glUniform1f(reproject.m_uStepSize, params.m_stepSize);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, m_texturePrevRaycast);
+    glUniform1i(reproject.m_uTexRaycast, 7);
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_2D, m_texturePrevPoints);
+    glUniform1i(reproject.m_uTexPrevPoints, 8);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glBeginQuery(GL_SAMPLES_PASSED, m_reprojectionQuery);
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, m_nVertices);
+    glBindVertexArray(0);
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_reprojectionQueried = true;
+    glDepthFunc(GL_LEQUAL); //The raycasting pass only covers what was not carried forward (faces may lie at 1)
+    glDepthMask(GL_FALSE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+int GLRaycaster::reprojectedPixels() const
+{
+    if(!m_reprojectionQueried) return 0;
+    GLuint samples = 0;
+    glGetQueryObjectuiv(m_reprojectionQuery, GL_QUERY_RESULT, &samples);
+    return (int)samples;
+}
+
+//Runs the compute variant over the viewport, leaving the ray colors in m_textureRaycast (sized by the caller)
+void GLRaycaster::dispatchTiles(Program const &variant, Mat4 const &view, Mat4 const &projection)
+{
+#ifdef GL_COMPUTE_SHADER
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if(!m_tileCounter) {
+        glGenBuffers(1, &m_tileCounter);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_tileCounter);
+        glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+    }
+    int tilesX = (viewport[2] + COMPUTE_TILE_SIZE - 1)/COMPUTE_TILE_SIZE;
+    int tilesY = (viewport[3] + COMPUTE_TILE_SIZE - 1)/COMPUTE_TILE_SIZE;
+    int tileCount = tilesX*tilesY;
+
+    GLuint firstTile = 0;
+    glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, m_tileCounter);
+    glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(firstTile), &firstTile);
+    glBindImageTexture(0, m_textureRaycast, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    Mat4 invView = view.inverted();
+    glUniformMatrix4fv(variant.m_uInvView, 1, GL_FALSE, invView.data());
+    glUniform2f(variant.m_uInvProjectionScale, 1.0/projection(0, 0), 1.0/projection(1, 1));
+    glUniform4i(variant.m_uViewport, viewport[0], viewport[1], viewport[2], viewport[3]);
+    glUniform1i(variant.m_uTilesX, tilesX);
+    glUniform1i(variant.m_uTileCount, tileCount);
+    glDispatchCompute(tileCount < COMPUTE_PERSISTENT_GROUPS?tileCount:COMPUTE_PERSISTENT_GROUPS, 1, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, 0);
+#else
+    (void)variant;
+    (void)view;
+    (void)projection;
+#endif
+}
+
+//A single texel of zero magnitude: nothing is shaded, and the normals take no memory
+void GLRaycaster::clearNormals()
+{
+    const unsigned char none[4] = {127, 127, 127, 0};
+    if(m_textureVolNormals) glDeleteTextures(1, &m_textureVolNormals);
+    glGenTextures(1, &m_textureVolNormals);
+    glBindTexture(GL_TEXTURE_3D, m_textureVolNormals);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, none);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    invalidateHistory();
+}
+
+void GLRaycaster::setOnTheFlyGradients(bool flag)
+{
+    if(flag && !m_onTheFlyGradients && hasVolume()) clearNormals();
+    m_onTheFlyGradients = flag;
+    if(flag) updateGradientScale();
+}
+
+void GLRaycaster::updateGradientScale()
+{
+    //A pass over the whole volume: only done once gradients are taken on the fly, and once per volume
+    if(m_gradientScale > 0.0f || !m_volumeData) return;
+    float maxGradient = maxGradientMagnitude(m_volumeData, m_width, m_height, m_depth, m_bbox.x/m_width,
+                                             m_bbox.y/m_height, m_bbox.z/m_depth);
+    m_gradientScale = (maxGradient > 0.0f)?1.0f/maxGradient:1.0f;
+}
+
+long long GLRaycaster::freeTextureMemory() const
+{
+    GLint kb[4] = {-1, -1, -1, -1};
+    if(m_memoryInfo == MEMORY_INFO_NVX) glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, kb);
+    else if(m_memoryInfo == MEMORY_INFO_ATI) glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, kb); //Total free, largest block, ...
+    return (kb[0] < 0)?-1:1024LL*kb[0];
+}
+
+void GLRaycaster::setNormals(const unsigned char *normals)
+{
+    m_onTheFlyGradients = false;
+    //Upload normals - destroy the old texture and recreate new (Updating the existing 3D texture does not work on MacOS)
+    ScopedSpan uploadSpan("upload.normals");
+    uploadSpan.setBytes(4LL*m_width*m_height*m_depth);
+    if(m_textureVolNormals) glDeleteTextures(1, &m_textureVolNormals);
+    glGenTextures(1, &m_textureVolNormals);
+    glBindTexture(GL_TEXTURE_3D, m_textureVolNormals);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, m_width, m_height, m_depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, normals);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    invalidateHistory();
+}
+
+void GLRaycaster::setOccupancy(OccupancyGrid const &grid)
+{
+    //Upload occupancy - recreate the texture as the brick grid is tiny
+    glDeleteTextures(1, &m_textureOccupancy);
+    glGenTextures(1, &m_textureOccupancy);
+    glBindTexture(GL_TEXTURE_3D, m_textureOccupancy);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, grid.width(), grid.height(), grid.depth(), 0, GL_RED, GL_UNSIGNED_BYTE, grid.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    m_useEmptySpaceSkipping = 1;
+}
+
+void GLRaycaster::setInterpolationType(RaycastingInterpolationType type)
+{
+    //The kernel is compiled into the program variant; the volume texture stays linearly filtered (tricubic relies on it)
+    if(type != InterpolationNearestNeighbour && type != InterpolationTrilinear && type != Interpolationcubic) {
+        fprintf(stderr, "Unknown texture interpolation mode. Ignoring...\n");
+        return;
+    }
+    m_interpolationType = type;
+}
+
+bool GLRaycaster::setChannel(int channel, int width, int height, int depth, const float *data, float spacingX,
+                             float spacingY, float spacingZ, bool nearest)
+{
+    if(channel < 1 || channel >= VOLUME_MAX_CHANNELS || !hasVolume()) {
+        fprintf(stderr, "Invalid channel %d\n", channel);
+        return false;
+    }
+    //Sampled at the volume's texture coordinates, so it must span the same box
+    if(data && !sameProportions(m_extent, Vec3(width*spacingX, height*spacingY, depth*spacingZ))) {
+        fprintf(stderr, "Channel %d does not span the volume's extent. Ignoring...\n", channel);
+        return false;
+    }
+    int i = channel - 1;
+    if(m_textureChannel[i]) {
+        glDeleteTextures(1, &m_textureChannel[i]);
+        glDeleteTextures(1, &m_textureChannelTF[i]);
+        m_textureChannel[i] = m_textureChannelTF[i] = 0;
+    }
+    invalidateHistory();
+    if(!data) return true;
+
+    glGenTextures(1, &m_textureChannel[i]);
+    glBindTexture(GL_TEXTURE_3D, m_textureChannel[i]);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, nearest?GL_NEAREST:GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, nearest?GL_NEAREST:GL_LINEAR);
+    ScopedSpan uploadSpan("upload.channel");
+    uploadSpan.setBytes((long long)width*height*depth*sizeof(float));
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, width, height, depth, 0, GL_RED, GL_FLOAT, (GLvoid*)data);
+    uploadSpan.stop();
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    //Transparent until its TF is set
+    glGenTextures(1, &m_textureChannelTF[i]);
+    glBindTexture(GL_TEXTURE_1D, m_textureChannelTF[i]);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAX_LEVEL, 0);
+    unsigned char transparent[4*TF1D_SIZE];
+    memset(transparent, 0, sizeof(transparent));
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, TF1D_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    m_channelEnabled[i] = true;
+    return true;
+}
+
+void GLRaycaster::setChannelTransferFunction(int channel, const unsigned char *colorBuffer)
+{
+    if(channel < 1 || channel >= VOLUME_MAX_CHANNELS || !m_textureChannel[channel - 1]) return;
+    glBindTexture(GL_TEXTURE_1D, m_textureChannelTF[channel - 1]);
+    glTexSubImage1D(GL_TEXTURE_1D, 0, 0, TF1D_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, colorBuffer);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    invalidateHistory();
+}
+
+void GLRaycaster::enableChannel(int channel, bool flag)
+{
+    if(channel < 1 || channel >= VOLUME_MAX_CHANNELS) return;
+    m_channelEnabled[channel - 1] = flag; //The variant key changes, which restarts accumulation
+}
+
+unsigned int GLRaycaster::channelMask() const
+{
+    unsigned int mask = 0;
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++)
+        if(m_textureChannel[i] && m_channelEnabled[i]) mask |= 1u << i;
+    return mask;
+}
+
+void GLRaycaster::clearChannels()
+{
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) {
+        if(!m_textureChannel[i]) continue;
+        glDeleteTextures(1, &m_textureChannel[i]);
+        glDeleteTextures(1, &m_textureChannelTF[i]);
+        m_textureChannel[i] = m_textureChannelTF[i] = 0;
+    }
+}
+
+void GLRaycaster::render(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params)
+{
+    unsigned int key = variantKey(params);
+    if((key & VariantCompute) && (!program(key).m_program || !program(COMPOSITE_PROGRAM_KEY).m_program)) {
+        fprintf(stderr, "Compute raycaster unavailable, using the fragment raycaster.\n");
+        m_computeSupported = false;
+        key = variantKey(params);
+    }
+    if(m_useAccumulation && !program(COMPOSITE_PROGRAM_KEY).m_program) {
+        fprintf(stderr, "Temporal accumulation unavailable, rendering single frames.\n");
+        m_useAccumulation = false;
+    }
+    Program const &variant = program(key);
+    if(!variant.m_program) return;
+    if(params.m_preintegrated) updatePreintegratedTexture();
+
+    //Per-frame ray setup: the eye once here instead of inverting uView in every fragment, and the exit positions
+    Vec3 eye = view.inverted().transformPoint(Vec3(0, 0, 0));
+    bool cameraInside = fabs(eye.x) < m_bbox.x*0.5 && fabs(eye.y) < m_bbox.y*0.5 && fabs(eye.z) < m_bbox.z*0.5;
+    bool compute = (key & VariantCompute) != 0;
+    GLint viewport[4], framebuffer;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    bool reproject = m_useReprojection && !compute;
+    bool offscreen = compute || m_useAccumulation || reproject; //Ray colors go into m_textureRaycast first
+    unsigned int changes = recordFrame(key, view, projection, params, viewport);
+    if(changes) m_accumulatedFrames = 0;
+    if(m_useAccumulation) resizeAccumulationTarget(viewport[0] + viewport[2], viewport[1] + viewport[3]);
+    bool raycast = !m_useAccumulation || !accumulationConverged();
+    if(offscreen) resizeRayTarget(viewport[0] + viewport[2], viewport[1] + viewport[3]);
+    if(reproject) resizeReprojectionTarget(viewport[0] + viewport[2], viewport[1] + viewport[3]);
+    bool reuse = reproject && raycast && m_reprojectionValid && changes == FRAME_VIEW_CHANGED;
+    m_reprojectionQueried = false;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFrontFace(GL_CCW);
+    glEnable(GL_CULL_FACE);
+    if(raycast && !compute) renderExitPositions(view, projection);
+
+    //Set every frame: the caller (e.g. a QPainter overlay) may change GL state
+    glCullFace(cameraInside?GL_FRONT:GL_BACK); //Inside, the front faces are behind the eye
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    if(raycast && offscreen && !compute) { //Raw ray colors into the ray image, like the compute path
+        const GLfloat transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f}, farthest = 1.0f;
+        const GLenum drawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glBindFramebuffer(GL_FRAMEBUFFER, m_raycastFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureRaycast, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, reproject?m_texturePoints:0, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, reproject?m_raycastDepth:0);
+        glDrawBuffers(reproject?2:1, drawBuffers);
+        glClearBufferfv(GL_COLOR, 0, transparent);
+        glDisable(GL_BLEND);
+        if(reproject) {
+            glDepthMask(GL_TRUE);
+            glClearBufferfv(GL_COLOR, 1, transparent);
+            glClearBufferfv(GL_DEPTH, 0, &farthest);
+            if(reuse) reprojectPreviousFrame(view, projection, params, eye, viewport);
+        }
+    }
+
+    if(raycast) {
+        glUseProgram(variant.m_program);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, m_textureVol);
+        glUniform1i(variant.m_uTexVol, 0);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, m_textureTF1D);
+        glUniform1i(variant.m_uTexTF1D, 1);
+
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, m_textureNoise);
+        glUniform1i(variant.m_uTexNoise, 2);
+
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_3D, m_textureVolNormals);
+        glUniform1i(variant.m_uTexVolNormals, 4);
+
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_3D, m_textureOccupancy);
+        glUniform1i(variant.m_uTexOccupancy, 3);
+
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, m_texturePreintegrated);
+        glUniform1i(variant.m_uTexPreintegrated, 5);
+
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, m_textureExit);
+        glUniform1i(variant.m_uTexExit, 6);
+
+        //All units are assigned: unset channels must not leave a sampler1D and a sampler3D on unit 0
+        GLint channelUnits[VOLUME_MAX_CHANNELS - 1], channelTFUnits[VOLUME_MAX_CHANNELS - 1];
+        for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) {
+            channelUnits[i] = CHANNEL_TEXTURE_UNIT + i;
+            channelTFUnits[i] = CHANNEL_TEXTURE_UNIT + VOLUME_MAX_CHANNELS - 1 + i;
+            glActiveTexture(GL_TEXTURE0 + channelUnits[i]);
+            glBindTexture(GL_TEXTURE_3D, m_textureChannel[i]);
+            glActiveTexture(GL_TEXTURE0 + channelTFUnits[i]);
+            glBindTexture(GL_TEXTURE_1D, m_textureChannelTF[i]);
+        }
+        glUniform1iv(variant.m_uTexChannel, VOLUME_MAX_CHANNELS - 1, channelUnits);
+        glUniform1iv(variant.m_uTexChannelTF, VOLUME_MAX_CHANNELS - 1, channelTFUnits);
+
+        //The blue noise advances by the golden ratio every frame: each pixel gets a well spread series of jitter
+        //values, and every frame keeps the blue noise distribution
+        float noisePhase = fmod(m_jitterFrame*BLUE_NOISE_FRAME_STEP, 1.0);
+        if(params.m_useJittering) m_jitterFrame++;
+
+        glUniformMatrix4fv(variant.m_uProjection, 1, GL_FALSE, projection.data());
+        glUniformMatrix4fv(variant.m_uView, 1, GL_FALSE, view.data());
+        glUniform3f(variant.m_uEye, eye.x, eye.y, eye.z);
+        glUniform1i(variant.m_uCameraInside, cameraInside);
+        glUniform1f(variant.m_uNoisePhase, noisePhase);
+        glUniform1f(variant.m_uStepSize, params.m_stepSize);
+        glUniform1f(variant.m_uOpacityCorrection, params.m_opacityCorrection);
+        glUniform1f(variant.m_uGradientOpacity, params.m_gradientOpacity);
+        glUniform1f(variant.m_uGradientScale, m_gradientScale);
+        glUniform3f(variant.m_uBBox, m_bbox.x, m_bbox.y, m_bbox.z);
+        glUniform3f(variant.m_uBrickTexSize, m_brickTexSize.x, m_brickTexSize.y, m_brickTexSize.z);
+        if(compute) {
+            dispatchTiles(variant, view, projection);
+        } else {
+            glBindVertexArray(m_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, m_nVertices);
+            glBindVertexArray(0);
+            glDisable(GL_DEPTH_TEST);
+            glDepthMask(GL_TRUE);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+
+        if(m_useAccumulation) { //Running mean: frame n enters with weight 1/(n+1), the first one replaces the buffer
+            glBindFramebuffer(GL_FRAMEBUFFER, m_accumulationFBO);
+            glEnable(GL_BLEND);
+            glBlendColor(0.0f, 0.0f, 0.0f, 1.0f/(m_accumulatedFrames + 1));
+            glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+            composite(m_textureRaycast, true, view, projection);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            m_accumulatedFrames++;
+        }
+    }
+
+    if(offscreen) { //Draw the faces with the composite program to blend the image in
+        glEnable(GL_BLEND);
+        if(m_useAccumulation) //Already color*alpha; alpha as GL_SRC_ALPHA blending of a ray color would leave it
+            glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        composite(m_useAccumulation?m_textureAccumulation:m_textureRaycast, false, view, projection);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    if(reproject && raycast) { //This frame is the next one's history
+        std::swap(m_textureRaycast, m_texturePrevRaycast);
+        std::swap(m_texturePoints, m_texturePrevPoints);
+        m_prevViewProjection = projection*view;
+    }
+    m_reprojectionValid = reproject;
+
+    for(int i=0; i<VOLUME_MAX_CHANNELS - 1; i++) {
+        glActiveTexture(GL_TEXTURE0 + CHANNEL_TEXTURE_UNIT + i);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glActiveTexture(GL_TEXTURE0 + CHANNEL_TEXTURE_UNIT + VOLUME_MAX_CHANNELS - 1 + i);
+        glBindTexture(GL_TEXTURE_1D, 0);
+    }
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glUseProgram(0);
+}
+
+//Draws the box faces with the composite program, fetching texture at each covered pixel
+void GLRaycaster::composite(unsigned int texture, bool premultiply, Mat4 const &view, Mat4 const &projection)
+{
+    Program const &composite = program(COMPOSITE_PROGRAM_KEY);
+    glUseProgram(composite.m_program);
+    glUniformMatrix4fv(composite.m_uProjection, 1, GL_FALSE, projection.data());
+    glUniformMatrix4fv(composite.m_uView, 1, GL_FALSE, view.data());
+    glUniform3f(composite.m_uBBox, m_bbox.x, m_bbox.y, m_bbox.z);
+    glUniform1i(composite.m_uPremultiply, premultiply);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(composite.m_uTexRaycast, 7);
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, m_nVertices);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,227 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef GLRAYCASTER_H
+#define GLRAYCASTER_H
+
+#include "algorithm/camera.h"
+#include "algorithm/preintegratedtf.h"
+#include "defines.h"
+
+#include <map>
+#include <string>
+
+class OccupancyGrid;
+
+// GPU raycaster: owns the raycasting program, the cube geometry and the volume, TF, noise, normals and occupancy
+// textures. Issues plain OpenGL 4.1 core calls into whatever context and framebuffer are current, so it is shared
+// by GLWidget and the headless renderer. All methods require a current context.
+//
+// The fragment shader is specialized with #defines for the enabled features instead of branching on uniforms in the
+// sample loop. Each feature combination is compiled once, on first use or by precompileVariants(), and kept in a
+// program cache keyed by variantKey(). With setProgramCache(), linked programs are also stored on disk as driver
+// binaries, keyed by the driver and the shader source, and reloaded on the next start instead of compiling.
+//
+// Each frame starts with a ray setup pass that rasterizes the world space exit positions of the back faces into a
+// float texture the size of the viewport, so the raycasting pass reads its exit point with one fetch. The raycasting
+// pass draws the front faces, or the back faces with rays starting at the eye when the camera is inside the volume.
+//
+// On OpenGL 4.3 and later, setUseCompute() switches to a compute raycaster instead: persistent work groups pull screen
+// tiles from an atomic counter, write the rays into an image, and a composite pass blends that image over the
+// framebuffer. 4.1 contexts (e.g. macOS) keep the fragment path.
+//
+// With setAccumulation(), jittered frames of an unchanged view are averaged for progressive anti-aliasing: each frame
+// raycasts into the ray image with the next jitter values (see JITTERING in cube.fs), and is blended into a float
+// accumulation buffer with weight 1/(n+1). The average is what gets composited. Any change of camera, parameters,
+// viewport, volume or TF restarts it, and after ACCUMULATION_MAX_FRAMES frames render() only composites.
+//
+// With setReprojection(), frames of a moving camera reuse the previous one (fragment path only): each ray also records
+// the point where its opacity first reaches one half, and a pass before raycasting gathers the previous colors whose
+// point lies on the new ray. Only the remaining pixels - disoccluded, semi-transparent, or carried for too long - are
+// raycast. See REPROJECT in cube.fs for the thresholds.
+//
+// With setOnTheFlyGradients(), shading takes central differences of the volume texture instead of reading the normals
+// texture, which is released: 4 bytes per voxel less video memory for six extra fetches per visible sample.
+//
+// Up to VOLUME_MAX_CHANNELS - 1 co-registered channels (setChannel()), each with its own TF, are sampled at every step
+// of the same ray and fused with the volume's sample (see fuse_channels() in cube.fs). The enabled channels are part of
+// the variant key. Empty space skipping is off while any channel is enabled: the occupancy only covers the volume's TF.
+#define ACCUMULATION_MAX_FRAMES 64
+
+enum ShaderVariantFlag {
+    VariantPhongShading = 1,
+    VariantJittering = 2,
+    VariantEmptySpaceSkipping = 4,
+    VariantOpacityCorrection = 8,
+    VariantPreintegrated = 16,
+    VariantCompute = 32, // Tiled compute raycaster instead of the fragment path
+    VariantGradientOpacity = 64,
+    VariantGradientOnTheFly = 128, // Set with shading or gradient opacity only
+    VariantInterpolationShift = 8, // The next 2 bits hold the RaycastingInterpolationType
+    VariantChannelShift = 10 // The bits above hold the enabled channels, channel c in bit c - 1
+};
+
+class GLRaycaster
+{
+public:
+    GLRaycaster();
+    ~GLRaycaster();
+    void setProgramCache(const char *directory); // Existing directory for program binaries, NULL disables; before create()
+    bool create(const char *vertexShaderSource, const char *fragmentShaderSource);
+    void destroy();
+    bool isCreated() const { return m_VAO != 0;}
+    int precompileVariants(); // Compile the combinations settings toggles reach from the current state, returns the number of programs
+    int programCount() const { return (int)m_programs.size();}
+    int const & programCacheHits() const { return m_programCacheHits;} // Programs loaded from binaries
+    int const & programCacheMisses() const { return m_programCacheMisses;} // Programs compiled from source
+    bool hasVolume() const { return m_textureVol != 0;}
+    void setUseCompute(bool flag) { m_useCompute = flag;}
+    bool supportsCompute() const { return m_computeSupported;} // OpenGL 4.3 context, known after create()
+    bool usesCompute() const { return m_useCompute && m_computeSupported;}
+    void setAccumulation(bool flag) { m_useAccumulation = flag; m_accumulatedFrames = 0;}
+    bool usesAccumulation() const { return m_useAccumulation;}
+    int accumulatedFrames() const { return m_accumulatedFrames;}
+    bool accumulationConverged() const { return m_accumulatedFrames >= ACCUMULATION_MAX_FRAMES;}
+    void setReprojection(bool flag) { m_useReprojection = flag; m_reprojectionValid = false;}
+    bool usesReprojection() const { return m_useReprojection;}
+    int reprojectedPixels() const; // Pixels the last frame took from the one before; waits for the GPU
+    void setOnTheFlyGradients(bool flag); // Releases the normals texture; setNormals() uploads one again
+    bool usesOnTheFlyGradients() const { return m_onTheFlyGradients;}
+    long long freeTextureMemory() const; // Bytes, -1 if the driver does not tell; known after create()
+
+    void setVolume(int width, int height, int depth, const float *data, float spacingX, float spacingY, float spacingZ); // Kept for setOnTheFlyGradients()
+    void setTransferFunction(const unsigned char *colorBuffer); // 256 RGBA, alpha premultiplied
+    void setNormals(const unsigned char *normals); // RGBA8, same size as the volume; switches to the stored normals
+    void setOccupancy(OccupancyGrid const &grid);
+    void setInterpolationType(RaycastingInterpolationType type);
+    Vec3 const & bbox() const { return m_bbox;}
+
+    //Channels 1 .. VOLUME_MAX_CHANNELS - 1, after setVolume() (which removes them). A channel must span the volume's
+    //bounding box; nearest filtering suits label volumes. NULL data removes the channel.
+    bool setChannel(int channel, int width, int height, int depth, const float *data, float spacingX, float spacingY,
+                    float spacingZ, bool nearest);
+    void setChannelTransferFunction(int channel, const unsigned char *colorBuffer); // Like setTransferFunction()
+    void enableChannel(int channel, bool flag); // Channels are enabled when set
+    unsigned int channelMask() const; // Bit c - 1 for each channel that is set and enabled
+
+    void render(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params);
+    unsigned int variantKey(RaycastParameters const &params) const;
+
+private:
+    //A compiled program variant with its uniform locations
+    struct Program {
+        unsigned int m_program;
+        int m_uTexVol, m_uTexTF1D, m_uTexNoise, m_uTexVolNormals, m_uTexOccupancy, m_uTexPreintegrated;
+        int m_uView, m_uProjection;
+        int m_uEye, m_uCameraInside, m_uTexExit;
+        int m_uInvView, m_uInvProjectionScale, m_uViewport, m_uTilesX, m_uTileCount, m_uTexRaycast;
+        int m_uPremultiply, m_uNoisePhase;
+        int m_uTexPrevPoints, m_uPrevViewProjection;
+        int m_uStepSize;
+        int m_uBBox;
+        int m_uBrickTexSize;
+        int m_uOpacityCorrection;
+        int m_uGradientOpacity, m_uGradientScale;
+        int m_uTexChannel, m_uTexChannelTF;
+    };
+
+    std::string m_vertexSource, m_fragmentSource;
+    std::map<unsigned int, Program> m_programs; // Keyed by variantKey()
+    std::string m_programCacheDirectory;
+    int m_programCacheHits, m_programCacheMisses;
+    unsigned int m_VAO, m_VBO;
+    int m_nVertices;
+    int m_width, m_height, m_depth;
+    Vec3 m_bbox;
+    Vec3 m_extent; // Size times spacing, to check that channels are co-registered
+    Vec3 m_brickTexSize; // Brick extent in texture coordinates
+    int m_useEmptySpaceSkipping;
+    RaycastingInterpolationType m_interpolationType;
+
+    unsigned int m_textureVol;
+    unsigned int m_textureTF1D; //1D RGBA texture
+    unsigned int m_textureNoise; // Texture of random values
+    unsigned int m_textureVolNormals; // Normals for volumetric phong shading, a single texel while there are none
+    bool m_onTheFlyGradients;
+    float m_gradientScale; // 1/largest gradient magnitude, for the gradients computed on the fly; 0 until they are used
+    const float *m_volumeData; // Not copied, for m_gradientScale
+    int m_memoryInfo; // Extension for freeTextureMemory(): MEMORY_INFO_*
+    unsigned int m_textureOccupancy; // Per-brick occupancy for empty space skipping
+    unsigned int m_texturePreintegrated; // 2D RGBA table of segment colors, see PreintegratedTF
+    unsigned int m_textureChannel[VOLUME_MAX_CHANNELS - 1], m_textureChannelTF[VOLUME_MAX_CHANNELS - 1]; // 0 if not set
+    bool m_channelEnabled[VOLUME_MAX_CHANNELS - 1];
+    unsigned int m_exitFBO, m_textureExit; // Ray setup target: RGBA32F exit positions, w = 1 where covered
+    int m_exitWidth, m_exitHeight;
+    bool m_computeSupported, m_useCompute;
+    unsigned int m_raycastFBO, m_textureRaycast, m_tileCounter; // Ray image: RGBA16F ray colors; compute tile counter
+    int m_raycastWidth, m_raycastHeight;
+    bool m_useAccumulation;
+    int m_accumulatedFrames;
+    unsigned int m_jitterFrame; // Jittered frames so far, animates the noise
+    unsigned int m_accumulationFBO, m_textureAccumulation; // RGBA32F running mean of color*alpha, alpha
+    int m_accumulationWidth, m_accumulationHeight;
+    unsigned int m_frameKey; // What the last frame was rendered with, see recordFrame()
+    float m_frameStepSize, m_frameOpacityCorrection, m_frameGradientOpacity;
+    Mat4 m_frameView, m_frameProjection;
+    int m_frameViewport[4];
+    bool m_useReprojection, m_reprojectionValid;
+    unsigned int m_texturePrevRaycast; // Ray image of the previous frame, swapped with m_textureRaycast
+    unsigned int m_texturePoints, m_texturePrevPoints; // RGBA32F surface points (xyz) and their age (w), likewise
+    unsigned int m_raycastDepth; // Marks the reprojected pixels for the raycasting pass
+    unsigned int m_reprojectionQuery; // Samples passed by the reprojection pass
+    bool m_reprojectionQueried;
+    int m_reprojectionWidth, m_reprojectionHeight;
+    Mat4 m_prevViewProjection;
+
+    unsigned char m_tfColors[4*TF1D_SIZE]; // Last TF, for the pre-integrated table
+    PreintegratedTF m_preintegratedTF; // Brought up to date when a frame needs it
+    bool m_preintegratedUploaded;
+
+    // private helpers
+    Program const &program(unsigned int key);
+    bool compileVariant(unsigned int key, Program &program);
+    std::string programBinaryPath(std::string const &fragmentSource) const;
+    unsigned int loadProgramBinary(std::string const &path) const;
+    void saveProgramBinary(unsigned int program, std::string const &path) const;
+    void createCube();
+    void createTextures();
+    void clearNormals();
+    void updateGradientScale(); // Computes m_gradientScale if not done for this volume yet
+    void clearChannels();
+    void updatePreintegratedTexture();
+    void resizeExitTarget(int width, int height);
+    void renderExitPositions(Mat4 const &view, Mat4 const &projection);
+    void resizeRayTarget(int width, int height);
+    void resizeAccumulationTarget(int width, int height);
+    void resizeReprojectionTarget(int width, int height);
+    unsigned int recordFrame(unsigned int key, Mat4 const &view, Mat4 const &projection, RaycastParameters const &params,
+                             const int *viewport);
+    void invalidateHistory() { m_accumulatedFrames = 0; m_reprojectionValid = false;}
+    void reprojectPreviousFrame(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params,
+                                Vec3 const &eye, const int *viewport);
+    void dispatchTiles(Program const &variant, Mat4 const &view, Mat4 const &projection);
+    void composite(unsigned int texture, bool premultiply, Mat4 const &view, Mat4 const &projection);
+};
+
+#endif // GLRAYCASTER_H
@@ -0,0 +1,108 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "adaptivequality.h"
+
+#define AQ_SMOOTHING 0.3 // Weight of the newest sample in the moving average
+#define AQ_DEGRADE_THRESHOLD 1.1 // Lower quality above 110% of the budget ...
+#define AQ_DEGRADE_FRAMES 2 // ... sustained for this many frames
+#define AQ_IMPROVE_THRESHOLD 0.8 // Raise quality if the better level is predicted below 80% of the budget ...
+#define AQ_IMPROVE_FRAMES 8 // ... for this many frames
+
+static const QualityLevel s_levels[] = {
+    {1.0, 1.0}, {1.5, 1.0}, {2.0, 1.0}, {2.0, 0.75}, {3.0, 0.75},
+    {4.0, 0.5}, {6.0, 0.5}, {8.0, 0.33}, {12.0, 0.25}
+};
+
+AdaptiveQualityController::AdaptiveQualityController()
+{
+    m_enabled = false;
+    m_targetMs = 33.0;
+    setLevel(0);
+}
+
+int AdaptiveQualityController::levelCount()
+{
+    return sizeof(s_levels)/sizeof(QualityLevel);
+}
+
+float AdaptiveQualityController::relativeCost(float stepFactor, float renderScale)
+{
+    //Raycasting cost is proportional to the number of rays times the number of samples per ray
+    return renderScale*renderScale/stepFactor;
+}
+
+void AdaptiveQualityController::setEnabled(bool flag)
+{
+    m_enabled = flag;
+    setLevel(0);
+}
+
+void AdaptiveQualityController::setLevel(int level)
+{
+    m_level = level;
+    m_smoothedMs = -1.0;
+    m_overBudgetFrames = m_underBudgetFrames = 0;
+}
+
+float AdaptiveQualityController::stepFactor() const
+{
+    return m_enabled?s_levels[m_level].m_stepFactor:1.0;
+}
+
+float AdaptiveQualityController::renderScale() const
+{
+    return m_enabled?s_levels[m_level].m_renderScale:1.0;
+}
+
+bool AdaptiveQualityController::addFrameTime(float ms)
+{
+    if(!m_enabled) return false;
+    m_smoothedMs = (m_smoothedMs < 0.0)?ms:(AQ_SMOOTHING*ms + (1.0 - AQ_SMOOTHING)*m_smoothedMs);
+
+    //Predicted frame time at the current level
+    float current = m_smoothedMs*relativeCost(s_levels[m_level].m_stepFactor, s_levels[m_level].m_renderScale);
+    if(current > AQ_DEGRADE_THRESHOLD*m_targetMs) {
+        m_underBudgetFrames = 0;
+        if(++m_overBudgetFrames >= AQ_DEGRADE_FRAMES && m_level < levelCount() - 1) {
+            setLevel(m_level + 1);
+            return true;
+        }
+        return false;
+    }
+    m_overBudgetFrames = 0;
+
+    if(m_level > 0) {
+        const QualityLevel &better = s_levels[m_level - 1];
+        float predicted = m_smoothedMs*relativeCost(better.m_stepFactor, better.m_renderScale);
+        if(predicted < AQ_IMPROVE_THRESHOLD*m_targetMs) {
+            if(++m_underBudgetFrames >= AQ_IMPROVE_FRAMES) {
+                setLevel(m_level - 1);
+                return true;
+            }
+        } else
+            m_underBudgetFrames = 0;
+    }
+    return false;
+}
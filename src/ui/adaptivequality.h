@@ -0,0 +1,63 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef ADAPTIVEQUALITY_H
+#define ADAPTIVEQUALITY_H
+
+struct QualityLevel {
+    float m_stepFactor; // Multiplier on the configured step size
+    float m_renderScale; // Fraction of the viewport resolution
+};
+
+// Feedback controller that picks a quality level so that the measured raycasting time stays within a frame
+// time budget. Level 0 is the configured quality; higher levels sample coarser and at lower resolution.
+// Hysteresis: quality is lowered quickly once the smoothed time exceeds the budget, but only raised after a
+// number of consecutive frames whose predicted cost at the better level fits comfortably within the budget.
+class AdaptiveQualityController
+{
+public:
+    AdaptiveQualityController();
+    void setEnabled(bool flag);
+    bool const & enabled() const { return m_enabled;}
+    void setTargetFrameTime(float ms) { m_targetMs = ms;}
+    float const & targetFrameTime() const { return m_targetMs;}
+    // Feed the GPU time of a frame, normalized to full quality by dividing by relativeCost(). Returns true if
+    // the level changed.
+    bool addFrameTime(float ms);
+    int const & level() const { return m_level;}
+    float stepFactor() const;
+    float renderScale() const;
+    static int levelCount();
+    static float relativeCost(float stepFactor, float renderScale); // Cost relative to full quality
+
+private:
+    bool m_enabled;
+    float m_targetMs;
+    float m_smoothedMs; // Exponential moving average of full quality frame time, -1 if no sample yet
+    int m_level;
+    int m_overBudgetFrames, m_underBudgetFrames;
+    void setLevel(int level);
+};
+
+#endif // ADAPTIVEQUALITY_H
@@ -335,43 +335,25 @@ void Dialog1DTransferFunction::printStats()
     }
 }
 
-void Dialog1DTransferFunction::updateColorBuffer()
+TransferFunction1D Dialog1DTransferFunction::transferFunction() const
 {
-    //Extract plot data for color and alpha and populate the RGBA buffer
     QSharedPointer<QCPGraphDataContainer> colorData = ui->customPlot->graph(1)->data();
     QSharedPointer<QCPGraphDataContainer> alphaData = ui->customPlot->graph(2)->data();
-    double key, k1, k2;
-    QColor c1, c2;
-    double a1, a2;
-    int i1, i2;
-    double frac, alpha;
-    for(int i=0; i<256; i++) {
-        key = double(i)/255.0;
-        //1. Interpolate alpha
-       i1 = alphaData->findBegin(key, true) - alphaData->constBegin();
-        i2 = alphaData->findEnd(key, true) - alphaData->constBegin() - 1;
-        k1 = (alphaData->begin() + i1)->key;
-        k2 = (alphaData->begin() + i2)->key;
-        frac = (key - k1)/(k2 - k1);
-        a1 = (alphaData->begin() + i1)->value;
-        a2 = (alphaData->begin() + i2)->value;
-        alpha = a1 * (1-frac) + a2 * frac;
-        m_colorBuffer[i*4 + 3] = 255.0 * alpha;
-
-        //1. Interpolate color
-        //These ranges are always valid. for first point [0 1], for last [n-2, n-1], else [k-1 k+1].
-        i1 = colorData->findBegin(key, true) - colorData->constBegin();
-        i2 = colorData->findEnd(key, true) - colorData->constBegin() - 1;
-        k1 = (colorData->begin() + i1)->key;
-        k2 = (colorData->begin() + i2)->key;
-        frac = (key - k1)/(k2 - k1);
-        c1 = m_tracers[i1]->brush().color();
-        c2 = m_tracers[i2]->brush().color();
-        //Save colors as premultiplied by alpha (a.k.a. associated colors)
-        m_colorBuffer[i*4 + 0] = (c1.red() * (1-frac) + c2.red() * frac)*alpha;
-        m_colorBuffer[i*4 + 1] = (c1.green() * (1-frac) + c2.green() * frac)*alpha;
-        m_colorBuffer[i*4 + 2] = (c1.blue() * (1-frac) + c2.blue() * frac)*alpha;
+    TransferFunction1D tf;
+    tf.clear();
+    for(int i=0; i<alphaData->size(); i++)
+        tf.addAlphaNode((alphaData->begin() + i)->key, (alphaData->begin() + i)->value);
+    for(int i=0; i<colorData->size(); i++) {
+        QColor color = m_tracers[i]->brush().color();
+        tf.addColorNode((colorData->begin() + i)->key, color.red(), color.green(), color.blue());
     }
+    return tf;
+}
+
+void Dialog1DTransferFunction::updateColorBuffer()
+{
+    //Bake the plot data for color and alpha into the RGBA buffer
+    transferFunction().bake(m_colorBuffer);
     emit TFChanged(m_colorBuffer);
 }
 
@@ -420,63 +402,22 @@ void Dialog1DTransferFunction::loadTF()
                                                     QDir::currentPath(), "1D Color Transfer Function (*.tf1)", 0, QFileDialog::DontUseNativeDialog);
     if(filename.isEmpty()) return;
 
-    QFile file(filename);
-    if(!file.open(QFile::ReadOnly | QFile::Text)) {
-        fprintf(stderr, "Could not open 1D TF.\n");
-        return;
-    }
-
-    QXmlStreamReader xmlReader(file.readAll());
-    file.close();
+    TransferFunction1D tf;
+    if(!tf.load(filename.toLocal8Bit().constData())) return;
 
     //Clear current graphs
     clearPlots();
     //Initialize graphs
     setupPlots();
 
-    double key, alpha;
-    QColor color;
-    while(!xmlReader.atEnd()) {
-        xmlReader.readNext();
-        if(xmlReader.isStartElement()) {
-            if(xmlReader.name() == "Alpha") {
-                QVector<double> xdata, ydata;
-                while(!xmlReader.atEnd()) {
-                    xmlReader.readNext();
-                    if(xmlReader.isStartElement()) {
-                        if(xmlReader.name() == "Node") {
-                            key = -1; alpha = -1;
-                            foreach(const QXmlStreamAttribute &attr, xmlReader.attributes()) {
-                                if(attr.name().toString() == "Key")
-                                    key = attr.value().toDouble();
-                                if(attr.name().toString() == "Value")
-                                    alpha = attr.value().toDouble();
-                            }
-                            xdata.push_back(key); ydata.push_back(alpha);
-                        } else break;
-                    }
-                }
-                ui->customPlot->graph(2)->setData(xdata, ydata);
-            }
-            if(xmlReader.name() == "Color") {
-                while(!xmlReader.atEnd()) {
-                    xmlReader.readNext();
-                    if(xmlReader.isStartElement()) {
-                        if(xmlReader.name() == "Node") {
-                            key = -1; color = -1;
-                            foreach(const QXmlStreamAttribute &attr, xmlReader.attributes()) {
-                                if(attr.name().toString() == "Key")
-                                    key = attr.value().toDouble();
-                                if(attr.name().toString() == "Value")
-                                    color = attr.value().toString();
-                            }
-                            ui->customPlot->graph(1)->addData(key, -2*PLOT_MARGIN_Y);
-                            createColorItem(key, color);
-                        } else break;
-                    }
-                }
-            }
-        }
+    QVector<double> xdata, ydata;
+    foreach(const TFAlphaNode &node, tf.alphaNodes()) {
+        xdata.push_back(node.m_key); ydata.push_back(node.m_alpha);
+    }
+    ui->customPlot->graph(2)->setData(xdata, ydata);
+    foreach(const TFColorNode &node, tf.colorNodes()) {
+        ui->customPlot->graph(1)->addData(node.m_key, -2*PLOT_MARGIN_Y);
+        createColorItem(node.m_key, QColor(node.m_red, node.m_green, node.m_blue));
     }
 
     ui->customPlot->replot();
@@ -489,37 +430,5 @@ void Dialog1DTransferFunction::saveTF()
                                          QDir::currentPath(), "1D Color Transfer Function (*.tf1)", 0, QFileDialog::DontUseNativeDialog);
     if(filename.isEmpty()) return;
 
-    QSharedPointer<QCPGraphDataContainer> colorData = ui->customPlot->graph(1)->data();
-    QSharedPointer<QCPGraphDataContainer> alphaData = ui->customPlot->graph(2)->data();
-    QFile file(filename);
-    double key, alpha;
-    QColor color;
-
-    file.open(QIODevice::WriteOnly);
-    QXmlStreamWriter xmlWriter(&file);
-    xmlWriter.setAutoFormatting(true);
-    xmlWriter.writeStartDocument();
-    xmlWriter.writeStartElement("TransferFunction1D");
-    xmlWriter.writeStartElement("Alpha");
-    for(int i=0; i<alphaData->size(); i++) {
-        key = (alphaData->begin() + i)->key;
-        alpha = (alphaData->begin() + i)->value;
-        xmlWriter.writeStartElement("Node");
-        xmlWriter.writeAttribute("Key", QString("%1").arg(key));
-        xmlWriter.writeAttribute("Value", QString("%1").arg(alpha));
-        xmlWriter.writeEndElement();
-    }
-    xmlWriter.writeEndElement();//Alpha
-    xmlWriter.writeStartElement("Color");
-    for(int i=0; i<colorData->size(); i++) {
-        key = (colorData->begin() + i)->key;
-        color = m_tracers[i]->brush().color();
-        xmlWriter.writeStartElement("Node");
-        xmlWriter.writeAttribute("Key", QString("%1").arg(key));
-        xmlWriter.writeAttribute("Value", color.name());
-        xmlWriter.writeEndElement();
-    }
-    xmlWriter.writeEndElement();//Color
-    xmlWriter.writeEndDocument();
-    file.close();
+    transferFunction().save(filename.toLocal8Bit().constData());
 }
@@ -28,6 +28,7 @@
 #include <QDialog>
 #include "qcustomplot.h"
 #include "algorithm/volumemanager.h"
+#include "algorithm/transferfunction1d.h"
 
 class VolumeManager;
 
@@ -65,6 +66,7 @@ private:
     void printStats();
     void deselect();
     void updateColorBuffer();
+    TransferFunction1D transferFunction() const; // Nodes currently in the plots
     float* createAutoAlpha();
     Ui::Dialog1DTransferFunction *ui;
     bool m_isDataReady;
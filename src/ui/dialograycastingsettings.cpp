@@ -66,12 +66,73 @@ void DialogRaycastingSettings::on_radioButtonInterpolationLinear_clicked(bool ch
     if(checked) emit interpolationTypeChanged(InterpolationTrilinear);
 }
 
+void DialogRaycastingSettings::on_radioButtonInterpolationCubic_clicked(bool checked)
+{
+    if(checked) emit interpolationTypeChanged(Interpolationcubic);
+}
+
 void DialogRaycastingSettings::on_checkBoxJittered_toggled(bool checked)
 {
     emit enableJitteredSampling(checked);
 }
 
+void DialogRaycastingSettings::on_checkBoxTemporalAccumulation_toggled(bool checked)
+{
+    emit enableTemporalAccumulation(checked);
+}
+
+void DialogRaycastingSettings::on_checkBoxReprojection_toggled(bool checked)
+{
+    emit enableReprojection(checked);
+}
+
 void DialogRaycastingSettings::on_checkBoxPhongShading_toggled(bool checked)
 {
     emit togglePhongShading(checked);
 }
+
+void DialogRaycastingSettings::on_checkBoxPreintegrated_toggled(bool checked)
+{
+    emit enablePreintegration(checked);
+}
+
+void DialogRaycastingSettings::on_checkBoxContinuousRendering_toggled(bool checked)
+{
+    emit toggleContinuousRendering(checked);
+}
+
+void DialogRaycastingSettings::on_checkBoxInteractiveLOD_toggled(bool checked)
+{
+    ui->comboBoxLODScale->setEnabled(checked);
+    emit enableInteractiveLOD(checked);
+}
+
+void DialogRaycastingSettings::on_comboBoxLODScale_currentIndexChanged(int index)
+{
+    emit interactiveScaleChanged(1.0/(index + 2)); // 1/2, 1/3, 1/4
+}
+
+void DialogRaycastingSettings::on_checkBoxAdaptiveQuality_toggled(bool checked)
+{
+    ui->spinBoxTargetFrameTime->setEnabled(checked);
+    if(!checked) ui->labelQualityLevel->setText("Quality level: -");
+    emit enableAdaptiveQuality(checked);
+}
+
+void DialogRaycastingSettings::on_spinBoxTargetFrameTime_valueChanged(int value)
+{
+    emit targetFrameTimeChanged(value);
+}
+
+void DialogRaycastingSettings::on_comboBoxBackend_currentIndexChanged(int index)
+{
+    const RenderBackend backends[] = {RenderBackendGL, RenderBackendCPU, RenderBackendGLCompute}; //Combo box order
+    emit renderBackendChanged(backends[index]);
+}
+
+void DialogRaycastingSettings::showQualityLevel(int level, float stepSize, float renderScale)
+{
+    if(!ui->checkBoxAdaptiveQuality->isChecked()) return;
+    ui->labelQualityLevel->setText(QString("Quality level: %1 (step %2, resolution %3%)")
+                                   .arg(level).arg(stepSize).arg(int(100*renderScale)));
+}
@@ -43,12 +43,25 @@ public:
     void enableDirectRenderingToggle();
     QPoint m_windowPosition;
 
+public slots:
+    void showQualityLevel(int level, float stepSize, float renderScale);
+
 private slots:
     void on_sliderStepSize_valueChanged(int value);
     void on_radioButtonInterpolationNN_clicked(bool checked);
     void on_radioButtonInterpolationLinear_clicked(bool checked);
+    void on_radioButtonInterpolationCubic_clicked(bool checked);
     void on_checkBoxJittered_toggled(bool checked);
+    void on_checkBoxTemporalAccumulation_toggled(bool checked);
+    void on_checkBoxReprojection_toggled(bool checked);
     void on_checkBoxPhongShading_toggled(bool checked);
+    void on_checkBoxPreintegrated_toggled(bool checked);
+    void on_checkBoxContinuousRendering_toggled(bool checked);
+    void on_checkBoxInteractiveLOD_toggled(bool checked);
+    void on_comboBoxLODScale_currentIndexChanged(int index);
+    void on_checkBoxAdaptiveQuality_toggled(bool checked);
+    void on_spinBoxTargetFrameTime_valueChanged(int value);
+    void on_comboBoxBackend_currentIndexChanged(int index);
 
 private:
     Ui::DialogRaycastingSettings *ui;
@@ -59,7 +72,16 @@ signals:
     void stepSizeChanged(float);
     void interpolationTypeChanged(RaycastingInterpolationType);
     void enableJitteredSampling(bool);
+    void enableTemporalAccumulation(bool);
+    void enableReprojection(bool);
     void togglePhongShading(bool);
+    void enablePreintegration(bool);
+    void toggleContinuousRendering(bool);
+    void enableInteractiveLOD(bool);
+    void interactiveScaleChanged(float);
+    void enableAdaptiveQuality(bool);
+    void targetFrameTimeChanged(float);
+    void renderBackendChanged(RenderBackend);
 };
 
 #endif // DIALOGRAYCASTINGSETTINGS_H
@@ -26,15 +26,24 @@
 
 #include <QDebug>
 #include <QString>
-#include <QOpenGLShaderProgram>
+#include <QFile>
 #include <QGLFormat>
 #include <QMouseEvent>
+#include <QOpenGLFramebufferObject>
+#include <QTimer>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QStandardPaths>
+#include "algorithm/profiler.h"
+#include "algorithm/normals.h"
 #include <OpenGLError>
 
 #include <math.h>
-#include <time.h>
 #include <limits.h>
 
+static const char* s_gpuPassNames[] = {"gpu.raycast", "gpu.upscale", "gpu.raycast.onthefly"};
+
 GLWidget::GLWidget(QWidget *parent) : QOpenGLWidget(parent), m_debugLogger(Q_NULLPTR)
 {
     //Widget specific
@@ -43,6 +52,7 @@ GLWidget::GLWidget(QWidget *parent) : QOpenGLWidget(parent), m_debugLogger(Q_NUL
 
     //Connections
     connect(parent, SIGNAL(volumeDataCreated(VolumeManager*)), this, SLOT(createVolume(VolumeManager*)));
+    connect(parent, SIGNAL(channelDataCreated(int,VolumeManager*,unsigned char*)), this, SLOT(addChannel(int,VolumeManager*,unsigned char*)));
 
     // Initialize the GL context before the window is shown, otherwise we’ll end up with a Compatability Profile
     QSurfaceFormat format;
@@ -59,13 +69,25 @@ GLWidget::GLWidget(QWidget *parent) : QOpenGLWidget(parent), m_debugLogger(Q_NUL
 #endif
 
     // Data
-    m_nVertices = 0;
     m_trackBall = new TrackBall(1.5);
     m_volumeManager = NULL;
     m_stepSize = 0.01;
     m_interpolationtype = InterpolationTrilinear;
     m_useJittering = 0;
+    m_temporalAccumulation = true;
+    m_preintegrated = false;
     m_PerformPhongShading = true;
+    m_backend = RenderBackendGL;
+    m_normals = NULL;
+    m_continuousRendering = false;
+    m_lodFBO = NULL;
+    m_showStats = false;
+    m_effectiveStepSize = m_stepSize;
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    connect(m_idleTimer, SIGNAL(timeout()), this, SLOT(on_interactionIdle()));
+    m_occupancyBuilder = new OccupancyBuilder(this);
+    connect(m_occupancyBuilder, SIGNAL(occupancyUpdated()), this, SLOT(on_occupancyUpdated()));
 }
 
 GLWidget::~GLWidget()
@@ -74,6 +96,7 @@ GLWidget::~GLWidget()
     teardownGL();
 
     delete m_trackBall;
+    delete []m_normals;
 }
 
 // OpenGL Events
@@ -82,7 +105,7 @@ void GLWidget::initializeGL()
 {
     //Initialize OpenGL Backend
     initializeOpenGLFunctions();
-    connect(this, SIGNAL(frameSwapped()), this, SLOT(update()));
+    //Frames are only rendered when state changes call update(); continuous rendering is opt-in via setContinuousRendering()
     printContextInformation();
 
     //Set global information
@@ -96,14 +119,28 @@ void GLWidget::initializeGL()
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    //Create GL programs and buffers
-    m_program = new QOpenGLShaderProgram();
-    m_program->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/cube.vs");
-    m_program->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/cube.fs");
-    m_program->link();
+    //Create GL programs and buffers; linked programs are cached on disk as driver binaries between runs
+    QElapsedTimer programTimer;
+    programTimer.start();
+    QString programCache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programs";
+    if(QDir().mkpath(programCache))
+        m_raycaster.setProgramCache(programCache.toLocal8Bit().constData());
+    QFile vertexShader(":/shaders/cube.vs"), fragmentShader(":/shaders/cube.fs");
+    vertexShader.open(QFile::ReadOnly);
+    fragmentShader.open(QFile::ReadOnly);
+    if(!m_raycaster.create(vertexShader.readAll().constData(), fragmentShader.readAll().constData()))
+        fprintf(stderr, "Could not create the raycasting program.\n");
+    else { //Toggling a raycasting setting then only switches programs
+        m_raycaster.precompileVariants();
+        float ms = programTimer.nsecsElapsed()*1e-6f;
+        bool warm = (m_raycaster.programCacheMisses() == 0);
+        Profiler::instance().record(warm?"startup.programs.warm":"startup.programs.cold", ms);
+        fprintf(stderr, "Raycasting programs: %d loaded from cache, %d compiled in %.1f ms (%s start).\n",
+                m_raycaster.programCacheHits(), m_raycaster.programCacheMisses(), ms, warm?"warm":"cold");
+    }
 
-    m_VAO.create();
-    createCube();
+    if(!m_gpuTimer.create())
+        fprintf(stderr, "GPU timer queries not supported, adaptive quality is disabled.\n");
 
     //Application specific initialization
 #if GL_DEBUG
@@ -131,67 +168,218 @@ void GLWidget::paintGL()
 
     //Render volume
     if(!m_volumeManager) return;
+    ScopedSpan span("frame");
+
+    processGPUTimings();
+
+    float scale = m_lod.renderScale()*m_adaptiveQuality.renderScale();
+    float stepFactor = m_lod.stepFactor()*m_adaptiveQuality.stepFactor();
+    float cost = AdaptiveQualityController::relativeCost(stepFactor, scale);
+    m_effectiveStepSize = m_stepSize*stepFactor;
+    int fullWidth = width()*devicePixelRatioF();
+    int fullHeight = height()*devicePixelRatioF();
+    int raycastPass = m_raycaster.usesOnTheFlyGradients()?GPUPassRaycastOnTheFly:GPUPassRaycast;
+    if(m_backend == RenderBackendCPU) {
+        renderVolumeCPU(scale, m_stepSize*stepFactor, stepFactor, cost);
+    } else if(scale < 1.0) {
+        //Raycast into a reduced resolution offscreen target and upscale it into the widget framebuffer
+        int lodWidth = qMax(1, int(fullWidth*scale));
+        int lodHeight = qMax(1, int(fullHeight*scale));
+        if(!m_lodFBO || m_lodFBO->size() != QSize(lodWidth, lodHeight)) {
+            delete m_lodFBO;
+            m_lodFBO = new QOpenGLFramebufferObject(lodWidth, lodHeight);
+        }
+        m_lodFBO->bind();
+        glViewport(0, 0, lodWidth, lodHeight);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_gpuTimer.begin(raycastPass, cost);
+        renderVolume(m_stepSize*stepFactor, stepFactor);
+        m_gpuTimer.end();
+
+        m_lodFBO->release();
+        //A NULL target blits into the context's default framebuffer, i.e. the widget's FBO
+        m_gpuTimer.begin(GPUPassUpscale);
+        QOpenGLFramebufferObject::blitFramebuffer(NULL, QRect(0, 0, fullWidth, fullHeight),
+                                                  m_lodFBO, QRect(0, 0, lodWidth, lodHeight),
+                                                  GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        m_gpuTimer.end();
+        glViewport(0, 0, fullWidth, fullHeight);
+    } else {
+        m_gpuTimer.begin(raycastPass, cost);
+        renderVolume(m_stepSize*stepFactor, stepFactor);
+        m_gpuTimer.end();
+    }
 
-    m_program->bind();
-    {
+    span.stop();
+    if(m_showStats) drawStatsOverlay();
 
-        glActiveTexture(GL_TEXTURE0);
-        //glEnable(GL_TEXTURE_3D);
-        glBindTexture(GL_TEXTURE_3D, m_textureVol);
-        m_program->setUniformValue(m_uTexVol, 0);
-
-        glActiveTexture(GL_TEXTURE1);
-        //glEnable(GL_TEXTURE_1D);
-        glBindTexture(GL_TEXTURE_1D, m_textureTF1D);
-        m_program->setUniformValue(m_uTexTF1D, 1);
-
-        glActiveTexture(GL_TEXTURE2);
-        //glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, m_textureNoise);
-        m_program->setUniformValue(m_uTexNoise, 2);
-
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_3D, m_textureVolNormals);
-        m_program->setUniformValue(m_uTexVolNormals, 4);
-
-        m_program->setUniformValue(m_uProjection, m_projection);
-        m_view = m_trackBall->getCurrentTransform();
-        m_program->setUniformValue(m_uView, m_view);
-        m_program->setUniformValue(m_uTime, (float)clock()/CLOCKS_PER_SEC);
-        m_program->setUniformValue(m_uStepSize, m_stepSize);
-        m_program->setUniformValue(m_uUseJittering, m_useJittering);
-        m_program->setUniformValue(m_uBBox, m_bbox);
-        m_program->setUniformValue(m_uPerformPhongShading, m_PerformPhongShading?1:0);
-
-        m_VAO.bind();
-        glDrawArrays(GL_TRIANGLES, 0, m_nVertices);
-        m_VAO.release();
-
-        glBindTexture(GL_TEXTURE_3D, 0);
-        glBindTexture(GL_TEXTURE_1D, 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+    //Progressive refinement: keep rendering until full quality is reached, then until the jittered frames converge
+    if(m_lod.advance()) QOpenGLWidget::update();
+    else if(m_backend != RenderBackendCPU && m_raycaster.usesAccumulation() && !m_raycaster.accumulationConverged())
+        QOpenGLWidget::update();
+}
+
+void GLWidget::processGPUTimings()
+{
+    m_gpuTimings.clear();
+    m_gpuTimer.poll(m_gpuTimings);
+    foreach(const GPUTimerResult &timing, m_gpuTimings) {
+        Profiler::instance().record(s_gpuPassNames[timing.m_tag], timing.m_ms);
+        if(timing.m_tag == GPUPassUpscale) continue;
+        //Normalize to the cost of a full quality frame, so LOD frames can be fed as well
+        float ms = timing.m_ms/timing.m_userValue;
+        if(m_adaptiveQuality.addFrameTime(ms))
+            emit qualityLevelChanged(m_adaptiveQuality.level(), m_stepSize*m_adaptiveQuality.stepFactor(), m_adaptiveQuality.renderScale());
+        //Only shaded frames tell the gradient sources apart, and the stored one needs the normals
+        GradientSource source = (timing.m_tag == GPUPassRaycastOnTheFly)?GradientSourceOnTheFly:GradientSourceStored;
+        if(m_PerformPhongShading && m_normals && m_gradientSource.addFrameTime(source, ms))
+            applyGradientSource();
     }
-    m_program->release();
+}
+
+//Requires a current context
+void GLWidget::applyGradientSource()
+{
+    if(m_gradientSource.source() == GradientSourceOnTheFly) m_raycaster.setOnTheFlyGradients(true);
+    else if(m_normals) m_raycaster.setNormals(m_normals);
+    else m_raycaster.setOnTheFlyGradients(false);
+    update();
+}
+
+void GLWidget::enableAdaptiveQuality(bool flag)
+{
+    m_adaptiveQuality.setEnabled(flag && m_gpuTimer.isCreated());
+    emit qualityLevelChanged(m_adaptiveQuality.level(), m_stepSize*m_adaptiveQuality.stepFactor(), m_adaptiveQuality.renderScale());
+    update();
+}
+
+void GLWidget::setTargetFrameTime(float ms)
+{
+    m_adaptiveQuality.setTargetFrameTime(ms);
+}
+
+void GLWidget::showStatsOverlay(bool flag)
+{
+    m_showStats = flag;
+    update();
+}
 
+float GLWidget::estimateSamplesPerRay() const
+{
+    //Mean chord of parallel rays through a box is its volume over its projected area. Ignores early termination.
+    QVector3D eye = (m_view.inverted()*QVector4D(0, 0, 0, 1)).toVector3D();
+    QVector3D d = (-eye).normalized();
+    float area = fabs(d.x())*m_bbox.y()*m_bbox.z() + fabs(d.y())*m_bbox.x()*m_bbox.z() + fabs(d.z())*m_bbox.x()*m_bbox.y();
+    if(area <= 0.0 || m_effectiveStepSize <= 0.0) return 0.0;
+    return m_bbox.x()*m_bbox.y()*m_bbox.z()/area/m_effectiveStepSize;
+}
+
+void GLWidget::drawStatsOverlay()
+{
+    ProfilerStats stats;
+    QStringList lines;
+    Profiler &profiler = Profiler::instance();
+    if(profiler.stats("frame", stats))
+        lines << QString("CPU frame   %1 ms (p50 %2, p95 %3)").arg(stats.m_last, 0, 'f', 2).arg(stats.m_p50, 0, 'f', 2).arg(stats.m_p95, 0, 'f', 2);
+    if(profiler.stats("gpu.raycast", stats))
+        lines << QString("GPU raycast %1 ms (p50 %2, p95 %3)").arg(stats.m_last, 0, 'f', 2).arg(stats.m_p50, 0, 'f', 2).arg(stats.m_p95, 0, 'f', 2);
+    if(profiler.stats("cpu.raycast", stats) && m_backend == RenderBackendCPU)
+        lines << QString("CPU raycast %1 ms (p50 %2, p95 %3)").arg(stats.m_last, 0, 'f', 2).arg(stats.m_p50, 0, 'f', 2).arg(stats.m_p95, 0, 'f', 2);
+    if(profiler.stats("gpu.upscale", stats))
+        lines << QString("GPU upscale %1 ms").arg(stats.m_last, 0, 'f', 2);
+    lines << QString("Samples/ray ~%1 (step %2)").arg(estimateSamplesPerRay(), 0, 'f', 0).arg(m_effectiveStepSize);
+    if(profiler.stats("upload.volume", stats))
+        lines << QString("Upload vol  %1 MB/s (%2 ms)").arg(stats.m_lastMBps, 0, 'f', 0).arg(stats.m_last, 0, 'f', 1);
+    if(profiler.stats("upload.normals", stats))
+        lines << QString("Upload nrm  %1 MB/s (%2 ms)").arg(stats.m_lastMBps, 0, 'f', 0).arg(stats.m_last, 0, 'f', 1);
+
+    QPainter painter(this);
+    QFont font("Monospace", 9);
+    font.setStyleHint(QFont::TypeWriter);
+    painter.setFont(font);
+    QFontMetrics metrics(font);
+    int lineHeight = metrics.height();
+    int boxWidth = 0;
+    foreach(const QString &line, lines) boxWidth = qMax(boxWidth, metrics.width(line));
+    painter.fillRect(QRect(4, 4, boxWidth + 8, lines.size()*lineHeight + 8), QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    for(int i=0; i<lines.size(); i++)
+        painter.drawText(8, 8 + metrics.ascent() + i*lineHeight, lines[i]);
+    painter.end();
+}
+
+RaycastParameters GLWidget::raycastParameters(float stepSize, float opacityCorrection) const
+{
+    RaycastParameters params;
+    params.m_stepSize = stepSize;
+    params.m_opacityCorrection = opacityCorrection;
+    params.m_useJittering = (m_useJittering == 1);
+    params.m_performPhongShading = m_PerformPhongShading;
+    params.m_preintegrated = m_preintegrated;
+    return params;
+}
+
+void GLWidget::renderVolume(float stepSize, float opacityCorrection)
+{
+    m_view = m_trackBall->getCurrentTransform();
+    m_raycaster.render(Mat4(m_view.constData()), Mat4(m_projection.constData()), raycastParameters(stepSize, opacityCorrection));
+}
+
+void GLWidget::renderVolumeCPU(float scale, float stepSize, float opacityCorrection, float cost)
+{
+    //Raycast on the CPU at the (possibly reduced) resolution and draw the image over the cleared framebuffer
+    int cpuWidth = qMax(1, int(width()*devicePixelRatioF()*scale));
+    int cpuHeight = qMax(1, int(height()*devicePixelRatioF()*scale));
+    if(m_cpuImage.size() != QSize(cpuWidth, cpuHeight))
+        m_cpuImage = QImage(cpuWidth, cpuHeight, QImage::Format_RGBA8888);
+
+    QElapsedTimer timer;
+    timer.start();
+    m_view = m_trackBall->getCurrentTransform();
+    m_cpuRaycaster.render(Mat4(m_view.constData()), Mat4(m_projection.constData()), raycastParameters(stepSize, opacityCorrection),
+                          cpuWidth, cpuHeight, m_cpuImage.bits());
+    //No GPU pass to time; feed adaptive quality with the CPU raycasting time instead
+    if(m_adaptiveQuality.addFrameTime(timer.nsecsElapsed()/1.0e6/cost))
+        emit qualityLevelChanged(m_adaptiveQuality.level(), m_stepSize*m_adaptiveQuality.stepFactor(), m_adaptiveQuality.renderScale());
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, scale < 1.0);
+    painter.drawImage(rect(), m_cpuImage);
+    painter.end();
+}
+
+void GLWidget::setRenderBackend(RenderBackend backend)
+{
+    m_backend = backend;
+    m_raycaster.setUseCompute(backend == RenderBackendGLCompute); //Falls back to the fragment raycaster before 4.3
+    update();
 }
 
 void GLWidget::update()
 {
     if(!m_volumeManager) return;
 
+    //Several calls before the next paint are collapsed into a single frame by QOpenGLWidget::update()
     QOpenGLWidget::update();
 }
 
-void GLWidget::teardownGL()
+void GLWidget::setContinuousRendering(bool flag)
 {
-    if(!m_volumeManager) return;
+    if(flag == m_continuousRendering) return;
+    m_continuousRendering = flag;
+    if(m_continuousRendering) {
+        connect(this, SIGNAL(frameSwapped()), this, SLOT(update()));
+        update();
+    } else
+        disconnect(this, SIGNAL(frameSwapped()), this, SLOT(update()));
+}
 
-    m_VAO.destroy();
-    if(m_program) delete m_program;
-    glDeleteTextures(1, &m_textureVol);
-    glDeleteTextures(1, &m_textureTF1D);
-    glDeleteTextures(1, &m_textureNoise);
-    glDeleteTextures(1, &m_textureVolNormals);
+void GLWidget::teardownGL()
+{
+    m_gpuTimer.destroy();
+    m_raycaster.destroy();
+    if(m_lodFBO) delete m_lodFBO;
+    m_lodFBO = NULL;
 }
 
 // OpenGL helper functions
@@ -224,142 +412,41 @@ void GLWidget::printContextInformation()
 void GLWidget::createVolume(VolumeManager *vm)
 {
     m_volumeManager = vm;
-    float maxdim = fmax(vm->width(), fmax(vm->height(), vm->depth()));
-    m_volAspect[0] = vm->width()/maxdim;
-    m_volAspect[1] = vm->height()/maxdim;
-    m_volAspect[2] = vm->depth()/maxdim;
-    //Spacing is usually 1, but can be different in a certain dimension
-    m_volSpacing[0] = vm->spacingX();
-    m_volSpacing[1] = vm->spacingY();
-    m_volSpacing[2] = vm->spacingZ();
-    m_bbox = m_volSpacing*m_volAspect;
-
-    m_program->bind(); // Equivalent to glUseProgram
-
-    //Get attribute/uniform locations
-    m_uView = m_program->uniformLocation("uView");
-    m_uProjection = m_program->uniformLocation("uProjection");
-    m_uTexVol = m_program->uniformLocation("uTexVol");
-    m_uTexTF1D = m_program->uniformLocation("uTexTF1D");
-    m_uTexNoise = m_program->uniformLocation("uTexNoise");
-    m_uTexVolNormals = m_program->uniformLocation("uTexVolNormals");
-    m_uTime = m_program->uniformLocation("uTime");
-    m_uStepSize  = m_program->uniformLocation("uStepSize");
-    m_uUseJittering = m_program->uniformLocation("uUseJittering");
-    m_uBBox = m_program->uniformLocation("uBBox");
-    m_uPerformPhongShading = m_program->uniformLocation("uPerformPhongShading");
-
-    //Prepare texture
-    int width = m_volumeManager->width();
-    int height = m_volumeManager->height();
-    int depth = m_volumeManager->depth();
-    glGenTextures(1, &m_textureVol);
-    glBindTexture(GL_TEXTURE_3D, m_textureVol);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F,
-                 width, height, depth,
-                 0, GL_RED, GL_FLOAT, (GLvoid*)m_volumeManager->data());
-    glBindTexture(GL_TEXTURE_3D, 0);
-
-
-    //Create 1D texture for Trasfer function (size: 256)
-    glGenTextures(1, &m_textureTF1D);
-    glBindTexture(GL_TEXTURE_1D, m_textureTF1D);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_BASE_LEVEL, 0);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAX_LEVEL, 0);
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL); //Need to fill data into this texture later.
-    glBindTexture(GL_TEXTURE_1D, 0);
-
-    //Create 2D texture for noise (size: 32 x 32)
-    int size = 32;
-    unsigned char * buffer  = new unsigned char[size*size];
-    srand((unsigned)time(NULL));
-    for (int i=0; i<(size*size); i++) {
-        buffer[i] = 255.*rand()/(float)RAND_MAX;
-    }
-    glGenTextures(1, &m_textureNoise);
-    glBindTexture(GL_TEXTURE_2D, m_textureNoise);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, 32, 32, 0, GL_RED, GL_UNSIGNED_BYTE, buffer);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    delete [] buffer;
-
-    //Generate RGBA normals texture (fill it up with 127: (0.5 in float))
-    long nelem = width*height*depth;
-    unsigned char *normals = new unsigned char[4*nelem];
-    memset(normals, 127, 4*nelem);
-    glGenTextures(1, &m_textureVolNormals);
-    glBindTexture(GL_TEXTURE_3D, m_textureVolNormals);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8,
-                 width, height, depth,
-                 0, GL_RGBA, GL_UNSIGNED_BYTE, normals);
-    glBindTexture(GL_TEXTURE_3D, 0);
-    delete [] normals;
-
-    m_program->release();
+
+    makeCurrent();
+    m_raycaster.setVolume(vm->width(), vm->height(), vm->depth(), vm->data(), vm->spacingX(), vm->spacingY(), vm->spacingZ());
+    m_raycaster.setInterpolationType(m_interpolationtype);
+    //Normals that would crowd the video memory are never uploaded
+    long long normalsBytes = 4LL*vm->width()*vm->height()*vm->depth();
+    m_gradientSource.reset(normalsBytes, m_raycaster.freeTextureMemory());
+    if(m_gradientSource.memoryBound())
+        fprintf(stderr, "Normals (%lld MB) exceed the video memory budget, computing gradients on the fly.\n", normalsBytes >> 20);
+    m_raycaster.setOnTheFlyGradients(m_gradientSource.source() == GradientSourceOnTheFly);
+    doneCurrent();
+    m_cpuRaycaster.setVolume(vm->width(), vm->height(), vm->depth(), vm->data(), vm->spacingX(), vm->spacingY(), vm->spacingZ());
+    m_cpuRaycaster.setInterpolationType(m_interpolationtype);
+    delete []m_normals;
+    m_normals = NULL;
+    Vec3 bbox = m_raycaster.bbox();
+    m_bbox = QVector3D(bbox.x, bbox.y, bbox.z);
+    m_occupancyBuilder->setVolume(vm);
 
     update();
 }
 
-void GLWidget::createCube()
-{
-    //Geometry data: [-1, 1]^3
-    GLfloat cube_vertices[] = {1, 1, 1, -1, 1, 1, -1, -1, 1, 1, -1, 1, //Front
-                   1, 1, -1, -1, 1, -1, -1, -1, -1, 1, -1, -1}; //Back
-    GLushort cube_indices[] = {0, 2, 3, 0, 1, 2, //Front
-                4, 7, 6, 4, 6, 5, //Back
-                5, 2, 1, 5, 6, 2, //Left
-                4, 3, 7, 4, 0, 3, //Right
-                1, 0, 4, 1, 4, 5, //Top
-                2, 7, 3, 2, 6, 7}; //Bottom
-    m_nVertices = 6*2*3; //(6 faces) * (2 triangles each) * (3 vertices each)
-    GLfloat *expanded_vertices = new GLfloat[m_nVertices*3];
-
-    for(int i=0; i<m_nVertices; i++) {
-        expanded_vertices[i*3] = cube_vertices[cube_indices[i]*3];
-        expanded_vertices[i*3 + 1] = cube_vertices[cube_indices[i]*3+1];
-        expanded_vertices[i*3 + 2] = cube_vertices[cube_indices[i]*3+2];
-    }
-
-    m_program->bind(); // Equivalent to glUseProgram
-
-    //Setup VBO
-    m_VAO.bind();
-
-    QOpenGLBuffer cube_VBO(QOpenGLBuffer::VertexBuffer);
-    cube_VBO.create();
-    //cube_VBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    cube_VBO.bind();
-    cube_VBO.allocate(expanded_vertices, m_nVertices*3*sizeof(GLfloat));
-
-    //Bind VAO and save state
-
-    m_program->enableAttributeArray(0);
-    m_program->setAttributeBuffer(0, GL_FLOAT, 0, 3);
-
-    //Release/unbind all
-    cube_VBO.release();
-    m_VAO.release();
-
-    m_program->release();
-
-    delete[] expanded_vertices;
+void GLWidget::addChannel(int channel, VolumeManager *vm, unsigned char *colorBuffer)
+{
+    //Fused into the same rays as the volume; occupancy only covers the volume, so empty space skipping is off
+    makeCurrent();
+    if(m_raycaster.setChannel(channel, vm->width(), vm->height(), vm->depth(), vm->data(), vm->spacingX(), vm->spacingY(),
+                              vm->spacingZ(), false))
+        m_raycaster.setChannelTransferFunction(channel, colorBuffer);
+    m_raycaster.precompileVariants(); //A new channel mask, compile its variants before the first frame needs them
+    doneCurrent();
+    if(m_cpuRaycaster.setChannel(channel, vm->width(), vm->height(), vm->depth(), vm->data(), vm->spacingX(), vm->spacingY(),
+                                 vm->spacingZ(), false))
+        m_cpuRaycaster.setChannelTransferFunction(channel, colorBuffer);
+    update();
 }
 
 void GLWidget::mouseMoveEvent(QMouseEvent *event)
@@ -370,6 +457,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
         normalizeCoordinates(x, y);
         m_trackBall->rotate(x, y);
 
+        beginInteraction();
         update();
     } else if(event->buttons() == Qt::RightButton) {
         float x = event->x();
@@ -377,6 +465,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
         normalizeCoordinates(x, y);
         m_trackBall->zoom(x, y);
 
+        beginInteraction();
         update();
     }
 }
@@ -389,6 +478,7 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
         normalizeCoordinates(x, y);
         m_trackBall->beginRotate(x, y);
 
+        beginInteraction();
         update();
     } else if(event->buttons() == Qt::RightButton) {
         float x = event->x();
@@ -396,6 +486,7 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
         normalizeCoordinates(x, y);
         m_trackBall->beginZoom(x, y);
 
+        beginInteraction();
         update();
     }
 }
@@ -419,6 +510,36 @@ void GLWidget::mouseReleaseEvent(QMouseEvent *event)
     }
 }
 
+void GLWidget::beginInteraction()
+{
+    //Drop to interactive quality and (re)arm the idle timer that starts refinement
+    m_lod.beginInteraction();
+    if(m_lod.mode() != RenderModeFull)
+        m_idleTimer->start(m_lod.policy().m_idleTimeoutMs);
+}
+
+void GLWidget::on_interactionIdle()
+{
+    m_lod.idle();
+    update();
+}
+
+void GLWidget::enableInteractiveLOD(bool flag)
+{
+    m_lod.policy().m_enabled = flag;
+    if(!flag) {
+        m_idleTimer->stop();
+        m_lod.idle();
+        while(m_lod.advance()); //Jump to full quality
+        update();
+    }
+}
+
+void GLWidget::setInteractiveScale(float scale)
+{
+    m_lod.policy().m_interactiveScale = scale;
+}
+
 void GLWidget::keyPressEvent(QKeyEvent *k)
 {
 
@@ -438,92 +559,100 @@ void GLWidget::normalizeCoordinates(float &x, float &y)
 void GLWidget::TF1DChanged(unsigned char *colorBuffer)
 {
     //colorbuffer has associated colors (i.e., alpha is premultiplied)
-    //glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_1D, m_textureTF1D);
-    glTexSubImage1D(GL_TEXTURE_1D, 0, 0, 256, GL_RGBA, GL_UNSIGNED_BYTE, colorBuffer);
+    makeCurrent();
+    m_raycaster.setTransferFunction(colorBuffer);
+    doneCurrent();
+    m_cpuRaycaster.setTransferFunction(colorBuffer);
+
+    //Occupancy depends on the TF; rebuild it in the background
+    m_occupancyBuilder->requestRebuild(colorBuffer);
+    update();
 }
 
 void GLWidget::raycasterStepSizeChanged(float stepSize)
 {
     m_stepSize = stepSize;
+    if(m_adaptiveQuality.enabled())
+        emit qualityLevelChanged(m_adaptiveQuality.level(), m_stepSize*m_adaptiveQuality.stepFactor(), m_adaptiveQuality.renderScale());
+    update();
 }
 
 void GLWidget::raycasterInterpolationTypeChanged(RaycastingInterpolationType type)
 {
     m_interpolationtype = type;
+    if(!m_raycaster.hasVolume()) return;
 
-    if(m_interpolationtype == InterpolationNearestNeighbour) {
-        glBindTexture(GL_TEXTURE_3D, m_textureVol);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    }
-    else if(m_interpolationtype == InterpolationTrilinear)  {
-        glBindTexture(GL_TEXTURE_3D, m_textureVol);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else
-        fprintf(stderr, "Unknown texture interpolation mode. Ignoring...\n");
-
-    glBindTexture(GL_TEXTURE_3D, 0);
+    makeCurrent();
+    m_raycaster.setInterpolationType(m_interpolationtype);
+    doneCurrent();
+    m_cpuRaycaster.setInterpolationType(m_interpolationtype);
+    update();
 }
 
 void GLWidget::enableJitteredSampling(bool flag)
 {
     m_useJittering = (flag)?1:0;
+    m_raycaster.setAccumulation(m_temporalAccumulation && flag); //Without jitter every frame is the same
+    update();
 }
 
-void GLWidget::on_volumeGradientComputed()
+void GLWidget::enableTemporalAccumulation(bool flag)
+{
+    m_temporalAccumulation = flag;
+    m_raycaster.setAccumulation(flag && m_useJittering == 1);
+    update();
+}
+
+void GLWidget::enableReprojection(bool flag)
 {
-    float *gradient = m_volumeManager->gradient();
+    m_raycaster.setReprojection(flag);
+    update();
+}
 
+void GLWidget::togglePhongShading(bool flag)
+{
+    m_PerformPhongShading = flag;
+    update();
+}
+
+void GLWidget::enablePreintegration(bool flag)
+{
+    m_preintegrated = flag;
+    update();
+}
+
+void GLWidget::on_volumeGradientComputed()
+{
+    ScopedSpan span("normals");
+    ScopedSpan encodeSpan("normals.encode");
     int width = m_volumeManager->width();
     int height = m_volumeManager->height();
     int depth = m_volumeManager->depth();
-    long nelem = width*height*depth;
-
-    //Rescale gradient field to have magnitudes in [0, 1]
-    float *gradmag = new float[nelem];
-    float gx, gy, gz;
-    float gmag_max = std::numeric_limits<float>::min();
-    for(long i=0; i<nelem; i++) {
-            gx = gradient[3*i];
-            gy = gradient[3*i+1];
-            gz = gradient[3*i+2];
-            gradmag[i] = sqrtf(gx*gx + gy*gy + gz*gz);
-            if(gradmag[i] > gmag_max) gmag_max = gradmag[i];
-    }
-    for(long i=0; i<nelem; i++) {
-     gradmag[i] /= gmag_max;
-    }
+    long nelem = (long)width*height*depth;
 
-    //Encode rescaled shading normals to a uchar texture
     unsigned char *normals = new unsigned char[4*nelem];
-    for(long i=0; i<nelem; i++) {
-        gx = gradient[3*i];
-        gy = gradient[3*i+1];
-        gz = gradient[3*i+2];
-        normals[4*i] = (unsigned char)(255.0*(gx/gmag_max + 1.0)/2.0); //Map vector [-1, +1] -> [0, 1]
-        normals[4*i+1] = (unsigned char)(255.0*(gy/gmag_max + 1.0)/2.0);
-        normals[4*i+2] = (unsigned char)(255.0*(gz/gmag_max + 1.0)/2.0);
-        normals[4*i+3] = 0;
-    }
+    encodeNormals(m_volumeManager->gradient(), nelem, normals);
+    encodeSpan.stop();
+
+    //The CPU raycaster samples the encoded normals in place; the GL one only if they are the gradient source
+    m_cpuRaycaster.setNormals(normals);
+    delete []m_normals;
+    m_normals = normals;
+    makeCurrent();
+    applyGradientSource();
+    doneCurrent();
+}
+
+void GLWidget::on_occupancyUpdated()
+{
+    QSharedPointer<OccupancyGrid> grid = m_occupancyBuilder->grid();
+    if(!grid) return;
 
-    //Upload normals - destroy the old texture and recreate new (Updating the existing 3D texture does not work on MacOS)
-    glDeleteTextures(1, &m_textureVolNormals);
-    glGenTextures(1, &m_textureVolNormals);
-    glBindTexture(GL_TEXTURE_3D, m_textureVolNormals);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, width, height, depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, normals);
-    //glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, width, height, depth, GL_RGBA, GL_UNSIGNED_BYTE, normals);
-    glBindTexture(GL_TEXTURE_3D, 0);
-
-    //Clean up
-    delete []normals;
+    makeCurrent();
+    m_raycaster.setOccupancy(*grid);
+    doneCurrent();
+
+    update();
 }
 
 void GLWidget::messageLogged(const QOpenGLDebugMessage &msg)
@@ -27,17 +27,27 @@
 
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
 #include <QMatrix4x4>
+#include <QImage>
 #include <QOpenGLDebugLogger>
 #include <QOpenGLDebugMessage>
 
 #include "trackball.h"
+#include "lodcontroller.h"
+#include "gputimer.h"
+#include "adaptivequality.h"
+#include "gradientsource.h"
 #include "algorithm/volumemanager.h"
+#include "algorithm/occupancybuilder.h"
+#include "algorithm/cpuraycaster.h"
+#include "render/glraycaster.h"
 #include "defines.h"
 
-class QOpenGLShaderProgram;
+class QOpenGLFramebufferObject;
+class QTimer;
+
+//Render passes timed on the GPU
+enum GPUPass {GPUPassRaycast, GPUPassUpscale, GPUPassRaycastOnTheFly}; // The last: gradients computed on the fly
 
 class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -56,12 +66,28 @@ public:
 protected slots:
     void update();
     void createVolume(VolumeManager *vm);
+    void addChannel(int channel, VolumeManager *vm, unsigned char *colorBuffer);
     void TF1DChanged(unsigned char * colorBuffer);
     void raycasterStepSizeChanged(float stepSize);
     void raycasterInterpolationTypeChanged(RaycastingInterpolationType type);
     void enableJitteredSampling(bool flag);
+    void enableTemporalAccumulation(bool flag);
+    void enableReprojection(bool flag);
     void on_volumeGradientComputed();
-    void togglePhongShading(bool flag) { m_PerformPhongShading = flag;}
+    void on_occupancyUpdated();
+    void togglePhongShading(bool flag);
+    void enablePreintegration(bool flag);
+    void setContinuousRendering(bool flag);
+    void enableInteractiveLOD(bool flag);
+    void setInteractiveScale(float scale);
+    void on_interactionIdle();
+    void enableAdaptiveQuality(bool flag);
+    void setTargetFrameTime(float ms);
+    void showStatsOverlay(bool flag);
+    void setRenderBackend(RenderBackend backend);
+
+signals:
+    void qualityLevelChanged(int level, float stepSize, float renderScale);
     void messageLogged(const QOpenGLDebugMessage &msg);
 
 protected:
@@ -72,40 +98,48 @@ protected:
 
 private:
     //OpenGL State information
-    QOpenGLVertexArrayObject m_VAO;
-    QOpenGLShaderProgram *m_program;
-    int m_nVertices;
+    GLRaycaster m_raycaster;
+    CPURaycaster m_cpuRaycaster;
+    RenderBackend m_backend;
+    QImage m_cpuImage; // Frame of the CPU raycaster
+    unsigned char *m_normals; // Encoded normals, kept for the CPU raycaster
     int m_screenWidth, m_screenHeight;
-    QVector3D m_volAspect, m_volSpacing;
     TrackBall *m_trackBall;
     VolumeManager *m_volumeManager;
     QOpenGLDebugLogger *m_debugLogger;
+    OccupancyBuilder *m_occupancyBuilder;
 
-    //Uniform variables
-    GLuint m_textureVol;
-    GLuint m_textureTF1D;//1D RGBA texture
-    GLuint m_textureNoise;// Texture of random values
-    GLuint m_textureVolNormals; // Normals for volumetric phong shading
+    //Raycasting state
     QMatrix4x4 m_view, m_projection;
     float m_stepSize;
     RaycastingInterpolationType m_interpolationtype;
     int m_useJittering;
+    bool m_temporalAccumulation; // Average jittered frames while nothing changes (GL backends)
     bool m_PerformPhongShading;
+    bool m_preintegrated;
     QVector3D m_bbox;
-
-    //Address to uniform variables
-    int m_uTexVol, m_uTexTF1D, m_uTexNoise, m_uTexVolNormals;
-    int m_uTime, m_uInterpolationType;
-    int m_uView, m_uProjection;
-    int m_uStepSize;
-    int m_uUseJittering;
-    int m_uBBox;
-    int m_uPerformPhongShading;
+    bool m_continuousRendering; // Re-render on every frame swap (benchmarking)
+    LODController m_lod; // Reduced quality during camera interaction, refined when idle
+    QTimer *m_idleTimer;
+    QOpenGLFramebufferObject *m_lodFBO; // Reduced resolution render target
+    GPUTimer m_gpuTimer;
+    QVector<GPUTimerResult> m_gpuTimings;
+    AdaptiveQualityController m_adaptiveQuality; // Holds the raycasting time within a frame budget
+    GradientSourceController m_gradientSource; // Stored normals or gradients on the fly, by memory and measured cost
+    bool m_showStats;
+    float m_effectiveStepSize; // Step size of the last frame after LOD and adaptive quality
 
     // private helpers
     void printContextInformation();
     void normalizeCoordinates(float &x, float &y);
-    void createCube();
+    void beginInteraction();
+    RaycastParameters raycastParameters(float stepSize, float opacityCorrection) const;
+    void renderVolume(float stepSize, float opacityCorrection);
+    void applyGradientSource();
+    void renderVolumeCPU(float scale, float stepSize, float opacityCorrection, float cost);
+    void processGPUTimings();
+    void drawStatsOverlay();
+    float estimateSamplesPerRay() const;
 };
 
 #endif // GLWIDGET_H
@@ -0,0 +1,104 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "gputimer.h"
+
+#include <QOpenGLTimerQuery>
+
+#define GPU_TIMER_QUERIES 16
+
+GPUTimer::GPUTimer()
+{
+    m_head = m_count = 0;
+    m_active = -1;
+    m_dropped = 0;
+}
+
+GPUTimer::~GPUTimer()
+{
+    destroy();
+}
+
+bool GPUTimer::create()
+{
+    destroy();
+    for(int i=0; i<GPU_TIMER_QUERIES; i++) {
+        QOpenGLTimerQuery *query = new QOpenGLTimerQuery();
+        if(!query->create()) { //No timer query support in this context
+            delete query;
+            destroy();
+            return false;
+        }
+        m_queries.push_back(query);
+    }
+    m_pending.resize(GPU_TIMER_QUERIES);
+    return true;
+}
+
+void GPUTimer::destroy()
+{
+    foreach(QOpenGLTimerQuery *query, m_queries) {
+        query->destroy();
+        delete query;
+    }
+    m_queries.clear();
+    m_head = m_count = 0;
+    m_active = -1;
+}
+
+void GPUTimer::begin(int tag, float userValue)
+{
+    if(m_queries.isEmpty() || m_active >= 0) return;
+    if(m_count == m_queries.size()) { //All queries in flight
+        m_dropped++;
+        return;
+    }
+    m_active = (m_head + m_count) % m_queries.size();
+    m_pending[m_active].m_tag = tag;
+    m_pending[m_active].m_userValue = userValue;
+    m_queries[m_active]->begin();
+}
+
+void GPUTimer::end()
+{
+    if(m_active < 0) return;
+    m_queries[m_active]->end();
+    m_active = -1;
+    m_count++;
+}
+
+int GPUTimer::poll(QVector<GPUTimerResult> &results)
+{
+    int n = 0;
+    //Queries complete in order, so stop at the first one that is not ready yet
+    while(m_count > 0 && m_queries[m_head]->isResultAvailable()) {
+        GPUTimerResult result = m_pending[m_head];
+        result.m_ms = m_queries[m_head]->waitForResult()*1e-6;
+        results.push_back(result);
+        m_head = (m_head + 1) % m_queries.size();
+        m_count--;
+        n++;
+    }
+    return n;
+}
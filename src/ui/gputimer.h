@@ -0,0 +1,62 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <QVector>
+
+class QOpenGLTimerQuery;
+
+struct GPUTimerResult {
+    int m_tag; // Caller defined, e.g., the render pass
+    float m_userValue; // Caller defined value attached in begin()
+    float m_ms; // GPU time elapsed between begin() and end()
+};
+
+// Non-blocking GPU timer built on a ring of GL_TIME_ELAPSED queries. Results are collected with poll() a few
+// frames later, once the GPU has caught up. If the oldest query is still in flight the measurement is skipped
+// rather than stalling the pipeline.
+class GPUTimer
+{
+public:
+    GPUTimer();
+    ~GPUTimer();
+    bool create(); // Requires a current context
+    void destroy();
+    bool isCreated() const { return !m_queries.isEmpty();}
+    void begin(int tag, float userValue = 0.0);
+    void end();
+    int poll(QVector<GPUTimerResult> &results); // Appends available results in submission order
+    int const & dropped() const { return m_dropped;}
+
+private:
+    QVector<QOpenGLTimerQuery*> m_queries;
+    QVector<GPUTimerResult> m_pending;
+    int m_head, m_count; // Ring of in-flight queries: [m_head, m_head + m_count)
+    int m_active; // Query between begin() and end(), -1 if none
+    int m_dropped;
+};
+
+#endif // GPUTIMER_H
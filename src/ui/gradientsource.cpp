@@ -0,0 +1,62 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "gradientsource.h"
+
+#define GRADIENT_MEMORY_SHARE 0.5 // Normals may take at most half of the free video memory
+#define GRADIENT_PROBE_FRAMES 8 // Shaded frames timed with each source before deciding
+#define GRADIENT_ON_THE_FLY_MAX_COST 1.1 // Keep the gradients on the fly if they take at most 10% longer
+
+GradientSourceController::GradientSourceController()
+{
+    reset(0, -1);
+}
+
+void GradientSourceController::reset(long long normalsBytes, long long freeBytes)
+{
+    m_memoryBound = (freeBytes >= 0 && normalsBytes > GRADIENT_MEMORY_SHARE*freeBytes);
+    m_source = m_memoryBound?GradientSourceOnTheFly:GradientSourceStored;
+    m_decided = m_memoryBound;
+    m_totalMs[0] = m_totalMs[1] = 0.0;
+    m_frames[0] = m_frames[1] = 0;
+}
+
+bool GradientSourceController::addFrameTime(GradientSource source, float ms)
+{
+    //Timings arrive a few frames late: drop those of the source probed before
+    if(m_decided || source != m_source) return false;
+    m_totalMs[source] += ms;
+    if(++m_frames[source] < GRADIENT_PROBE_FRAMES) return false;
+
+    if(source == GradientSourceStored) { //Probe the other one
+        m_source = GradientSourceOnTheFly;
+        return true;
+    }
+    m_decided = true;
+    float stored = m_totalMs[GradientSourceStored]/m_frames[GradientSourceStored];
+    float onTheFly = m_totalMs[GradientSourceOnTheFly]/m_frames[GradientSourceOnTheFly];
+    if(onTheFly <= GRADIENT_ON_THE_FLY_MAX_COST*stored) return false;
+    m_source = GradientSourceStored;
+    return true;
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef GRADIENTSOURCE_H
+#define GRADIENTSOURCE_H
+
+enum GradientSource {GradientSourceStored, GradientSourceOnTheFly};
+
+// Picks where the GL raycaster takes its shading gradients from. Normals that would take more than a share of the free
+// video memory are never uploaded: the gradients are computed on the fly. Otherwise a few shaded frames are timed with
+// each source, and the on-the-fly gradients are kept - freeing the normals texture - unless they cost noticeably more.
+// The decision holds until the next reset(), i.e. the next volume.
+class GradientSourceController
+{
+public:
+    GradientSourceController();
+    // Start over for a volume whose normals take normalsBytes, with freeBytes of video memory left (-1: unknown)
+    void reset(long long normalsBytes, long long freeBytes);
+    GradientSource const & source() const { return m_source;}
+    bool memoryBound() const { return m_memoryBound;}
+    // Feed the GPU time of a shaded frame rendered with the given source, normalized to full quality. Returns true if
+    // source() changed.
+    bool addFrameTime(GradientSource source, float ms);
+
+private:
+    GradientSource m_source;
+    bool m_decided, m_memoryBound;
+    float m_totalMs[2]; // Per GradientSource
+    int m_frames[2];
+};
+
+#endif // GRADIENTSOURCE_H
@@ -0,0 +1,80 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "lodcontroller.h"
+
+#include <math.h>
+
+LODController::LODController()
+{
+    m_policy.m_enabled = true;
+    m_policy.m_interactiveScale = 0.5;
+    m_policy.m_interactiveStepFactor = 4.0;
+    m_policy.m_idleTimeoutMs = 150;
+    m_policy.m_refinementSteps = 3;
+    m_mode = RenderModeFull;
+    m_level = 0;
+}
+
+void LODController::beginInteraction()
+{
+    if(!m_policy.m_enabled) return;
+    m_mode = RenderModeInteractive;
+    m_level = 0;
+}
+
+void LODController::idle()
+{
+    if(m_mode != RenderModeInteractive) return;
+    m_mode = RenderModeRefining;
+    m_level = 1;
+    if(m_level >= m_policy.m_refinementSteps) m_mode = RenderModeFull;
+}
+
+bool LODController::advance()
+{
+    if(m_mode != RenderModeRefining) return false;
+    m_level++;
+    if(m_level >= m_policy.m_refinementSteps) m_mode = RenderModeFull;
+    return true;
+}
+
+float LODController::refinement() const
+{
+    if(!m_policy.m_enabled || m_mode == RenderModeFull || m_policy.m_refinementSteps <= 0) return 1.0;
+    return float(m_level)/float(m_policy.m_refinementSteps);
+}
+
+float LODController::renderScale() const
+{
+    //Resolution grows linearly, the step size shrinks geometrically towards the configured one
+    float t = refinement();
+    return m_policy.m_interactiveScale + (1.0 - m_policy.m_interactiveScale)*t;
+}
+
+float LODController::stepFactor() const
+{
+    float t = refinement();
+    return powf(m_policy.m_interactiveStepFactor, 1.0 - t);
+}
@@ -0,0 +1,62 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef LODCONTROLLER_H
+#define LODCONTROLLER_H
+
+// Render modes of the interactive level-of-detail state machine:
+//   Full        -> Interactive : on camera input
+//   Interactive -> Refining    : after the input has been idle for m_idleTimeoutMs
+//   Refining    -> Full        : after m_refinementSteps progressively better frames
+// Any camera input returns to Interactive.
+enum RenderMode {RenderModeFull, RenderModeInteractive, RenderModeRefining};
+
+struct LODPolicy {
+    bool m_enabled;
+    float m_interactiveScale; // Fraction of the viewport resolution raycast during interaction
+    float m_interactiveStepFactor; // Step size multiplier during interaction
+    int m_idleTimeoutMs; // Input idle time before refinement starts
+    int m_refinementSteps; // Frames spent refining from interactive to full quality
+};
+
+class LODController
+{
+public:
+    LODController();
+    LODPolicy& policy() { return m_policy;}
+    RenderMode const & mode() const { return m_mode;}
+    void beginInteraction();
+    void idle();
+    bool advance(); // Call once a frame has been rendered. Returns true if another (refinement) frame is due.
+    float renderScale() const;
+    float stepFactor() const;
+
+private:
+    LODPolicy m_policy;
+    RenderMode m_mode;
+    int m_level; // Refinement level in [0, m_refinementSteps], 0 being the interactive quality
+    float refinement() const;
+};
+
+#endif // LODCONTROLLER_H
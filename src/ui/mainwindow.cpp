@@ -24,6 +24,9 @@
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "algorithm/profiler.h"
+#include "algorithm/camera.h"
+#include "algorithm/transferfunction1d.h"
 
 //Qt includes
 #include <QFileDialog>
@@ -33,13 +36,16 @@ MainWindow::MainWindow(QWidget *parent) :
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    TraceRecorder::instance().setThreadName("GUI");
     //this->setUnifiedTitleAndToolBarOnMac(true);
     m_volumeManager = new VolumeManager();
+    m_nChannels = 0;
     m_1DTFDialog = new Dialog1DTransferFunction(this);
     m_raycastingSettingsDialog = new DialogRaycastingSettings(this);
 
     //Enable/disable actions
     ui->action_Read->setEnabled(true);
+    ui->actionAdd_channel->setEnabled(false);
     ui->action1D_TF->setEnabled(false);
     ui->actionRaycasting_settings->setEnabled(false);
 
@@ -50,17 +56,47 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(m_raycastingSettingsDialog, SIGNAL(stepSizeChanged(float)), ui->centralWidget, SLOT(raycasterStepSizeChanged(float)));
     connect(m_raycastingSettingsDialog, SIGNAL(interpolationTypeChanged(RaycastingInterpolationType)), ui->centralWidget, SLOT(raycasterInterpolationTypeChanged(RaycastingInterpolationType)));
     connect(m_raycastingSettingsDialog, SIGNAL(enableJitteredSampling(bool)), ui->centralWidget, SLOT(enableJitteredSampling(bool)));
+    connect(m_raycastingSettingsDialog, SIGNAL(enableTemporalAccumulation(bool)), ui->centralWidget, SLOT(enableTemporalAccumulation(bool)));
+    connect(m_raycastingSettingsDialog, SIGNAL(enableReprojection(bool)), ui->centralWidget, SLOT(enableReprojection(bool)));
+    connect(m_raycastingSettingsDialog, SIGNAL(enablePreintegration(bool)), ui->centralWidget, SLOT(enablePreintegration(bool)));
     connect(m_raycastingSettingsDialog, SIGNAL(togglePhongShading(bool)), ui->centralWidget, SLOT(togglePhongShading(bool)));
-    connect(m_volumeManager, SIGNAL(volumeDataCreated(VolumeManager *)), this, SLOT(on_volumeReadFinished()));
-    connect(m_volumeManager, SIGNAL(volumeEdgesComputed(VolumeManager*)), this, SLOT(on_volumeEdgesComputed()));
-    connect(m_volumeManager, SIGNAL(volumePreprocessCompleted(VolumeManager*)), this, SLOT(on_volumePreprocessCompleted()));
-    connect(m_volumeManager, SIGNAL(volumeGradientComputed(VolumeManager*)), ui->centralWidget, SLOT(on_volumeGradientComputed()));
+    connect(m_raycastingSettingsDialog, SIGNAL(toggleContinuousRendering(bool)), ui->centralWidget, SLOT(setContinuousRendering(bool)));
+    connect(m_raycastingSettingsDialog, SIGNAL(enableInteractiveLOD(bool)), ui->centralWidget, SLOT(enableInteractiveLOD(bool)));
+    connect(m_raycastingSettingsDialog, SIGNAL(interactiveScaleChanged(float)), ui->centralWidget, SLOT(setInteractiveScale(float)));
+    connect(m_raycastingSettingsDialog, SIGNAL(enableAdaptiveQuality(bool)), ui->centralWidget, SLOT(enableAdaptiveQuality(bool)));
+    connect(m_raycastingSettingsDialog, SIGNAL(targetFrameTimeChanged(float)), ui->centralWidget, SLOT(setTargetFrameTime(float)));
+    connect(m_raycastingSettingsDialog, SIGNAL(renderBackendChanged(RenderBackend)), ui->centralWidget, SLOT(setRenderBackend(RenderBackend)));
+    connect(ui->centralWidget, SIGNAL(qualityLevelChanged(int,float,float)), m_raycastingSettingsDialog, SLOT(showQualityLevel(int,float,float)));
+    connect(ui->actionStatistics_overlay, SIGNAL(toggled(bool)), ui->centralWidget, SLOT(showStatsOverlay(bool)));
+
+    //Volume manager callbacks may come from preprocessing threads: invoke the slots on the GUI thread
+    QObject *glWidget = ui->centralWidget;
+    m_volumeManager->setCallback(VolumeDataCreated, [this](VolumeManager*) {
+        QMetaObject::invokeMethod(this, "on_volumeReadFinished", Qt::AutoConnection);
+    });
+    m_volumeManager->setCallback(VolumeEdgesComputed, [this](VolumeManager*) {
+        QMetaObject::invokeMethod(this, "on_volumeEdgesComputed", Qt::AutoConnection);
+    });
+    m_volumeManager->setCallback(VolumePreprocessCompleted, [this](VolumeManager*) {
+        QMetaObject::invokeMethod(this, "on_volumePreprocessCompleted", Qt::AutoConnection);
+    });
+    m_volumeManager->setCallback(VolumeGradientComputed, [glWidget](VolumeManager*) {
+        QMetaObject::invokeMethod(glWidget, "on_volumeGradientComputed", Qt::AutoConnection);
+    });
 }
 
 MainWindow::~MainWindow()
 {
+#if PROFILING
+    Profiler::instance().printSummary(stderr);
+    //Dump the trace on exit if requested, e.g. BLAZE_TRACE_FILE=trace.json
+    QByteArray traceFile = qgetenv("BLAZE_TRACE_FILE");
+    if(!traceFile.isEmpty())
+        TraceRecorder::instance().writeChromeTrace(traceFile.constData());
+#endif
     delete m_raycastingSettingsDialog;
     delete m_1DTFDialog;
+    for(int i=0; i<m_nChannels; i++) delete m_channelManagers[i];
     delete m_volumeManager;
     delete ui;
 }
@@ -74,6 +110,7 @@ void MainWindow::on_volumeReadFinished()
     emit volumeDataCreated(m_volumeManager);
     ui->action1D_TF->setEnabled(true);
     ui->actionRaycasting_settings->setEnabled(true);
+    ui->actionAdd_channel->setEnabled(true);
 }
 
 void MainWindow::on_volumePreprocessCompleted()
@@ -99,6 +136,38 @@ void MainWindow::on_action_Read_triggered()
     ui->action_Read->setEnabled(false);
 }
 
+void MainWindow::on_actionAdd_channel_triggered()
+{
+    QString filename = QFileDialog::getOpenFileName(this, "Open a channel volume", QCoreApplication::applicationDirPath(),
+                                                    tr("NRRD (*.nhdr *.nrrd)"));
+    if(filename.isEmpty() || filename.isNull())
+        return;
+    //Without a TF of its own, the channel gets an alpha ramp in a color of its own
+    int channel = m_nChannels + 1;
+    TransferFunction1D tf = TransferFunction1D::channelDefault(channel);
+    QString tfFilename = QFileDialog::getOpenFileName(this, "Open the channel's transfer function (cancel for a default)",
+                                                      QFileInfo(filename).absolutePath(), tr("Transfer function (*.tf1)"));
+    if(!tfFilename.isEmpty() && !tf.load(tfFilename.toStdString().c_str()))
+        return;
+
+    VolumeManager *vm = new VolumeManager();
+    fprintf(stderr, "Reading channel %s from disk...\n", filename.toStdString().c_str());
+    vm->readNHDR(filename.toStdString().c_str());
+    VolumeManager *volume = m_volumeManager;
+    if(!vm->data() || vm->width() <= 0 ||
+            !sameProportions(Vec3(volume->width()*volume->spacingX(), volume->height()*volume->spacingY(), volume->depth()*volume->spacingZ()),
+                             Vec3(vm->width()*vm->spacingX(), vm->height()*vm->spacingY(), vm->depth()*vm->spacingZ()))) {
+        QMessageBox::warning(this, tr("Add channel"), tr("Could not read the channel, or it does not span the volume's extent."));
+        delete vm;
+        return;
+    }
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    tf.bake(colorBuffer);
+    m_channelManagers[m_nChannels++] = vm;
+    emit channelDataCreated(channel, vm, colorBuffer);
+    ui->actionAdd_channel->setEnabled(m_nChannels < VOLUME_MAX_CHANNELS - 1);
+}
+
 bool MainWindow::readVolume(QString filename)
 {
     //Before  reading a new volume file, clear old contents of the process dir.
@@ -178,6 +247,17 @@ void MainWindow::on_actionSave_screenshot_triggered()
     img.save(filename);
 }
 
+void MainWindow::on_actionExport_trace_triggered()
+{
+    QString filename = QFileDialog::getSaveFileName(this,
+                                            tr("Export trace"), QCoreApplication::applicationDirPath(),
+                                            tr("Chrome trace (*.json)"), 0, QFileDialog::DontUseNativeDialog);
+    if(filename.isEmpty() || filename.isNull())
+        return;
+
+    TraceRecorder::instance().writeChromeTrace(filename.toStdString().c_str());
+}
+
 void MainWindow::on_actionAbout_triggered()
 {
     QMessageBox::about(this, tr("About BlazeRenderer"),
@@ -53,9 +53,11 @@ signals:
     void volumeGradientComputed(VolumeManager *vm);
     void volumeEdgesComputed(VolumeManager *vm);
     void volumePreprocessCompleted(VolumeManager *vm);
+    void channelDataCreated(int channel, VolumeManager *vm, unsigned char *colorBuffer);
 
 private slots:
     void on_action_Read_triggered();
+    void on_actionAdd_channel_triggered();
     void on_action_Quit_triggered();
     void on_action1D_TF_toggled(bool arg1);
     void on_actionRaycasting_settings_toggled(bool arg1);
@@ -66,10 +68,13 @@ private slots:
     void on_volumeEdgesComputed();
     void on_volumePreprocessCompleted();
     void on_actionSave_screenshot_triggered();
+    void on_actionExport_trace_triggered();
 
 private:
     Ui::MainWindow *ui;
     VolumeManager *m_volumeManager;
+    VolumeManager *m_channelManagers[VOLUME_MAX_CHANNELS - 1]; // Channels 1.., read after the volume
+    int m_nChannels;
     Dialog1DTransferFunction *m_1DTFDialog;
     DialogRaycastingSettings *m_raycastingSettingsDialog;  
 };
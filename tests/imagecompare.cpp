@@ -0,0 +1,98 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#include "imagecompare.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SSIM_WINDOW 8
+#define SSIM_STRIDE 4
+
+double imagePSNR(const unsigned char *a, const unsigned char *b, int width, int height)
+{
+    double error = 0.0;
+    long n = (long)width*height;
+    for(long i=0; i<n; i++)
+        for(int c=0; c<3; c++) {
+            double d = a[4*i + c] - b[4*i + c];
+            error += d*d;
+        }
+    error /= 3.0*n;
+    if(error == 0.0) return 100.0;
+    return 10.0*log10(255.0*255.0/error);
+}
+
+static void luma(const unsigned char *rgba, long n, std::vector<double> &y)
+{
+    y.resize(n);
+    for(long i=0; i<n; i++)
+        y[i] = 0.299*rgba[4*i] + 0.587*rgba[4*i + 1] + 0.114*rgba[4*i + 2];
+}
+
+double imageSSIM(const unsigned char *a, const unsigned char *b, int width, int height)
+{
+    const double c1 = (0.01*255)*(0.01*255), c2 = (0.03*255)*(0.03*255);
+    std::vector<double> ya, yb;
+    luma(a, (long)width*height, ya);
+    luma(b, (long)width*height, yb);
+
+    double sum = 0.0;
+    int windows = 0;
+    const int n = SSIM_WINDOW*SSIM_WINDOW;
+    for(int y0=0; y0 + SSIM_WINDOW <= height; y0 += SSIM_STRIDE)
+        for(int x0=0; x0 + SSIM_WINDOW <= width; x0 += SSIM_STRIDE) {
+            double ma = 0, mb = 0, vaa = 0, vbb = 0, vab = 0;
+            for(int y=y0; y<y0 + SSIM_WINDOW; y++)
+                for(int x=x0; x<x0 + SSIM_WINDOW; x++) {
+                    double pa = ya[(long)y*width + x], pb = yb[(long)y*width + x];
+                    ma += pa;
+                    mb += pb;
+                    vaa += pa*pa;
+                    vbb += pb*pb;
+                    vab += pa*pb;
+                }
+            ma /= n;
+            mb /= n;
+            vaa = vaa/n - ma*ma;
+            vbb = vbb/n - mb*mb;
+            vab = vab/n - ma*mb;
+            sum += ((2*ma*mb + c1)*(2*vab + c2))/((ma*ma + mb*mb + c1)*(vaa + vbb + c2));
+            windows++;
+        }
+    return windows?sum/windows:1.0;
+}
+
+int imageMaxDifference(const unsigned char *a, const unsigned char *b, int width, int height)
+{
+    int maxDiff = 0;
+    long n = (long)width*height;
+    for(long i=0; i<n; i++)
+        for(int c=0; c<3; c++) {
+            int d = abs(a[4*i + c] - b[4*i + c]);
+            if(d > maxDiff) maxDiff = d;
+        }
+    return maxDiff;
+}
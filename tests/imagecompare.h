@@ -0,0 +1,38 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+#ifndef IMAGECOMPARE_H
+#define IMAGECOMPARE_H
+
+// Image similarity for the regression tests. Both images are width x height RGBA8; alpha is ignored since the
+// renderers composite over an opaque white background.
+
+//Peak signal to noise ratio over the RGB channels in dB; 100 for identical images
+double imagePSNR(const unsigned char *a, const unsigned char *b, int width, int height);
+//Mean structural similarity of the luma, over 8x8 windows with a stride of 4 (Wang et al. 2004 constants)
+double imageSSIM(const unsigned char *a, const unsigned char *b, int width, int height);
+//Largest absolute difference of any RGB channel
+int imageMaxDifference(const unsigned char *a, const unsigned char *b, int width, int height);
+
+#endif // IMAGECOMPARE_H
@@ -0,0 +1,912 @@
+/***************************************************************************
+**                                                                        **
+**  BlazeRenderer - An OpenGL based real-time volume renderer             **
+**  Copyright (C) 2016-2018 Graphics Research Group, IIIT Delhi           **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see http://www.gnu.org/licenses/.   **
+**                                                                        **
+****************************************************************************
+**           Author: Ojaswa Sharma                                        **
+**           E-mail: ojaswa@iiitd.ac.in                                   **
+**           Date  : 14.12.2016                                           **
+****************************************************************************/
+
+// Image regression and timing of the raycasters. The bundled engine and tooth volumes are rendered with fixed transfer
+// functions and cameras by the GL raycaster (in a Mesa software context, so results do not depend on the GPU) and by
+// the CPU raycaster, and compared with the golden images in tests/golden.
+//
+// Every run appends the median frame time of each case to regression-timings.csv in the build directory, tagged with
+// the build (git revision and build type), so speedups and regressions can be followed across builds. Renders that
+// fail their golden are written there as well, as <case>-<backend>.png.
+//
+// Set BLAZE_UPDATE_GOLDENS=1 to rewrite the goldens from the GL renders after an intended change of the images.
+
+#include <gtest/gtest.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QImage>
+#include <QThread>
+
+#include "headless/offscreencontext.h"
+#include "render/glheaders.h"
+#include "render/glraycaster.h"
+#include "algorithm/cpuraycaster.h"
+#include "algorithm/volumemanager.h"
+#include "algorithm/transferfunction1d.h"
+#include "algorithm/preintegratedtf.h"
+#include "algorithm/bluenoise.h"
+#include "algorithm/normals.h"
+#include "algorithm/occupancybuilder.h"
+#include "algorithm/volumegenerator.h"
+#include "imagecompare.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef BLAZE_SOURCE_DIR
+#define BLAZE_SOURCE_DIR "."
+#endif
+#ifndef BLAZE_BUILD_ID
+#define BLAZE_BUILD_ID "unknown"
+#endif
+#ifndef BLAZE_BINARY_DIR
+#define BLAZE_BINARY_DIR "."
+#endif
+
+#define REGRESSION_IMAGE_SIZE 256
+#define REGRESSION_TIMED_FRAMES 5
+#define REGRESSION_MIN_PSNR 40.0 // dB
+#define REGRESSION_MIN_SSIM 0.98
+#define REGRESSION_TIMING_LOG BLAZE_BINARY_DIR "/regression-timings.csv"
+
+struct RegressionCase {
+    const char *m_name;
+    const char *m_volume; // Relative to data/
+    float m_azimuth, m_elevation;
+    void (*m_transferFunction)(TransferFunction1D &tf);
+};
+
+static void engineTransferFunction(TransferFunction1D &tf)
+{
+    tf.clear();
+    tf.addAlphaNode(0.0, 0.0);
+    tf.addAlphaNode(0.3, 0.0);
+    tf.addAlphaNode(0.5, 0.05);
+    tf.addAlphaNode(1.0, 0.8);
+    tf.addColorNode(0.0, 0, 0, 255);
+    tf.addColorNode(1.0, 255, 128, 0);
+}
+
+static void toothTransferFunction(TransferFunction1D &tf)
+{
+    tf.clear();
+    tf.addAlphaNode(0.0, 0.0);
+    tf.addAlphaNode(0.38, 0.0);
+    tf.addAlphaNode(0.5, 0.15);
+    tf.addAlphaNode(0.8, 0.9);
+    tf.addAlphaNode(1.0, 1.0);
+    tf.addColorNode(0.0, 200, 60, 40);
+    tf.addColorNode(0.4, 240, 200, 150);
+    tf.addColorNode(1.0, 255, 255, 255);
+}
+
+static const RegressionCase regressionCases[] = {
+    {"engine", "engine.nhdr", 30.0, 20.0, engineTransferFunction},
+    {"tooth", "tooth.nhdr", -40.0, 10.0, toothTransferFunction}
+};
+
+//Volumes are loaded once for all tests
+static VolumeManager* loadVolume(const char *file)
+{
+    static std::map<std::string, VolumeManager*> volumes;
+    VolumeManager *&volume = volumes[file];
+    if(!volume) {
+        volume = new VolumeManager();
+        volume->readNHDR((std::string(BLAZE_SOURCE_DIR "/data/") + file).c_str());
+    }
+    return volume->data()?volume:NULL;
+}
+
+static QByteArray readShader(const char *name)
+{
+    QFile file(QString(BLAZE_SOURCE_DIR "/shaders/") + name);
+    if(!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Could not read shader: %s\n", name);
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+static const char* renderBackendName(RenderBackend backend)
+{
+    switch(backend) {
+    case RenderBackendCPU: return "cpu";
+    case RenderBackendGLCompute: return "glcompute";
+    default: return "gl";
+    }
+}
+
+static void appendTiming(const char *name, const char *backend, const char *renderer, double ms, double psnr)
+{
+    FILE *fid = fopen(REGRESSION_TIMING_LOG, "a");
+    if(!fid) return;
+    fseek(fid, 0, SEEK_END);
+    if(ftell(fid) == 0) fprintf(fid, "time,build,case,backend,renderer,median_ms,psnr_db\n");
+    fprintf(fid, "%ld,%s,%s,%s,\"%s\",%.3f,%.2f\n", (long)time(NULL), BLAZE_BUILD_ID, name, backend, renderer, ms, psnr);
+    fclose(fid);
+}
+
+class RenderRegression : public ::testing::TestWithParam< ::testing::tuple<int, RenderBackend> >
+{
+protected:
+    RegressionCase const &regressionCase() const { return regressionCases[::testing::get<0>(GetParam())];}
+    RenderBackend backend() const { return ::testing::get<1>(GetParam());}
+
+    //Renders one frame untimed, then REGRESSION_TIMED_FRAMES timed ones; returns the median time
+    template<typename RenderFunction> double timeFrames(RenderFunction render) {
+        render();
+        std::vector<double> ms;
+        for(int i=0; i<REGRESSION_TIMED_FRAMES; i++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            render();
+            ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(ms.begin(), ms.end());
+        return ms[ms.size()/2];
+    }
+};
+
+TEST_P(RenderRegression, MatchesGolden)
+{
+    RegressionCase const &rc = regressionCase();
+    VolumeManager *volume = loadVolume(rc.m_volume);
+    ASSERT_TRUE(volume != NULL) << "Could not load " << rc.m_volume;
+
+    TransferFunction1D tf;
+    rc.m_transferFunction(tf);
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    tf.bake(colorBuffer);
+
+    //Shading is left off: the normals come from ITK's smoothed gradient, which is not bit-stable across ITK versions
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    Camera camera;
+    camera.m_azimuth = rc.m_azimuth;
+    camera.m_elevation = rc.m_elevation;
+    const int size = REGRESSION_IMAGE_SIZE;
+    Mat4 view = camera.viewMatrix(), projection = camera.projectionMatrix(1.0);
+    QImage image(size, size, QImage::Format_RGBA8888);
+    std::string renderer;
+    double ms;
+
+    if(backend() != RenderBackendCPU) {
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+        OffscreenContext context;
+        if(!context.create(size, size)) GTEST_SKIP() << "No EGL context available";
+        renderer = context.renderer();
+        GLRaycaster raycaster;
+        raycaster.setUseCompute(backend() == RenderBackendGLCompute);
+        ASSERT_TRUE(raycaster.create(readShader("cube.vs").constData(), readShader("cube.fs").constData()));
+        if(backend() == RenderBackendGLCompute && !raycaster.usesCompute()) GTEST_SKIP() << "No OpenGL 4.3 context";
+        raycaster.setVolume(volume->width(), volume->height(), volume->depth(), volume->data(),
+                            volume->spacingX(), volume->spacingY(), volume->spacingZ());
+        raycaster.setTransferFunction(colorBuffer);
+        ms = timeFrames([&]() {
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            raycaster.render(view, projection, params);
+            context.readPixels(image.bits()); //Waits for the frame
+        });
+        raycaster.destroy();
+        context.destroy();
+    } else {
+        CPURaycaster raycaster;
+        raycaster.setVolume(volume->width(), volume->height(), volume->depth(), volume->data(),
+                            volume->spacingX(), volume->spacingY(), volume->spacingZ());
+        raycaster.setTransferFunction(colorBuffer);
+        renderer = raycaster.usesSIMD()?"CPU AVX2":"CPU scalar";
+        ms = timeFrames([&]() {
+            raycaster.render(view, projection, params, size, size, image.bits());
+        });
+    }
+
+    QString golden = QString(BLAZE_SOURCE_DIR "/tests/golden/") + rc.m_name + ".png";
+    if(getenv("BLAZE_UPDATE_GOLDENS") && backend() == RenderBackendGL) {
+        ASSERT_TRUE(image.save(golden, "PNG"));
+        fprintf(stderr, "Updated %s\n", golden.toStdString().c_str());
+    }
+    QImage expected = QImage(golden).convertToFormat(QImage::Format_RGBA8888);
+    ASSERT_FALSE(expected.isNull()) << "Missing golden image " << golden.toStdString();
+    ASSERT_EQ(expected.width(), size);
+    ASSERT_EQ(expected.height(), size);
+
+    double psnr = imagePSNR(image.constBits(), expected.constBits(), size, size);
+    double ssim = imageSSIM(image.constBits(), expected.constBits(), size, size);
+    int maxDiff = imageMaxDifference(image.constBits(), expected.constBits(), size, size);
+    const char *backendName = renderBackendName(backend());
+    RecordProperty("median_ms", QString::number(ms, 'f', 3).toStdString());
+    RecordProperty("psnr_db", QString::number(psnr, 'f', 2).toStdString());
+    RecordProperty("ssim", QString::number(ssim, 'f', 4).toStdString());
+    appendTiming(rc.m_name, backendName, renderer.c_str(), ms, psnr);
+    fprintf(stderr, "%s/%s (%s): %.2f ms, PSNR %.2f dB, SSIM %.4f, max difference %d\n",
+            rc.m_name, backendName, renderer.c_str(), ms, psnr, ssim, maxDiff);
+
+    EXPECT_GE(psnr, REGRESSION_MIN_PSNR);
+    EXPECT_GE(ssim, REGRESSION_MIN_SSIM);
+    if(HasFailure()) {
+        QString actual = QString(BLAZE_BINARY_DIR "/%1-%2.png").arg(rc.m_name).arg(backendName);
+        image.save(actual, "PNG");
+        fprintf(stderr, "Wrote the failing render to %s\n", actual.toStdString().c_str());
+    }
+}
+
+static std::string caseName(::testing::TestParamInfo< ::testing::tuple<int, RenderBackend> > const &info)
+{
+    return std::string(regressionCases[::testing::get<0>(info.param)].m_name) + "_" +
+            renderBackendName(::testing::get<1>(info.param));
+}
+
+INSTANTIATE_TEST_SUITE_P(Volumes, RenderRegression,
+                         ::testing::Combine(::testing::Range(0, (int)(sizeof(regressionCases)/sizeof(regressionCases[0]))),
+                                            ::testing::Values(RenderBackendGL, RenderBackendCPU, RenderBackendGLCompute)),
+                         caseName);
+
+//Software GL context with a raycaster holding the first regression volume and its TF, for the tests comparing GL
+//renders with each other or with the CPU raycaster. Skipped without EGL.
+class GLRegression : public ::testing::Test
+{
+protected:
+    GLRegression() : m_case(regressionCases[0]), m_volume(NULL), m_size(REGRESSION_IMAGE_SIZE), m_hasContext(false) {}
+
+    void SetUp() {
+        m_volume = loadVolume(m_case.m_volume);
+        ASSERT_TRUE(m_volume != NULL) << "Could not load " << m_case.m_volume;
+        TransferFunction1D tf;
+        m_case.m_transferFunction(tf);
+        tf.bake(m_colorBuffer);
+        m_camera.m_azimuth = m_case.m_azimuth;
+        m_camera.m_elevation = m_case.m_elevation;
+
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+        m_hasContext = m_context.create(m_size, m_size);
+        if(!m_hasContext) GTEST_SKIP() << "No EGL context available";
+        ASSERT_TRUE(m_raycaster.create(readShader("cube.vs").constData(), readShader("cube.fs").constData()));
+        m_raycaster.setVolume(m_volume->width(), m_volume->height(), m_volume->depth(), m_volume->data(),
+                              m_volume->spacingX(), m_volume->spacingY(), m_volume->spacingZ());
+        m_raycaster.setTransferFunction(m_colorBuffer);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+
+    void TearDown() {
+        if(!m_hasContext) return;
+        m_raycaster.destroy();
+        m_context.destroy();
+    }
+
+    //Renders a frame on white; pixels, if given, receive it as RGBA
+    void renderGL(Mat4 const &view, Mat4 const &projection, RaycastParameters const &params, unsigned char *pixels) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_raycaster.render(view, projection, params);
+        if(pixels) m_context.readPixels(pixels);
+    }
+
+    //The CPU raycaster on the same volume and TF
+    void setUpCPU(CPURaycaster &cpu) {
+        cpu.setVolume(m_volume->width(), m_volume->height(), m_volume->depth(), m_volume->data(),
+                      m_volume->spacingX(), m_volume->spacingY(), m_volume->spacingZ());
+        cpu.setTransferFunction(m_colorBuffer);
+    }
+
+    //Renders with the CPU raycaster, scalar and with AVX2 where it is used, and expects both to match the GL reference
+    void expectCPUMatches(CPURaycaster &cpu, Mat4 const &view, Mat4 const &projection, RaycastParameters const &params,
+                          QImage const &reference, const char *label) {
+        for(int simd=0; simd<2; simd++) {
+            cpu.setUseSIMD(simd == 1);
+            if(simd == 1 && !cpu.usesSIMD()) continue;
+            const char *kernel = simd?"AVX2":"scalar";
+            QImage image(m_size, m_size, QImage::Format_RGBA8888);
+            cpu.render(view, projection, params, m_size, m_size, image.bits());
+            double psnr = imagePSNR(image.constBits(), reference.constBits(), m_size, m_size);
+            fprintf(stderr, "%s: %s vs gl PSNR %.2f dB\n", label, kernel, psnr);
+            EXPECT_GE(psnr, REGRESSION_MIN_PSNR) << label << ", " << kernel;
+            EXPECT_GE(imageSSIM(image.constBits(), reference.constBits(), m_size, m_size), REGRESSION_MIN_SSIM)
+                    << label << ", " << kernel;
+        }
+    }
+
+    RegressionCase const &m_case;
+    VolumeManager *m_volume;
+    unsigned char m_colorBuffer[TF1D_SIZE*4];
+    Camera m_camera;
+    const int m_size;
+    OffscreenContext m_context;
+    GLRaycaster m_raycaster;
+    bool m_hasContext;
+};
+
+typedef GLRegression InterpolationRegression;
+typedef GLRegression RaySetupRegression;
+typedef GLRegression ShadingRegression;
+typedef GLRegression PreintegrationRegression;
+typedef GLRegression TemporalAccumulationRegression;
+typedef GLRegression ReprojectionRegression;
+typedef GLRegression ChannelRegression;
+typedef GLRegression ProgramCacheRegression;
+
+//The tricubic kernels have no golden image of their own: the CPU raycaster (scalar and AVX2) has to match the GL one
+TEST_F(InterpolationRegression, TricubicBackendsAgree)
+{
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    m_camera.m_distance *= 0.5; //Zoomed in, where the kernels differ most
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+
+    QImage gl(size, size, QImage::Format_RGBA8888), trilinear(size, size, QImage::Format_RGBA8888);
+    renderGL(view, projection, params, trilinear.bits());
+    m_raycaster.setInterpolationType(Interpolationcubic);
+    renderGL(view, projection, params, gl.bits());
+    EXPECT_LT(imagePSNR(gl.constBits(), trilinear.constBits(), size, size), 60.0) << "Tricubic render equals trilinear";
+
+    CPURaycaster cpu;
+    setUpCPU(cpu);
+    cpu.setInterpolationType(Interpolationcubic);
+    expectCPUMatches(cpu, view, projection, params, gl, "tricubic");
+}
+
+//With the camera inside the volume the rays start at the eye; both raycasters have to render it, and alike
+TEST_F(RaySetupRegression, CameraInsideBackendsAgree)
+{
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    m_camera.m_distance = 0.1;
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+
+    QImage gl(size, size, QImage::Format_RGBA8888), cpu(size, size, QImage::Format_RGBA8888);
+    renderGL(view, projection, params, gl.bits());
+    CPURaycaster cpuRaycaster;
+    setUpCPU(cpuRaycaster);
+    cpuRaycaster.render(view, projection, params, size, size, cpu.bits());
+
+    int covered = 0;
+    for(int i=0; i<size*size; i++) covered += (gl.constBits()[4*i] != 255 || gl.constBits()[4*i + 2] != 255);
+    double psnr = imagePSNR(cpu.constBits(), gl.constBits(), size, size);
+    fprintf(stderr, "camera inside: %d pixels covered, cpu vs gl PSNR %.2f dB\n", covered, psnr);
+    EXPECT_GT(covered, size*size/4);
+    EXPECT_GE(psnr, REGRESSION_MIN_PSNR);
+    EXPECT_GE(imageSSIM(cpu.constBits(), gl.constBits(), size, size), REGRESSION_MIN_SSIM);
+}
+
+//Central differences of the normalized scalars, (gx, gy, gz) per voxel as VolumeManager::gradient() stores them.
+//ITK's smoothed gradient is not bit-stable across versions, so the shading tests use this instead
+static std::vector<float> centralDifferences(VolumeManager *volume)
+{
+    int w = volume->width(), h = volume->height(), d = volume->depth();
+    const float *data = volume->data();
+    std::vector<float> gradient(3L*w*h*d);
+    for(int z=0; z<d; z++)
+        for(int y=0; y<h; y++)
+            for(int x=0; x<w; x++) {
+                long i = x + (long)w*(y + (long)h*z);
+                gradient[3*i] = data[std::min(x + 1, w - 1) + (long)w*(y + (long)h*z)] - data[std::max(x - 1, 0) + (long)w*(y + (long)h*z)];
+                gradient[3*i+1] = data[x + (long)w*(std::min(y + 1, h - 1) + (long)h*z)] - data[x + (long)w*(std::max(y - 1, 0) + (long)h*z)];
+                gradient[3*i+2] = data[x + (long)w*(y + (long)h*std::min(z + 1, d - 1))] - data[x + (long)w*(y + (long)h*std::max(z - 1, 0))];
+            }
+    return gradient;
+}
+
+//The normals carry unit vectors and the relative gradient magnitude; shading and gradient modulated opacity have to
+//look alike in both raycasters, and the modulation has to change the image
+TEST_F(ShadingRegression, GradientMagnitudeBackendsAgree)
+{
+    VolumeManager *volume = m_volume;
+    long nelem = (long)volume->width()*volume->height()*volume->depth();
+    std::vector<float> gradient = centralDifferences(volume);
+    std::vector<unsigned char> normals(4*nelem);
+    encodeNormals(gradient.data(), nelem, normals.data());
+    int maxMagnitude = 0;
+    double worstLength = 0.0;
+    for(long i=0; i<nelem; i++) {
+        maxMagnitude = std::max(maxMagnitude, (int)normals[4*i+3]);
+        if(normals[4*i+3] < 26) continue; //Shaded from SHADING_MIN_GRADIENT on
+        double n[3];
+        for(int c=0; c<3; c++) n[c] = normals[4*i+c]*2.0/255.0 - 1.0;
+        worstLength = std::max(worstLength, fabs(sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]) - 1.0));
+    }
+    EXPECT_EQ(maxMagnitude, 255);
+    EXPECT_LT(worstLength, 0.02);
+
+    RaycastParameters params;
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+
+    QImage shaded(size, size, QImage::Format_RGBA8888), gl(size, size, QImage::Format_RGBA8888);
+    m_raycaster.setNormals(normals.data());
+    renderGL(view, projection, params, shaded.bits());
+    params.m_gradientOpacity = 0.8;
+    renderGL(view, projection, params, gl.bits());
+    double modulated = imagePSNR(gl.constBits(), shaded.constBits(), size, size);
+    EXPECT_LT(modulated, 40.0) << "Gradient modulated opacity has no effect";
+
+    CPURaycaster cpu;
+    setUpCPU(cpu);
+    cpu.setNormals(normals.data());
+    fprintf(stderr, "gradient opacity: %.2f dB from plain shading\n", modulated);
+    expectCPUMatches(cpu, view, projection, params, gl, "gradient opacity");
+}
+
+//Gradients computed on the fly are the interpolated central differences; shading with them has to match shading with
+//the stored central differences. Those are interpolated as unit normals, which weighs weak gradients more, hence the
+//lower PSNR bound
+#define ON_THE_FLY_MIN_PSNR 35.0 // dB
+TEST_F(ShadingRegression, OnTheFlyGradientsMatchStored)
+{
+    VolumeManager *volume = m_volume;
+    long nelem = (long)volume->width()*volume->height()*volume->depth();
+    std::vector<float> gradient = centralDifferences(volume);
+    std::vector<unsigned char> normals(4*nelem);
+    encodeNormals(gradient.data(), nelem, normals.data());
+
+    RaycastParameters params;
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+
+    QImage stored(size, size, QImage::Format_RGBA8888), onTheFly(size, size, QImage::Format_RGBA8888);
+    QImage unshaded(size, size, QImage::Format_RGBA8888);
+    renderGL(view, projection, params, unshaded.bits()); //No normals yet
+    m_raycaster.setNormals(normals.data());
+    renderGL(view, projection, params, stored.bits());
+    m_raycaster.setOnTheFlyGradients(true);
+    renderGL(view, projection, params, onTheFly.bits());
+
+    double psnr = imagePSNR(onTheFly.constBits(), stored.constBits(), size, size);
+    double shading = imagePSNR(unshaded.constBits(), stored.constBits(), size, size);
+    fprintf(stderr, "on the fly vs stored gradients: PSNR %.2f dB (unshaded: %.2f dB)\n", psnr, shading);
+    EXPECT_GE(psnr, ON_THE_FLY_MIN_PSNR);
+    EXPECT_GE(imageSSIM(onTheFly.constBits(), stored.constBits(), size, size), REGRESSION_MIN_SSIM);
+    EXPECT_LT(shading, psnr - 6.0) << "Shading has no visible effect";
+}
+
+//A thin iso-layer: the TF feature that point sampling slices through at coarse steps
+static void layerTransferFunction(TransferFunction1D &tf)
+{
+    tf.clear();
+    tf.addAlphaNode(0.0, 0.0);
+    tf.addAlphaNode(0.58, 0.0);
+    tf.addAlphaNode(0.6, 0.6);
+    tf.addAlphaNode(0.62, 0.0);
+    tf.addAlphaNode(1.0, 0.0);
+    tf.addColorNode(0.0, 0, 0, 255);
+    tf.addColorNode(1.0, 255, 128, 0);
+}
+
+//At twice the step size, pre-integration has to get closer to a finely sampled render than point sampling, and the GL
+//and CPU raycasters have to agree on it
+TEST_F(PreintegrationRegression, CoarseStepCloserToReference)
+{
+    TransferFunction1D tf;
+    layerTransferFunction(tf);
+    tf.bake(m_colorBuffer);
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+    CPURaycaster cpu;
+    setUpCPU(cpu);
+    m_raycaster.setTransferFunction(m_colorBuffer);
+
+    //A fraction of a voxel of the engine, the range pre-integration is meant for
+    const float stepSize = 0.002;
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    QImage reference(size, size, QImage::Format_RGBA8888), point(size, size, QImage::Format_RGBA8888);
+    QImage preintegrated(size, size, QImage::Format_RGBA8888);
+    params.m_stepSize = stepSize/8;
+    params.m_opacityCorrection = 1.0/8;
+    cpu.render(view, projection, params, size, size, reference.bits());
+    params.m_stepSize = stepSize*2;
+    params.m_opacityCorrection = 2.0;
+    cpu.render(view, projection, params, size, size, point.bits());
+    params.m_preintegrated = true;
+    cpu.render(view, projection, params, size, size, preintegrated.bits());
+
+    double pointPSNR = imagePSNR(point.constBits(), reference.constBits(), size, size);
+    double preintegratedPSNR = imagePSNR(preintegrated.constBits(), reference.constBits(), size, size);
+    fprintf(stderr, "2x step vs 1/8 step: point sampling %.2f dB, pre-integrated %.2f dB\n", pointPSNR, preintegratedPSNR);
+    EXPECT_GT(preintegratedPSNR, pointPSNR + 2.0);
+
+    QImage gl(size, size, QImage::Format_RGBA8888);
+    renderGL(view, projection, params, gl.bits());
+    double psnr = imagePSNR(preintegrated.constBits(), gl.constBits(), size, size);
+    fprintf(stderr, "pre-integrated cpu vs gl: PSNR %.2f dB\n", psnr);
+    EXPECT_GE(psnr, REGRESSION_MIN_PSNR);
+    EXPECT_GE(imageSSIM(preintegrated.constBits(), gl.constBits(), size, size), REGRESSION_MIN_SSIM);
+}
+
+//A TF edit recomputes only part of the pre-integrated table; the result has to equal a full rebuild
+TEST(PreintegratedTableRegression, IncrementalUpdateMatchesRebuild)
+{
+    TransferFunction1D tf;
+    engineTransferFunction(tf);
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    tf.bake(colorBuffer);
+    PreintegratedTF incremental;
+    ASSERT_TRUE(incremental.update(colorBuffer));
+    EXPECT_EQ(incremental.lastUpdatedEntries(), TF1D_SIZE*TF1D_SIZE);
+    EXPECT_FALSE(incremental.update(colorBuffer));
+
+    for(int i=100; i<110; i++) colorBuffer[4*i + 3] = 200;
+    ASSERT_TRUE(incremental.update(colorBuffer));
+    EXPECT_LT(incremental.lastUpdatedEntries(), TF1D_SIZE*TF1D_SIZE);
+    PreintegratedTF rebuilt;
+    rebuilt.update(colorBuffer);
+    double maxDiff = 0.0;
+    for(int i=0; i<4*TF1D_SIZE*TF1D_SIZE; i++)
+        maxDiff = std::max(maxDiff, (double)fabs(incremental.table()[i] - rebuilt.table()[i]));
+    EXPECT_LT(maxDiff, 1e-5);
+}
+
+//Averaging jittered frames of a still view has to come closer to a finely sampled image than any single frame, and
+//a view change has to start the average over. Both raycasters jitter alike.
+TEST_F(TemporalAccumulationRegression, ConvergesTowardsReference)
+{
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    QImage reference(size, size, QImage::Format_RGBA8888), single(size, size, QImage::Format_RGBA8888);
+    QImage accumulated(size, size, QImage::Format_RGBA8888);
+
+    params.m_stepSize = 0.001;
+    params.m_opacityCorrection = 0.1;
+    renderGL(view, projection, params, reference.bits());
+
+    params.m_stepSize = 0.01;
+    params.m_opacityCorrection = 1.0;
+    params.m_useJittering = true;
+    renderGL(view, projection, params, single.bits());
+    CPURaycaster cpu; //Same noise and phase for the first jittered frame
+    setUpCPU(cpu);
+    QImage cpuSingle(size, size, QImage::Format_RGBA8888);
+    cpu.render(view, projection, params, size, size, cpuSingle.bits());
+
+    m_raycaster.setAccumulation(true);
+    for(int i=0; i<ACCUMULATION_MAX_FRAMES + 4; i++)
+        renderGL(view, projection, params, NULL);
+    m_context.readPixels(accumulated.bits());
+    EXPECT_TRUE(m_raycaster.accumulationConverged());
+    EXPECT_EQ(m_raycaster.accumulatedFrames(), ACCUMULATION_MAX_FRAMES);
+
+    m_camera.m_azimuth += 1.0;
+    renderGL(m_camera.viewMatrix(), projection, params, NULL);
+    EXPECT_EQ(m_raycaster.accumulatedFrames(), 1);
+
+    double singlePSNR = imagePSNR(single.constBits(), reference.constBits(), size, size);
+    double accumulatedPSNR = imagePSNR(accumulated.constBits(), reference.constBits(), size, size);
+    fprintf(stderr, "jittered vs 1/10 step: single frame %.2f dB, %d frames %.2f dB\n", singlePSNR,
+            ACCUMULATION_MAX_FRAMES, accumulatedPSNR);
+    EXPECT_GT(accumulatedPSNR, singlePSNR + 6.0);
+    double cpuPSNR = imagePSNR(cpuSingle.constBits(), single.constBits(), size, size);
+    fprintf(stderr, "jittered cpu vs gl: PSNR %.2f dB\n", cpuPSNR);
+    EXPECT_GE(cpuPSNR, REGRESSION_MIN_PSNR);
+}
+
+//After a small rotation most of the engine comes from the previous frame, and the result stays close to raycasting
+//the whole frame
+TEST_F(ReprojectionRegression, SmallRotationReusesPreviousFrame)
+{
+    const int size = m_size;
+    Mat4 first = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+    m_camera.m_azimuth += 1.0;
+    Mat4 second = m_camera.viewMatrix();
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    QImage full(size, size, QImage::Format_RGBA8888), reprojected(size, size, QImage::Format_RGBA8888);
+    renderGL(second, projection, params, full.bits());
+
+    m_raycaster.setReprojection(true);
+    renderGL(first, projection, params, NULL);
+    EXPECT_EQ(m_raycaster.reprojectedPixels(), 0);
+    renderGL(second, projection, params, reprojected.bits());
+    int reused = m_raycaster.reprojectedPixels();
+
+    int covered = 0;
+    for(int i=0; i<size*size; i++)
+        if(full.constBits()[4*i] != 255 || full.constBits()[4*i + 1] != 255 || full.constBits()[4*i + 2] != 255) covered++;
+    double psnr = imagePSNR(reprojected.constBits(), full.constBits(), size, size);
+    fprintf(stderr, "1 degree rotation: %d of %d covered pixels reprojected, PSNR %.2f dB\n", reused, covered, psnr);
+    EXPECT_GT(reused, covered/2);
+    EXPECT_GE(psnr, 35.0);
+}
+
+//The jitter texture has to use every value equally often and keep its energy out of the low frequencies
+TEST(BlueNoiseRegression, FlatHistogramLittleLowFrequencyEnergy)
+{
+    const unsigned char *noise = blueNoiseTexture();
+    const int size = BLUE_NOISE_SIZE;
+    std::vector<int> histogram(256, 0);
+    for(int i=0; i<size*size; i++) histogram[noise[i]]++;
+    EXPECT_EQ(*std::min_element(histogram.begin(), histogram.end()), size*size/256);
+    EXPECT_EQ(*std::max_element(histogram.begin(), histogram.end()), size*size/256);
+
+    //Deviation of 3x3 box filtered noise from the mean, against white noise of the same histogram
+    std::vector<unsigned char> white(noise, noise + size*size);
+    unsigned int state = 12345;
+    for(int i=size*size - 1; i>0; i--) { //Fisher-Yates shuffle
+        state = state*1664525u + 1013904223u;
+        std::swap(white[i], white[(state >> 8)%(i + 1)]);
+    }
+    double blueVariance = 0.0, whiteVariance = 0.0;
+    for(int y=0; y<size; y++)
+        for(int x=0; x<size; x++) {
+            double blue = 0.0, shuffled = 0.0;
+            for(int j=-1; j<=1; j++)
+                for(int i=-1; i<=1; i++) {
+                    int index = ((y + j + size)%size)*size + (x + i + size)%size;
+                    blue += noise[index];
+                    shuffled += white[index];
+                }
+            blueVariance += (blue/9 - 127.5)*(blue/9 - 127.5);
+            whiteVariance += (shuffled/9 - 127.5)*(shuffled/9 - 127.5);
+        }
+    fprintf(stderr, "3x3 low pass deviation: blue noise %.2f, white noise %.2f\n", sqrt(blueVariance/(size*size)),
+            sqrt(whiteVariance/(size*size)));
+    EXPECT_LT(blueVariance, 0.5*whiteVariance);
+}
+
+//Two channels derived from the engine: its values at half the resolution, and a full resolution label volume of the
+//dense parts. Fused, they have to change the image alike in both raycasters; disabled, leave it as it was.
+TEST_F(ChannelRegression, FusedChannelsBackendsAgree)
+{
+    VolumeManager *volume = m_volume;
+    int w = volume->width(), h = volume->height(), d = volume->depth();
+    const float *data = volume->data();
+    int hw = w/2, hh = h/2, hd = d/2;
+    std::vector<float> half((long)hw*hh*hd), labels((long)w*h*d);
+    for(int z=0; z<hd; z++)
+        for(int y=0; y<hh; y++)
+            for(int x=0; x<hw; x++) {
+                float sum = 0.0;
+                for(int k=0; k<8; k++)
+                    sum += data[2*x + (k&1) + (long)w*(2*y + ((k >> 1)&1) + (long)h*(2*z + (k >> 2)))];
+                half[x + (long)hw*(y + (long)hh*z)] = sum/8;
+            }
+    for(long i=0; i<(long)w*h*d; i++) labels[i] = (data[i] > 0.6)?1.0:0.0;
+    TransferFunction1D halfTF, labelTF;
+    halfTF.clear();
+    halfTF.addAlphaNode(0.0, 0.0);
+    halfTF.addAlphaNode(0.3, 0.0);
+    halfTF.addAlphaNode(0.5, 0.05);
+    halfTF.addAlphaNode(1.0, 0.05);
+    halfTF.addColorNode(0.0, 0, 200, 0);
+    labelTF.clear();
+    labelTF.addAlphaNode(0.0, 0.0);
+    labelTF.addAlphaNode(0.5, 0.0);
+    labelTF.addAlphaNode(1.0, 0.2);
+    labelTF.addColorNode(0.0, 220, 0, 220);
+    unsigned char channelColors[2][TF1D_SIZE*4];
+    halfTF.bake(channelColors[0]);
+    labelTF.bake(channelColors[1]);
+
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+    float sx = volume->spacingX(), sy = volume->spacingY(), sz = volume->spacingZ();
+
+    QImage plain(size, size, QImage::Format_RGBA8888), fused(size, size, QImage::Format_RGBA8888);
+    QImage disabled(size, size, QImage::Format_RGBA8888);
+    EXPECT_FALSE(m_raycaster.setChannel(1, hw, hh, hd/2, half.data(), sx, sy, sz, false)) << "Accepted a channel of another extent";
+    ASSERT_TRUE(m_raycaster.setChannel(1, hw, hh, hd, half.data(), 2*sx, 2*sy, 2*sz, false));
+    ASSERT_TRUE(m_raycaster.setChannel(2, w, h, d, labels.data(), sx, sy, sz, true));
+    m_raycaster.setChannelTransferFunction(1, channelColors[0]);
+    m_raycaster.setChannelTransferFunction(2, channelColors[1]);
+    EXPECT_EQ(m_raycaster.channelMask(), 3u);
+    renderGL(view, projection, params, fused.bits());
+    m_raycaster.enableChannel(1, false);
+    m_raycaster.enableChannel(2, false);
+    renderGL(view, projection, params, disabled.bits());
+    m_raycaster.setChannel(1, 0, 0, 0, NULL, 1, 1, 1, false);
+    m_raycaster.setChannel(2, 0, 0, 0, NULL, 1, 1, 1, false);
+    renderGL(view, projection, params, plain.bits());
+    double channels = imagePSNR(fused.constBits(), plain.constBits(), size, size);
+    EXPECT_LT(channels, 35.0) << "The channels have no visible effect";
+    EXPECT_EQ(memcmp(disabled.constBits(), plain.constBits(), 4*size*size), 0) << "Disabled channels changed the image";
+
+    CPURaycaster cpu;
+    setUpCPU(cpu);
+    ASSERT_TRUE(cpu.setChannel(1, hw, hh, hd, half.data(), 2*sx, 2*sy, 2*sz, false));
+    ASSERT_TRUE(cpu.setChannel(2, w, h, d, labels.data(), sx, sy, sz, true));
+    cpu.setChannelTransferFunction(1, channelColors[0]);
+    cpu.setChannelTransferFunction(2, channelColors[1]);
+    EXPECT_FALSE(cpu.usesSIMD()) << "The packet kernel has no channels";
+    fprintf(stderr, "fused channels: %.2f dB from the volume alone\n", channels);
+    expectCPUMatches(cpu, view, projection, params, fused, "fused channels");
+}
+
+//The builder lives as long as the widget and sees every volume that is loaded: a second volume of another size must be
+//classified from its own brick ranges, with the TF of the first
+TEST(OccupancyRegression, RebuildsForEachVolume)
+{
+    int argc = 1;
+    char name[] = "blaze-regression";
+    char *argv[] = {name, NULL};
+    QCoreApplication app(argc, argv); //Delivers the finished builds
+    TransferFunction1D tf;
+    engineTransferFunction(tf);
+    unsigned char colorBuffer[TF1D_SIZE*4];
+    tf.bake(colorBuffer);
+
+    const int sizes[2][3] = {{48, 48, 48}, {80, 64, 72}};
+    VolumeManager volumes[2];
+    for(int i=0; i<2; i++) {
+        VolumeGeneratorParameters params;
+        params.m_width = sizes[i][0];
+        params.m_height = sizes[i][1];
+        params.m_depth = sizes[i][2];
+        params.m_seed = i + 1;
+        VolumeGenerator generator(params);
+        volumes[i].generate(generator);
+    }
+
+    OccupancyBuilder builder;
+    for(int i=0; i<2; i++) {
+        if(i == 0) {
+            builder.setVolume(&volumes[0]);
+            builder.requestRebuild(colorBuffer);
+        } else
+            builder.setVolume(&volumes[1]);
+        BrickRanges ranges;
+        ranges.compute(volumes[i].data(), sizes[i][0], sizes[i][1], sizes[i][2], OCCUPANCY_BRICK_SIZE);
+        OccupancyGrid expected;
+        expected.classify(ranges, colorBuffer, 0);
+
+        QSharedPointer<OccupancyGrid> grid;
+        for(int wait=0; wait<1000 && !(grid && grid->width() == expected.width()); wait++) {
+            QCoreApplication::processEvents();
+            QThread::msleep(10);
+            grid = builder.grid();
+        }
+        ASSERT_TRUE(grid) << "No grid for volume " << i;
+        ASSERT_EQ(grid->width(), expected.width());
+        ASSERT_EQ(grid->height(), expected.height());
+        ASSERT_EQ(grid->depth(), expected.depth());
+        EXPECT_EQ(memcmp(grid->data(), expected.data(), (size_t)expected.width()*expected.height()*expected.depth()), 0)
+                << "Volume " << i << " classified from other brick ranges";
+    }
+}
+
+//Float samples stored big-endian have to load as the same volume as their little-endian original
+TEST(VolumeLoaderRegression, BigEndianFloatMatchesLittleEndian)
+{
+    VolumeGeneratorParameters params;
+    params.m_pattern = PatternNoise;
+    params.m_width = 24;
+    params.m_height = 20;
+    params.m_depth = 16;
+    VolumeGenerator generator(params);
+    ASSERT_TRUE(generator.writeNRRD(BLAZE_BINARY_DIR "/loader-little.nhdr", SampleFloat));
+
+    long n = (long)params.m_width*params.m_height*params.m_depth;
+    std::vector<unsigned char> samples(4*n);
+    FILE *fid = fopen(BLAZE_BINARY_DIR "/loader-little.raw", "rb");
+    ASSERT_TRUE(fid != NULL);
+    ASSERT_EQ(fread(samples.data(), 4, n, fid), (size_t)n);
+    fclose(fid);
+    for(long i=0; i<n; i++) {
+        std::swap(samples[4*i], samples[4*i + 3]);
+        std::swap(samples[4*i + 1], samples[4*i + 2]);
+    }
+    fid = fopen(BLAZE_BINARY_DIR "/loader-big.raw", "wb");
+    ASSERT_TRUE(fid != NULL);
+    ASSERT_EQ(fwrite(samples.data(), 4, n, fid), (size_t)n);
+    fclose(fid);
+    fid = fopen(BLAZE_BINARY_DIR "/loader-big.nhdr", "w");
+    ASSERT_TRUE(fid != NULL);
+    fprintf(fid, "NRRD0004\ncontent: big\ntype: float\ndimension: 3\nsizes: %d %d %d\nspacings: 1 1 1\n"
+                 "data file: ./loader-big.raw\nendian: big\nencoding: raw\n", params.m_width, params.m_height, params.m_depth);
+    fclose(fid);
+
+    VolumeManager little, big;
+    little.readNHDR(BLAZE_BINARY_DIR "/loader-little.nhdr");
+    big.readNHDR(BLAZE_BINARY_DIR "/loader-big.nhdr");
+    ASSERT_TRUE(little.data() != NULL && big.data() != NULL);
+    ASSERT_EQ(big.width(), params.m_width);
+    ASSERT_EQ(big.height(), params.m_height);
+    ASSERT_EQ(big.depth(), params.m_depth);
+    EXPECT_EQ(memcmp(big.data(), little.data(), n*sizeof(float)), 0) << "Big-endian floats were not swapped";
+}
+
+//Paths of the program binaries in a cache directory
+static std::vector<std::string> programBinaries(std::string const &directory)
+{
+    std::vector<std::string> files;
+    DIR *dir = opendir(directory.c_str());
+    if(!dir) return files;
+    while(struct dirent *entry = readdir(dir)) {
+        std::string name(entry->d_name);
+        if(name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0) files.push_back(directory + "/" + name);
+    }
+    closedir(dir);
+    return files;
+}
+
+//A warm start has to render from the cached binaries alone, and a binary the driver rejects has to be compiled again;
+//both have to render the golden image
+TEST_F(ProgramCacheRegression, CorruptBinaryFallsBackToCompiling)
+{
+    std::string directory = BLAZE_BINARY_DIR "/program-cache";
+    mkdir(directory.c_str(), 0755);
+    std::vector<std::string> stale = programBinaries(directory);
+    for(size_t i=0; i<stale.size(); i++) remove(stale[i].c_str());
+
+    QString golden = QString(BLAZE_SOURCE_DIR "/tests/golden/") + m_case.m_name + ".png";
+    QImage expected = QImage(golden).convertToFormat(QImage::Format_RGBA8888);
+    ASSERT_FALSE(expected.isNull()) << "Missing golden image " << golden.toStdString();
+    RaycastParameters params;
+    params.m_performPhongShading = false;
+    const int size = m_size;
+    Mat4 view = m_camera.viewMatrix(), projection = m_camera.projectionMatrix(1.0);
+
+    //Cold, warm, then with every binary corrupted
+    const char *runs[] = {"cold", "warm", "corrupt"};
+    for(int run=0; run<3; run++) {
+        if(run == 2) {
+            std::vector<std::string> binaries = programBinaries(directory);
+            for(size_t i=0; i<binaries.size(); i++) {
+                FILE *fid = fopen(binaries[i].c_str(), "r+b");
+                ASSERT_TRUE(fid != NULL);
+                fseek(fid, 0, SEEK_END);
+                long length = ftell(fid);
+                const long header = sizeof(GLenum) + sizeof(GLint); //Format and length, see saveProgramBinary()
+                std::vector<unsigned char> payload(length - header);
+                fseek(fid, header, SEEK_SET);
+                ASSERT_EQ(fread(payload.data(), 1, payload.size(), fid), payload.size());
+                for(size_t b=0; b<payload.size(); b++) payload[b] ^= 0x5a;
+                fseek(fid, header, SEEK_SET);
+                ASSERT_EQ(fwrite(payload.data(), 1, payload.size(), fid), payload.size());
+                fclose(fid);
+            }
+        }
+        GLRaycaster raycaster;
+        raycaster.setProgramCache(directory.c_str());
+        ASSERT_TRUE(raycaster.create(readShader("cube.vs").constData(), readShader("cube.fs").constData()));
+        raycaster.setVolume(m_volume->width(), m_volume->height(), m_volume->depth(), m_volume->data(),
+                            m_volume->spacingX(), m_volume->spacingY(), m_volume->spacingZ());
+        raycaster.setTransferFunction(m_colorBuffer);
+        QImage image(size, size, QImage::Format_RGBA8888);
+        glClear(GL_COLOR_BUFFER_BIT);
+        raycaster.render(view, projection, params);
+        m_context.readPixels(image.bits());
+        int hits = raycaster.programCacheHits(), misses = raycaster.programCacheMisses();
+        raycaster.destroy();
+        if(run == 0 && programBinaries(directory).empty()) GTEST_SKIP() << "The driver has no program binary formats";
+
+        double psnr = imagePSNR(image.constBits(), expected.constBits(), size, size);
+        fprintf(stderr, "program cache %s: %d hits, %d compiled, PSNR %.2f dB\n", runs[run], hits, misses, psnr);
+        EXPECT_GT(run == 1 ? hits : misses, 0) << runs[run];
+        EXPECT_EQ(run == 1 ? misses : hits, 0) << runs[run];
+        EXPECT_GE(psnr, REGRESSION_MIN_PSNR) << runs[run];
+    }
+}